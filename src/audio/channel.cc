@@ -20,6 +20,8 @@
 #include "channel.hh"
 
 #include <util/file.hh>
+#include <algorithm>
+#include <chrono>
 #include <map>
 
 namespace hojy::audio {
@@ -45,7 +47,12 @@ Channel::Channel(Mixer *mixer, const void *data, size_t size): sampleRateOut_(mi
     memcpy(data_.data(), data, size);
 }
 
+Channel::~Channel() {
+    stopDecodeAhead();
+}
+
 void Channel::load(const std::string &filename) {
+    stopDecodeAhead();
     resampler_.reset();
     data_.clear();
     data_ = loadDataFromCacheOrFile(filename);
@@ -53,6 +60,22 @@ void Channel::load(const std::string &filename) {
 }
 
 size_t Channel::readData(void *data, size_t size) {
+    if (decodeThread_.joinable()) {
+        /* check end flag before popping, so that no data pushed after the check is lost */
+        bool ended = decodeEnd_.load(std::memory_order_acquire);
+        auto count = size / frameSize_;
+        auto rcount = decodeBuffer_.pop(data, count);
+        if (rcount == count || ended) {
+            return rcount * frameSize_;
+        }
+        /* underrun, fill silence instead of reporting the end of stream */
+        memset(static_cast<std::uint8_t*>(data) + rcount * frameSize_, 0, (count - rcount) * frameSize_);
+        return count * frameSize_;
+    }
+    return readConverted(data, size);
+}
+
+size_t Channel::readConverted(void *data, size_t size) {
     if (resampler_) {
         return resampler_->read(data, size);
     }
@@ -65,6 +88,7 @@ size_t Channel::readData(void *data, size_t size) {
 }
 
 void Channel::start() {
+    stopDecodeAhead();
     if (sampleRateIn_ != sampleRateOut_) {
 #if defined(USE_SOXR)
         resampler_ = std::make_unique<Resampler>(2, sampleRateIn_, sampleRateOut_, typeIn_, typeOut_);
@@ -78,6 +102,37 @@ void Channel::start() {
         });
 #endif
     }
+    if (decodeAheadMs_) {
+        frameSize_ = 2 * Mixer::dataTypeToSize(typeOut_);
+        auto frames = std::max<size_t>(size_t(sampleRateOut_) * decodeAheadMs_ / 1000, DecodeChunkFrames * 2);
+        decodeBuffer_.init(frameSize_, frames);
+        decodeCache_.resize(DecodeChunkFrames * frameSize_);
+        decodeQuit_ = false;
+        decodeEnd_ = false;
+        decodeThread_ = std::thread(&Channel::decodeProc, this);
+    }
+}
+
+void Channel::stopDecodeAhead() {
+    if (!decodeThread_.joinable()) { return; }
+    decodeQuit_ = true;
+    decodeThread_.join();
+}
+
+void Channel::decodeProc() {
+    auto sleepTime = std::chrono::milliseconds(std::clamp<std::uint32_t>(decodeAheadMs_ / 4, 1, 20));
+    while (!decodeQuit_) {
+        if (decodeBuffer_.freeCount() < DecodeChunkFrames) {
+            std::this_thread::sleep_for(sleepTime);
+            continue;
+        }
+        auto rsize = readConverted(decodeCache_.data(), DecodeChunkFrames * frameSize_);
+        if (!rsize) {
+            decodeEnd_.store(true, std::memory_order_release);
+            break;
+        }
+        decodeBuffer_.push(decodeCache_.data(), rsize / frameSize_);
+    }
 }
 
 }
@@ -21,22 +21,28 @@
 
 #include "mixer.hh"
 #include "resampler.hh"
+#include "util/ringbuffer.hh"
 
 #include <string>
 #include <vector>
 #include <memory>
+#include <thread>
+#include <atomic>
 #include <cstdint>
 
 namespace hojy::audio {
 
 class Channel {
+    enum : size_t {
+        DecodeChunkFrames = 1024,
+    };
 public:
     Channel(Mixer *mixer, const std::string &filename);
     Channel(Mixer *mixer, const void *data, size_t size);
-    virtual ~Channel() = default;
+    virtual ~Channel();
 
     Channel(const Channel&) = delete;
-    Channel(Channel&&) noexcept = default;
+    Channel(Channel&&) = delete;
 
     virtual void load(const std::string &filename);
 
@@ -50,6 +56,12 @@ public:
 
 protected:
     virtual size_t readPCMData(const void **data, size_t size, bool convType) { return 0; }
+    /* must be called in destructor of subclass that uses decode-ahead, before its decoder is destroyed */
+    void stopDecodeAhead();
+
+private:
+    size_t readConverted(void *data, size_t size);
+    void decodeProc();
 
 protected:
     std::vector<std::uint8_t> data_;
@@ -58,6 +70,16 @@ protected:
     double sampleRateIn_ = 0.f, sampleRateOut_ = 0.f;
     Mixer::DataType typeIn_ = Mixer::F32, typeOut_ = Mixer::F32;
     bool ok_ = false, repeat_ = false;
+
+    /* when non-zero, PCM is converted and resampled ahead in a background thread */
+    std::uint32_t decodeAheadMs_ = 0;
+
+private:
+    size_t frameSize_ = 0;
+    util::RingBuffer decodeBuffer_;
+    std::vector<std::uint8_t> decodeCache_;
+    std::thread decodeThread_;
+    std::atomic<bool> decodeQuit_ = false, decodeEnd_ = false;
 };
 
 }
@@ -19,16 +19,20 @@
 
 #include "channelmidi.hh"
 
+#include "core/config.hh"
 #include <adlmidi.h>
 #include <SDL.h>
+#include <algorithm>
 
 namespace hojy::audio {
 
 ChannelMIDI::ChannelMIDI(Mixer *mixer, const std::string &filename) : Channel(mixer, filename) {
+    decodeAheadMs_ = std::max(core::config.musicDecodeAhead(), 0);
     if (ok_) { loadFromData(); }
 }
 
 ChannelMIDI::~ChannelMIDI() {
+    stopDecodeAhead();
     if (midiplayer_) {
         adl_close(static_cast<ADL_MIDIPlayer*>(midiplayer_));
         midiplayer_ = nullptr;
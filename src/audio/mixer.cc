@@ -24,18 +24,30 @@
 #include "channelwav.hh"
 #include "core/config.hh"
 #include <SDL.h>
+#include <chrono>
 
 namespace hojy::audio {
 
 Mixer gMixer;
 
-void Mixer::ChannelInfo::reset() {
-    ch.reset();
-    volume = 0;
-}
-
 Mixer::~Mixer() {
     SDL_CloseAudioDevice(audioDevice_);
+    if (worker_.joinable()) {
+        {
+            std::unique_lock lk(requestMutex_);
+            quit_ = true;
+        }
+        requestCond_.notify_one();
+        worker_.join();
+    }
+    Command cmd;
+    while (commands_.pop(cmd)) {
+        delete cmd.ch;
+    }
+    Channel *ch;
+    while (retired_.pop(ch)) {
+        delete ch;
+    }
 }
 
 void Mixer::init(int channels) {
@@ -77,48 +89,15 @@ void Mixer::init(int channels) {
     format_ = obtained.format;
     channels_.resize(channels);
     cache_.resize(obtained.size);
+    worker_ = std::thread(&Mixer::workerProc, this);
 }
 
 void Mixer::play(size_t channelId, Channel *ch, int volume, std::uint32_t fadeOutMs, std::uint32_t fadeInMs) {
     if (channelId >= channels_.size()) {
+        delete ch;
         return;
     }
-    std::scoped_lock lk(playMutex_);
-    auto &chi = channels_[channelId];
-    if (ch) {
-        if (!ch->ok()) {
-            delete ch;
-            return;
-        }
-        if (fadeOutMs && chi.ch) {
-            chi.chNext.reset(ch);
-            chi.filenameNext.clear();
-            chi.volumeNext = volume;
-            auto now = SDL_GetTicks();
-            chi.fadeOutStart = now;
-            chi.fadeOut = fadeOutMs;
-            chi.fadeInStart = chi.fadeIn = 0;
-        } else {
-            chi = {std::unique_ptr<Channel>(ch), volume};
-            ch->start();
-        }
-        if (fadeInMs) {
-            auto now = SDL_GetTicks();
-            chi.fadeInStart = now;
-            chi.fadeIn = fadeInMs;
-        }
-    } else {
-        if (fadeOutMs && chi.ch) {
-            chi.chNext.reset();
-            chi.filenameNext.clear();
-            auto now = SDL_GetTicks();
-            chi.fadeOutStart = now;
-            chi.fadeOut = fadeOutMs;
-            chi.fadeInStart = chi.fadeIn = 0;
-        } else {
-            chi = {nullptr, VolumeMax};
-        }
-    }
+    postRequest(Request {Command {Command::Play, channelId, ch, volume, fadeOutMs, fadeInMs}});
 }
 
 bool iequals(const std::string &a, const std::string &b) {
@@ -133,66 +112,7 @@ void Mixer::play(size_t channelId, const std::string &filename, bool repeat, int
     if (channelId >= channels_.size()) {
         return;
     }
-    std::scoped_lock lk(playMutex_);
-    auto &chi = channels_[channelId];
-    if (fadeOutMs && chi.ch) {
-        chi.chNext.reset();
-        chi.filenameNext = filename;
-        chi.volumeNext = volume;
-        chi.repeatNext = repeat;
-        auto now = SDL_GetTicks();
-        chi.fadeOutStart = now;
-        chi.fadeOut = fadeOutMs;
-        chi.fadeInStart = chi.fadeIn = 0;
-    } else {
-        auto pos = filename.find_last_of('.');
-        if (pos == std::string::npos) {
-            return;
-        }
-        auto ext = filename.substr(pos + 1);
-        int type = -1;
-        if (iequals(ext, "MID") || iequals(ext, "XMI")) {
-            type = 0;
-            if (!dynamic_cast<ChannelMIDI*>(chi.ch.get())) {
-                chi.ch.reset();
-            }
-        } else if (iequals(ext, "WAV")) {
-            type = 1;
-            if (!dynamic_cast<ChannelWav*>(chi.ch.get())) {
-                chi.ch.reset();
-            }
-        }
-        if (!chi.ch) {
-            Channel *ch;
-            switch (type) {
-            case 0:
-                ch = new(std::nothrow) ChannelMIDI(this, filename);
-                break;
-            case 1:
-                ch = new(std::nothrow) ChannelWav(this, filename);
-                break;
-            default:
-                return;
-            }
-            if (!ch) { return; }
-            if (!ch->ok()) {
-                delete ch;
-                return;
-            }
-            chi = {std::unique_ptr<Channel>(ch), volume};
-            chi.ch->start();
-        } else {
-            chi.ch->load(filename);
-            chi.volume = volume;
-            chi.ch->start();
-        }
-        chi.ch->setRepeat(repeat);
-    }
-    if (fadeInMs) {
-        auto now = SDL_GetTicks();
-        chi.fadeInStart = now;
-        chi.fadeIn = fadeInMs;
-    }
+    postRequest(Request {Command {Command::Play, channelId, nullptr, volume, fadeOutMs, fadeInMs}, filename, repeat});
 }
 
 void Mixer::pause(bool on) const {
@@ -201,9 +121,7 @@ void Mixer::pause(bool on) const {
 
 void Mixer::setVolume(size_t channelId, int volume) {
     if (channelId >= channels_.size()) { return; }
-    auto &chi = channels_[channelId];
-    if (!chi.ch) { return; }
-    chi.volume = chi.volumeNext = volume;
+    postRequest(Request {Command {Command::SetVolume, channelId, nullptr, volume}});
 }
 
 Mixer::DataType Mixer::convertDataType(std::uint16_t type) {
@@ -247,10 +165,9 @@ size_t Mixer::dataTypeToSize(Mixer::DataType type) {
 
 void Mixer::callback(void *userdata, std::uint8_t *stream, int len) {
     auto *mixer = static_cast<Mixer*>(userdata);
-    std::scoped_lock lk(mixer->playMutex_);
+    mixer->processCommands();
     auto &cache = mixer->cache_;
     auto &channels = mixer->channels_;
-    auto &chi0 = channels[0];
     memset(stream, 0, len);
     for (auto &chi: channels) {
         if (!chi.ch) { continue; }
@@ -259,60 +176,16 @@ void Mixer::callback(void *userdata, std::uint8_t *stream, int len) {
             if (chi.fadeOut) {
                 auto delta = std::uint32_t(std::int32_t(SDL_GetTicks() - chi.fadeOutStart));
                 if (delta >= chi.fadeOut) {
-                    if (chi.chNext) {
-                        chi.ch = std::move(chi.chNext);
-                        chi.volume = chi.volumeNext;
-                    } else if (!chi.filenameNext.empty()) {
-                        auto filename = std::move(chi.filenameNext);
-                        auto pos = filename.find_last_of('.');
-                        if (pos == std::string::npos) {
-                            continue;
-                        }
-                        auto ext = filename.substr(pos + 1);
-                        int type = -1;
-                        if (iequals(ext, "MID") || iequals(ext, "XMI")) {
-                            type = 0;
-                            if (!dynamic_cast<ChannelMIDI*>(chi.ch.get())) {
-                                chi.ch.reset();
-                            }
-                        } else if (iequals(ext, "WAV")) {
-                            type = 1;
-                            if (!dynamic_cast<ChannelWav*>(chi.ch.get())) {
-                                chi.ch.reset();
-                            }
-                        }
-                        if (!chi.ch) {
-                            Channel *ch;
-                            switch (type) {
-                            case 0:
-                                ch = new(std::nothrow) ChannelMIDI(mixer, filename);
-                                break;
-                            case 1:
-                                ch = new(std::nothrow) ChannelWav(mixer, filename);
-                                break;
-                            default:
-                                continue;
-                            }
-                            if (!ch) { continue; }
-                            if (!ch->ok()) {
-                                delete ch;
-                                continue;
-                            }
-                            chi = {std::unique_ptr<Channel>(ch), chi.volumeNext};
-                        } else {
-                            chi.ch->load(filename);
-                            chi.volume = chi.volumeNext;
-                        }
-                        chi.ch->start();
-                        chi.ch->setRepeat(chi.repeatNext);
-                    }
+                    /* faded out completely, switch to next channel (or stop) from next period */
+                    mixer->retire(chi.ch.release());
+                    chi.ch = std::move(chi.chNext);
+                    chi.volume = chi.volumeNext;
                     chi.fadeOutStart = chi.fadeOut = 0;
-                    chi.ch->start();
                 } else {
                     int volume = int(chi.volume * (chi.fadeOut - delta) / chi.fadeOut);
                     if (volume) { SDL_MixAudioFormat(stream, cache.data(), mixer->format_, rsize, volume); }
-                    continue;
                 }
+                continue;
             }
             if (chi.fadeIn) {
                 auto delta = std::uint32_t(std::int32_t(SDL_GetTicks() - chi.fadeInStart));
@@ -326,9 +199,130 @@ void Mixer::callback(void *userdata, std::uint8_t *stream, int len) {
             }
             if (chi.volume) { SDL_MixAudioFormat(stream, cache.data(), mixer->format_, rsize, chi.volume); }
         } else {
-            chi.reset();
+            mixer->retire(chi.ch.release());
+            chi.ch = std::move(chi.chNext);
+            chi.volume = chi.ch ? chi.volumeNext : 0;
+            chi.fadeOutStart = chi.fadeOut = 0;
         }
     }
 }
 
+void Mixer::processCommands() {
+    Command cmd;
+    while (commands_.pop(cmd)) {
+        auto &chi = channels_[cmd.channelId];
+        switch (cmd.type) {
+        case Command::Play: {
+            auto now = SDL_GetTicks();
+            if (cmd.fadeOutMs && chi.ch) {
+                retire(chi.chNext.release());
+                chi.chNext.reset(cmd.ch);
+                chi.volumeNext = cmd.volume;
+                chi.fadeOutStart = now;
+                chi.fadeOut = cmd.fadeOutMs;
+                chi.fadeInStart = chi.fadeIn = 0;
+            } else {
+                retire(chi.ch.release());
+                retire(chi.chNext.release());
+                chi.ch.reset(cmd.ch);
+                chi.volume = cmd.ch ? cmd.volume : 0;
+                chi.fadeOutStart = chi.fadeOut = 0;
+                chi.fadeInStart = chi.fadeIn = 0;
+            }
+            if (cmd.fadeInMs && cmd.ch) {
+                chi.fadeInStart = now;
+                chi.fadeIn = cmd.fadeInMs;
+            }
+            break;
+        }
+        case Command::SetVolume:
+            if (chi.ch) { chi.volume = chi.volumeNext = cmd.volume; }
+            break;
+        }
+    }
+}
+
+void Mixer::retire(Channel *ch) {
+    if (!ch) { return; }
+    /* the worker thread sweeps retired channels periodically, so the queue being full
+     * should never happen, delete it here as a last resort instead of leaking */
+    if (!retired_.push(ch)) {
+        delete ch;
+    }
+}
+
+void Mixer::postRequest(Mixer::Request &&req) {
+    {
+        std::unique_lock lk(requestMutex_);
+        requests_.emplace_back(std::move(req));
+    }
+    requestCond_.notify_one();
+}
+
+void Mixer::workerProc() {
+    std::unique_lock lk(requestMutex_);
+    while (!quit_) {
+        requestCond_.wait_for(lk, std::chrono::milliseconds(100), [this] { return quit_ || !requests_.empty(); });
+        while (!quit_ && !requests_.empty()) {
+            auto req = std::move(requests_.front());
+            requests_.pop_front();
+            lk.unlock();
+            handleRequest(req);
+            lk.lock();
+        }
+        Channel *ch;
+        while (retired_.pop(ch)) {
+            delete ch;
+        }
+    }
+    while (!requests_.empty()) {
+        delete requests_.front().cmd.ch;
+        requests_.pop_front();
+    }
+}
+
+void Mixer::handleRequest(Mixer::Request &req) {
+    auto &cmd = req.cmd;
+    if (cmd.type == Command::Play) {
+        if (!req.filename.empty()) {
+            cmd.ch = createChannel(req.filename);
+            if (!cmd.ch) { return; }
+            cmd.ch->setRepeat(req.repeat);
+        } else if (cmd.ch && !cmd.ch->ok()) {
+            delete cmd.ch;
+            return;
+        }
+        if (cmd.ch) { cmd.ch->start(); }
+    }
+    /* audio callback drains the queue every period, it can only be full while the device is paused */
+    while (!commands_.push(cmd)) {
+        if (quit_) {
+            delete cmd.ch;
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+Channel *Mixer::createChannel(const std::string &filename) {
+    auto pos = filename.find_last_of('.');
+    if (pos == std::string::npos) {
+        return nullptr;
+    }
+    auto ext = filename.substr(pos + 1);
+    Channel *ch;
+    if (iequals(ext, "MID") || iequals(ext, "XMI")) {
+        ch = new(std::nothrow) ChannelMIDI(this, filename);
+    } else if (iequals(ext, "WAV")) {
+        ch = new(std::nothrow) ChannelWav(this, filename);
+    } else {
+        return nullptr;
+    }
+    if (ch && !ch->ok()) {
+        delete ch;
+        return nullptr;
+    }
+    return ch;
+}
+
 }
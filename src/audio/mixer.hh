@@ -19,8 +19,15 @@
 
 #pragma once
 
+#include "util/spscqueue.hh"
+
 #include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <deque>
 #include <vector>
+#include <string>
 #include <memory>
 #include <cstdint>
 
@@ -40,10 +47,25 @@ class Mixer final {
         std::uint32_t fadeOutStart = 0, fadeOut = 0;
         std::unique_ptr<Channel> chNext;
         int volumeNext = 0;
-        std::string filenameNext;
-        bool repeatNext = false;
-
-        void reset();
+    };
+    /* sent from worker thread to audio callback */
+    struct Command {
+        enum Type : std::uint8_t {
+            Play,
+            SetVolume,
+        };
+        Type type = Play;
+        size_t channelId = 0;
+        /* nullptr for Play means stop */
+        Channel *ch = nullptr;
+        int volume = 0;
+        std::uint32_t fadeOutMs = 0, fadeInMs = 0;
+    };
+    /* sent from game thread to worker thread */
+    struct Request {
+        Command cmd;
+        std::string filename;
+        bool repeat = false;
     };
 public:
     enum DataType {
@@ -69,14 +91,30 @@ public:
 
 private:
     static void callback(void *userdata, std::uint8_t *stream, int len);
+    void processCommands();
+    void retire(Channel *ch);
+
+    void postRequest(Request &&req);
+    void workerProc();
+    void handleRequest(Request &req);
+    Channel *createChannel(const std::string &filename);
 
 private:
     std::uint32_t audioDevice_ = 0;
     std::uint32_t sampleRate_ = 0;
     std::uint16_t format_ = 0;
+    /* owned by audio callback */
     std::vector<ChannelInfo> channels_;
     std::vector<std::uint8_t> cache_;
-    std::mutex playMutex_;
+
+    /* channels are created/destroyed in worker thread, audio callback never locks or allocates */
+    util::SPSCQueue<Command, 64> commands_;
+    util::SPSCQueue<Channel*, 64> retired_;
+    std::deque<Request> requests_;
+    std::mutex requestMutex_;
+    std::condition_variable requestCond_;
+    std::atomic<bool> quit_ = false;
+    std::thread worker_;
 };
 
 extern Mixer gMixer;
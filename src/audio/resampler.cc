@@ -44,7 +44,7 @@ Resampler::Resampler(std::uint32_t channels, double sampleRateIn, double sampleR
     sampleSizeIn_ *= channels;
     sampleSizeOut_ *= channels;
 #if !defined(USE_SOXR)
-    buffer_.setUnitSize(sampleSizeOut_);
+    buffer_.init(sampleSizeOut_, RingBufferUnits);
 #endif
 }
 
@@ -84,18 +84,24 @@ size_t Resampler::read(void *data, size_t size) {
             ptr += rsize * sampleSize;
             if (!osize) { break; }
         }
-        auto psize = std::max<size_t>(osize * 2, size / sampleSize);
+        /* buffer is drained here, so all of its capacity is available */
+        auto psize = std::min(std::max<size_t>(osize * 2, size / sampleSize), buffer_.capacity());
         auto isize = size_t(double(psize) / rate_);
         const void *pcmdata;
         rsize = inputCB_(&pcmdata, isize * sampleSize) / sampleSize;
         if (!rsize) { break; }
-        auto *buf = buffer_.alloc(psize);
         resampler->inp_data = (float *)pcmdata;
         resampler->inp_count = rsize;
-        resampler->out_data = (float *)buf;
-        resampler->out_count = psize;
-        resampler->process();
-        buffer_.push(buf, psize - resampler->out_count);
+        /* output region may wrap around the end of ring */
+        while (resampler->inp_count) {
+            size_t count = psize;
+            auto *buf = buffer_.reserve(count);
+            if (!count) { break; }
+            resampler->out_data = (float *)buf;
+            resampler->out_count = count;
+            resampler->process();
+            buffer_.commit(count - resampler->out_count);
+        }
     }
     return ptr - (std::uint8_t*)data;
 #endif
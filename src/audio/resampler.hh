@@ -20,13 +20,16 @@
 #pragma once
 
 #include "mixer.hh"
-#include "util/fifobuffer.hh"
+#include "util/ringbuffer.hh"
 #include <functional>
 #include <cstdint>
 
 namespace hojy::audio {
 
 class Resampler final {
+    enum : size_t {
+        RingBufferUnits = 16384,
+    };
 public:
     using InputCallback = std::function<size_t (const void**, size_t)>;
     Resampler(std::uint32_t channels, double sampleRateIn, double sampleRateOut, Mixer::DataType typeIn, Mixer::DataType typeOut);
@@ -43,7 +46,7 @@ private:
     double rate_ = 0.;
     size_t sampleSizeIn_ = 0, sampleSizeOut_ = 0;
 #if !defined(USE_SOXR)
-    util::FIFOBuffer buffer_;
+    util::RingBuffer buffer_;
 #endif
 };
 
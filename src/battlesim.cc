@@ -0,0 +1,427 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Headless battle simulator: fast-forwards warfield battles with AI controlling both sides,
+ * no rendering, effects or popups, and prints outcome statistics of each warfield
+ *
+ * usage: hojy-battlesim <warId|all> [battles=100] [threads=cpu count] [save slot=0(new game)] [seed=1]
+ */
+
+#include "core/config.hh"
+#include "data/factors.hh"
+#include "data/warfielddata.hh"
+#include "mem/action.hh"
+#include "mem/bag.hh"
+#include "mem/savedata.hh"
+#include "scene/battleai.hh"
+#include "util/random.hh"
+#include <fmt/format.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <set>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+using namespace hojy;
+
+/* battles not decided after this many rounds are counted as draws */
+static const int MaxRounds = 300;
+
+struct BattleResult {
+    int winner = -1;
+    int rounds = 0, turns = 0;
+    int survivors = 0, members = 0;
+    int hp = 0, maxHp = 0;
+};
+
+/* mirrors turn rules of scene::Warfield, see nextAction()/autoAction()/startActAction()/endTurn() */
+class Battle {
+    struct CharInfo {
+        std::uint8_t side;
+        std::int16_t id;
+        std::int16_t x, y;
+        mem::CharacterData info;
+    };
+
+public:
+    bool load(std::int16_t warId);
+    BattleResult run();
+
+private:
+    void putChars(const data::WarfieldInfo *info);
+    void act(CharInfo *ch);
+    void useSkill(CharInfo *ch, const scene::BattleAI::Plan &plan);
+    void makeDamage(CharInfo *ch, int x, int y, int distance, std::int16_t index, std::int16_t level);
+    void recalcKnowledge();
+    /* returns winner side, -1 if both sides are still alive */
+    int endTurn();
+
+private:
+    int width_ = data::WarFieldWidth, height_ = data::WarFieldHeight;
+    std::vector<std::uint8_t> blocked_;
+    std::vector<CharInfo*> cells_;
+    std::vector<CharInfo> chars_;
+    std::vector<CharInfo*> charQueue_;
+    std::uint16_t knowledge_[2] = {0, 0};
+    scene::BattleAI ai_;
+};
+
+bool Battle::load(std::int16_t warId) {
+    const auto *info = data::gWarfieldData.info(warId);
+    if (!info) { return false; }
+    const auto *layers = data::gWarfieldData.layers(info->warFieldId);
+    if (!layers) { return false; }
+    auto size = width_ * height_;
+    blocked_.resize(size);
+    for (int i = 0; i < size; ++i) {
+        blocked_[i] = data::isWarfieldCellBlocked(layers->layers[0][i] >> 1, layers->layers[1][i] >> 1);
+    }
+    cells_.assign(size, nullptr);
+    chars_.clear();
+    charQueue_.clear();
+    putChars(info);
+    recalcKnowledge();
+    return true;
+}
+
+void Battle::putChars(const data::WarfieldInfo *info) {
+    /* like Warfield::getDefaultChars() + putChars(), fall back to the team if no default member is set */
+    auto addChar = [this](std::uint8_t side, std::int16_t id, std::int16_t x, std::int16_t y) {
+        const auto *charInfo = mem::gSaveData.charInfo[id];
+        if (!charInfo) { return; }
+        chars_.emplace_back(CharInfo {side, id, x, y, *charInfo});
+    };
+    if (info->forceMembers[0] >= 0) {
+        for (size_t i = 0; i < data::TeamMemberCount; ++i) {
+            auto id = info->forceMembers[i];
+            if (id >= 0) { addChar(0, id, info->memberX[i], info->memberY[i]); }
+        }
+    } else {
+        std::set<std::int16_t> chars;
+        for (auto id: info->defaultMembers) {
+            if (id >= 0) { chars.insert(id); }
+        }
+        if (chars.empty()) {
+            for (auto id: mem::gSaveData.baseInfo->members) {
+                if (id >= 0) { chars.insert(id); }
+            }
+        }
+        std::map<std::int16_t, size_t> charMap;
+        std::set<size_t> indices;
+        for (size_t i = 0; i < data::TeamMemberCount; ++i) {
+            auto id = info->defaultMembers[i];
+            if (id >= 0) { charMap[id] = i; }
+            else { indices.insert(i); }
+        }
+        for (auto id: chars) {
+            size_t index;
+            auto ite = charMap.find(id);
+            if (ite != charMap.end()) {
+                index = ite->second;
+            } else {
+                if (indices.empty()) { break; }
+                index = *indices.begin();
+                indices.erase(indices.begin());
+            }
+            addChar(0, id, info->memberX[index], info->memberY[index]);
+        }
+    }
+    for (size_t i = 0; i < data::WarFieldEnemyCount; ++i) {
+        auto id = info->enemy[i];
+        if (id >= 0) { addChar(1, id, info->enemyX[i], info->enemyY[i]); }
+    }
+    auto ite = chars_.begin();
+    while (ite != chars_.end()) {
+        auto &ci = *ite;
+        if (ci.x < 0 || ci.y < 0 || ci.x >= width_ || ci.y >= height_ || cells_[ci.y * width_ + ci.x]) {
+            ite = chars_.erase(ite);
+            continue;
+        }
+        mem::addUpPropFromEquipToChar(&ci.info);
+        if (ci.side == 1) {
+            ci.info.hp = ci.info.maxHp;
+            ci.info.mp = ci.info.maxMp;
+            ci.info.stamina = data::StaminaMax;
+        }
+        ++ite;
+    }
+    /* chars_ is not resized anymore, pointers are stable from here */
+    for (auto &ci: chars_) {
+        cells_[ci.y * width_ + ci.x] = &ci;
+    }
+}
+
+BattleResult Battle::run() {
+    BattleResult result;
+    for (auto &ci: chars_) {
+        if (ci.side == 0) { ++result.members; }
+    }
+    int winner = -1;
+    while (winner < 0) {
+        if (charQueue_.empty()) {
+            if (++result.rounds > MaxRounds) { break; }
+            for (auto &c: chars_) {
+                if (c.info.hp > 0) { charQueue_.emplace_back(&c); }
+            }
+            std::stable_sort(charQueue_.begin(), charQueue_.end(), [](const CharInfo *c0, const CharInfo *c1) {
+                return c0->info.speed < c1->info.speed;
+            });
+        }
+        auto *ch = charQueue_.back();
+        if (ch->info.hp <= 0) {
+            charQueue_.pop_back();
+            continue;
+        }
+        ++result.turns;
+        act(ch);
+        winner = endTurn();
+    }
+    result.winner = winner;
+    for (auto &ci: chars_) {
+        if (ci.side != 0 || ci.info.hp <= 0) { continue; }
+        ++result.survivors;
+        result.hp += ci.info.hp;
+        result.maxHp += ci.info.maxHp;
+    }
+    return result;
+}
+
+void Battle::act(CharInfo *ch) {
+    mem::actPoisonDamage(&ch->info);
+    auto enemySide = ch->side ^ 1;
+    scene::BattleAI::Unit enemies[scene::TargetScorer::MaxEnemies];
+    int enemyCount = 0;
+    for (auto &ci: chars_) {
+        if (ci.side != enemySide || ci.info.hp <= 0) { continue; }
+        enemies[enemyCount++] = scene::BattleAI::Unit {ci.side, ci.x, ci.y, &ci.info};
+    }
+    ai_.begin(scene::BattleAI::Unit {ch->side, ch->x, ch->y, &ch->info}, knowledge_[ch->side], ch->info.speed / 15,
+              enemies, enemyCount, width_, height_, [this, myside = ch->side](int index) {
+        std::uint8_t flags = blocked_[index] ? scene::SelectableArea::CellBlocked : 0;
+        const auto *c = cells_[index];
+        if (c) {
+            flags |= c->side == myside ? scene::SelectableArea::CellOccupied | scene::SelectableArea::CellAlly
+                                       : scene::SelectableArea::CellOccupied;
+        }
+        return flags;
+    });
+    ai_.resume(0);
+    const auto &plan = ai_.plan();
+    if (plan.moveX >= 0 && (plan.moveX != ch->x || plan.moveY != ch->y)) {
+        cells_[ch->y * width_ + ch->x] = nullptr;
+        ch->x = plan.moveX;
+        ch->y = plan.moveY;
+        cells_[ch->y * width_ + ch->x] = ch;
+        /* Warfield goes through nextAction() again once moving is done */
+        mem::actPoisonDamage(&ch->info);
+    }
+    switch (plan.action) {
+    case scene::BattleAI::Plan::UseItem: {
+        std::map<mem::PropType, std::int16_t> changes;
+        bool usedItem = false;
+        if (plan.itemId >= 0) {
+            if (ch->side == 1) {
+                usedItem = mem::useNpcItem(&ch->info, plan.itemId, changes);
+            } else {
+                usedItem = mem::useItem(&ch->info, plan.itemId, changes);
+            }
+        }
+        if (!usedItem) { mem::actRest(&ch->info); }
+        break;
+    }
+    case scene::BattleAI::Plan::Skill:
+        useSkill(ch, plan);
+        break;
+    default:
+        mem::actRest(&ch->info);
+        break;
+    }
+}
+
+void Battle::useSkill(CharInfo *ch, const scene::BattleAI::Plan &plan) {
+    auto index = plan.skillIndex;
+    const auto *skill = mem::gSaveData.skillInfo[ch->info.skillId[index]];
+    if (!skill) { return; }
+    std::int16_t level = mem::calcRealSkillLevel(skill->reqMp,
+                                                 std::clamp<std::int16_t>(ch->info.skillLevel[index] / 100, 0, 9),
+                                                 ch->info.mp);
+    if (level < 0) { return; }
+    int direction = 0, tx, ty;
+    if (plan.targetY < 0) {
+        direction = plan.targetX;
+        tx = ch->x; ty = ch->y;
+    } else {
+        tx = plan.targetX; ty = plan.targetY;
+    }
+    int attackTimesLeft = ch->info.doubleAttack ? 2 : 1;
+    for (;;) {
+        scene::forEachSkillCell(skill->attackAreaType, skill->selRange[level], skill->area[level],
+                                ch->x, ch->y, direction, tx, ty, width_, height_,
+                                [this, ch, index, level](int x, int y, int distance) {
+            makeDamage(ch, x, y, distance, index, level);
+        });
+        bool levelup = false;
+        mem::postDamage(&ch->info, index, attackTimesLeft == 1 ? 3 : 0, levelup);
+        if (levelup) {
+            level = std::clamp<std::int16_t>(ch->info.skillLevel[index] / 100, 0, 9);
+        }
+        if (--attackTimesLeft <= 0) { break; }
+        level = mem::calcRealSkillLevel(skill->reqMp, level, ch->info.mp);
+        if (level < 0) { break; }
+    }
+}
+
+void Battle::makeDamage(CharInfo *ch, int x, int y, int distance, std::int16_t index, std::int16_t level) {
+    auto *target = cells_[y * width_ + x];
+    if (!target || target->side == ch->side) { return; }
+    std::int16_t dmg, ps;
+    bool dead = false;
+    bool wasDead = target->info.hp <= 0;
+    if (mem::actDamage(&ch->info, &target->info, knowledge_[0], knowledge_[1],
+                       distance, index, level, dmg, ps, dead) && !wasDead && dead) {
+        recalcKnowledge();
+    }
+}
+
+void Battle::recalcKnowledge() {
+    knowledge_[0] = knowledge_[1] = 0;
+    for (auto &ci: chars_) {
+        if (ci.info.hp > 0 && ci.info.knowledge >= data::KnowledgeBarrier) {
+            knowledge_[ci.side] += ci.info.knowledge;
+        }
+    }
+}
+
+int Battle::endTurn() {
+    charQueue_.pop_back();
+    int aliveCount[2] = {0, 0};
+    for (auto &ci: chars_) {
+        if (ci.info.hp > 0) {
+            ++aliveCount[ci.side];
+        } else if (ci.x >= 0) {
+            cells_[ci.x + ci.y * width_] = nullptr;
+            ci.x = ci.y = -1;
+        }
+    }
+    if (aliveCount[1] == 0) { return 0; }
+    if (aliveCount[0] == 0) { return 1; }
+    return -1;
+}
+
+struct WarStats {
+    int battles = 0, wins = 0, losses = 0, draws = 0;
+    std::int64_t rounds = 0, turns = 0, survivors = 0, members = 0, hp = 0, maxHp = 0;
+};
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fmt::print(stderr, "usage: {} <warId|all> [battles=100] [threads=cpu count] [save slot=0(new game)] [seed=1]\n", argv[0]);
+        return 1;
+    }
+    int battles = argc > 2 ? std::max(1, std::atoi(argv[2])) : 100;
+    int threads = argc > 3 ? std::atoi(argv[3]) : 0;
+    if (threads <= 0) { threads = std::max(1, int(std::thread::hardware_concurrency())); }
+    int slot = argc > 4 ? std::atoi(argv[4]) : 0;
+    std::uint64_t seed = argc > 5 ? std::max<std::uint64_t>(1, std::strtoull(argv[5], nullptr, 10)) : 1;
+
+    if (!core::config.load("config.toml")) { return -1; }
+    if (!core::config.postLoad()) { return -1; }
+    data::gFactors.load("Z.DAT");
+    data::gWarfieldData.load("WAR.STA", "WARFLD");
+    /* loaded once here, then copied into gSaveData of each worker thread */
+    if (!mem::gSaveData.load(slot)) {
+        fmt::print(stderr, "Unable to load save slot {}\n", slot);
+        return -1;
+    }
+    const auto baseSave = mem::gSaveData;
+    auto engine = util::Random::engineFromName(core::config.randomEngine());
+
+    std::vector<std::int16_t> warIds;
+    if (std::string(argv[1]) == "all") {
+        for (size_t i = 0; i < data::gWarfieldData.size(); ++i) { warIds.push_back(std::int16_t(i)); }
+    } else {
+        auto warId = std::int16_t(std::atoi(argv[1]));
+        if (!data::gWarfieldData.info(warId)) {
+            fmt::print(stderr, "Invalid warId {}\n", warId);
+            return 1;
+        }
+        warIds.push_back(warId);
+    }
+
+    /* battle n of each warfield always uses seed + n, so results do not depend on thread count */
+    int total = int(warIds.size()) * battles;
+    std::vector<BattleResult> results(total);
+    std::vector<std::uint8_t> valid(total, 0);
+    std::atomic<int> next {0};
+    auto startTime = std::chrono::steady_clock::now();
+    auto worker = [&]() {
+        mem::gSaveData = baseSave;
+        Battle battle;
+        for (;;) {
+            int n = next.fetch_add(1);
+            if (n >= total) { break; }
+            auto warId = warIds[n / battles];
+            mem::gBag.syncFromSave();
+            util::seedRandom(seed + std::uint64_t(n % battles), engine);
+            if (!battle.load(warId)) { continue; }
+            results[n] = battle.run();
+            valid[n] = 1;
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; ++i) { workers.emplace_back(worker); }
+    worker();
+    for (auto &t: workers) { t.join(); }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    fmt::print("{:>5} {:>7} {:>6} {:>6} {:>6} {:>7} {:>7} {:>9} {:>6}\n",
+               "warId", "battles", "win%", "lose%", "draw%", "rounds", "turns", "survivors", "hp%");
+    for (size_t w = 0; w < warIds.size(); ++w) {
+        WarStats st;
+        for (int i = 0; i < battles; ++i) {
+            auto n = int(w) * battles + i;
+            if (!valid[n]) { continue; }
+            const auto &r = results[n];
+            ++st.battles;
+            if (r.winner == 0) { ++st.wins; }
+            else if (r.winner == 1) { ++st.losses; }
+            else { ++st.draws; }
+            st.rounds += r.rounds;
+            st.turns += r.turns;
+            st.survivors += r.survivors;
+            st.members += r.members;
+            st.hp += r.hp;
+            st.maxHp += r.maxHp;
+        }
+        if (!st.battles) { continue; }
+        auto pct = [&st](std::int64_t n) { return 100.0 * double(n) / double(st.battles); };
+        fmt::print("{:>5} {:>7} {:>6.1f} {:>6.1f} {:>6.1f} {:>7.1f} {:>7.1f} {:>4}/{:<4} {:>6.1f}\n",
+                   warIds[w], st.battles, pct(st.wins), pct(st.losses), pct(st.draws),
+                   double(st.rounds) / st.battles, double(st.turns) / st.battles,
+                   fmt::format("{:.1f}", double(st.survivors) / st.battles),
+                   fmt::format("{:.1f}", double(st.members) / st.battles),
+                   st.maxHp ? 100.0 * double(st.hp) / double(st.maxHp) : 0.0);
+    }
+    fmt::print("{} battles on {} threads in {:.2f}s ({:.1f} battles/s)\n",
+               total, threads, elapsed, double(total) / std::max(elapsed, 1e-9));
+    return 0;
+}
@@ -0,0 +1,294 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Headless benchmark: replays a scripted session through the real scene code
+ * with SDL dummy video/audio drivers, and reports per-scene frame times as JSON
+ *
+ * usage: hojy-bench [script=bench.txt] [-o output.json, `-` for stdout]
+ */
+
+#include "core/config.hh"
+#include "mem/strings.hh"
+#include "scene/window.hh"
+#include "scene/warfield.hh"
+#include "util/random.hh"
+#include <SDL.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+using namespace hojy;
+
+struct Command {
+    enum Type {
+        Scene,
+        Key,
+        Wait,
+        Load,
+        SubMap,
+        GlobalMap,
+        War,
+        Auto,
+        Until,
+        Quit,
+    };
+    Type type;
+    std::string arg;
+    int count = 1;
+    scene::Node::Key key = scene::Node::KeyNone;
+};
+
+static bool parseKey(const std::string &name, scene::Node::Key &key) {
+    static const std::pair<const char*, scene::Node::Key> keys[] = {
+        {"up", scene::Node::KeyUp}, {"down", scene::Node::KeyDown},
+        {"left", scene::Node::KeyLeft}, {"right", scene::Node::KeyRight},
+        {"ok", scene::Node::KeyOK}, {"cancel", scene::Node::KeyCancel},
+        {"space", scene::Node::KeySpace}, {"backspace", scene::Node::KeyBackspace},
+    };
+    for (auto &p: keys) {
+        if (name == p.first) {
+            key = p.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool loadScript(const std::string &filename, std::vector<Command> &cmds) {
+    std::ifstream ifs(filename);
+    if (!ifs.is_open()) {
+        fmt::print(stderr, "Unable to open script {}\n", filename);
+        return false;
+    }
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(ifs, line)) {
+        ++lineNo;
+        auto pos = line.find('#');
+        if (pos != std::string::npos) { line.erase(pos); }
+        std::istringstream iss(line);
+        std::string op;
+        if (!(iss >> op)) { continue; }
+        Command cmd {};
+        bool ok = true;
+        if (op == "scene") {
+            cmd.type = Command::Scene;
+            ok = bool(iss >> cmd.arg);
+        } else if (op == "key") {
+            cmd.type = Command::Key;
+            std::string name;
+            ok = (iss >> name) && parseKey(name, cmd.key);
+            if (!(iss >> cmd.count)) { cmd.count = 1; }
+        } else if (op == "wait") {
+            cmd.type = Command::Wait;
+            ok = bool(iss >> cmd.count);
+        } else if (op == "load") {
+            cmd.type = Command::Load;
+            ok = bool(iss >> cmd.count);
+        } else if (op == "submap") {
+            cmd.type = Command::SubMap;
+            ok = bool(iss >> cmd.arg);
+            if (!(iss >> cmd.count)) { cmd.count = 0; }
+        } else if (op == "global") {
+            cmd.type = Command::GlobalMap;
+            if (!(iss >> cmd.count)) { cmd.count = 0; }
+        } else if (op == "war") {
+            cmd.type = Command::War;
+            ok = bool(iss >> cmd.arg);
+        } else if (op == "auto") {
+            cmd.type = Command::Auto;
+        } else if (op == "until") {
+            cmd.type = Command::Until;
+            ok = bool(iss >> cmd.arg) && (cmd.arg == "globalmap" || cmd.arg == "submap" || cmd.arg == "warfield");
+            if (!(iss >> cmd.count)) { cmd.count = 100000; }
+            std::string name;
+            if (iss >> name) { ok = ok && parseKey(name, cmd.key); }
+        } else if (op == "quit") {
+            cmd.type = Command::Quit;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fmt::print(stderr, "{}:{}: invalid command: {}\n", filename, lineNo, line);
+            return false;
+        }
+        cmds.emplace_back(std::move(cmd));
+    }
+    return true;
+}
+
+struct SceneStat {
+    std::string name;
+    std::vector<double> frames;
+};
+
+static double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty()) { return 0.; }
+    auto idx = size_t(std::ceil(p * double(sorted.size()))) - 1;
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+static std::string toJson(const std::string &script, double startupMs, double firstFrameMs, std::vector<SceneStat> &stats) {
+    std::string res = fmt::format("{{\n  \"script\": \"{}\",\n  \"startup_ms\": {:.3f},\n  \"first_frame_ms\": {:.3f},\n  \"scenes\": [",
+                                  script, startupMs, firstFrameMs);
+    bool first = true;
+    for (auto &st: stats) {
+        if (st.frames.empty()) { continue; }
+        auto &f = st.frames;
+        double total = 0.;
+        for (auto v: f) { total += v; }
+        std::sort(f.begin(), f.end());
+        res += fmt::format("{}\n    {{\"name\": \"{}\", \"frames\": {}, \"mean\": {:.3f}, \"p50\": {:.3f}, \"p95\": {:.3f}, \"p99\": {:.3f}, \"max\": {:.3f}}}",
+                           first ? "" : ",", st.name, f.size(), total / double(f.size()),
+                           percentile(f, .5), percentile(f, .95), percentile(f, .99), f.back());
+        first = false;
+    }
+    res += "\n  ]\n}\n";
+    return res;
+}
+
+int main(int argc, char *argv[]) {
+    std::string scriptFile = "bench.txt", outFile = "bench.json";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            outFile = argv[++i];
+        } else {
+            scriptFile = arg;
+        }
+    }
+    std::vector<Command> cmds;
+    if (!loadScript(scriptFile, cmds)) { return 1; }
+
+    /* keep drivers from environment if set, so that offscreen or real drivers can be benchmarked too */
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+
+    core::config.load("config.toml");
+    core::config.load(core::config.saveFilePath("options.toml"));
+    core::config.postLoad();
+    mem::gStrings.load("strings.toml");
+    core::config.fixOnTextLoaded();
+    /* fixed seed unless one is configured, so runs of a script play out the same */
+    util::seedRandom(core::config.randomSeed() ? core::config.randomSeed() : 1,
+                     util::Random::engineFromName(core::config.randomEngine()));
+    auto startupStart = std::chrono::steady_clock::now();
+    scene::Window win(core::config.windowWidth(), core::config.windowHeight());
+    /* scripted input needs game data, and frame times should not include loading */
+    win.finishLoading();
+    auto startupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupStart).count();
+
+    std::vector<SceneStat> stats {{"default", {}}};
+    auto *curr = &stats.back();
+    auto runFrame = [&win, &curr]()->bool {
+        auto start = std::chrono::steady_clock::now();
+        win.update();
+        win.render();
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        curr->frames.push_back(elapsed);
+        if (!win.processEvents()) { return false; }
+        while (!win.flush()) {}
+        return true;
+    };
+    bool running = true;
+    for (auto &cmd: cmds) {
+        if (!running) { break; }
+        switch (cmd.type) {
+        case Command::Scene: {
+            auto ite = std::find_if(stats.begin(), stats.end(), [&cmd](const SceneStat &st) { return st.name == cmd.arg; });
+            if (ite == stats.end()) {
+                stats.emplace_back(SceneStat {cmd.arg, {}});
+                curr = &stats.back();
+            } else {
+                curr = &*ite;
+            }
+            break;
+        }
+        case Command::Key:
+            for (int i = 0; i < cmd.count && running; ++i) {
+                win.injectKey(cmd.key);
+                running = runFrame();
+            }
+            break;
+        case Command::Wait:
+            for (int i = 0; i < cmd.count && running; ++i) {
+                running = runFrame();
+            }
+            break;
+        case Command::Load:
+            win.closePopup();
+            if (!win.loadGame(cmd.count)) {
+                fmt::print(stderr, "Unable to load save slot {}\n", cmd.count);
+                running = false;
+            }
+            break;
+        case Command::SubMap:
+            win.enterSubMap(std::int16_t(std::stoi(cmd.arg)), cmd.count);
+            break;
+        case Command::GlobalMap:
+            win.exitToGlobalMap(cmd.count);
+            break;
+        case Command::War:
+            win.enterWar(std::int16_t(std::stoi(cmd.arg)), true);
+            break;
+        case Command::Auto:
+            dynamic_cast<scene::Warfield*>(win.warfield())->setAutoControl(true);
+            break;
+        case Command::Until: {
+            const scene::Node *target = cmd.arg == "globalmap" ? static_cast<const scene::Node*>(win.globalMap())
+                : cmd.arg == "submap" ? static_cast<const scene::Node*>(win.subMap()) : win.warfield();
+            int i = 0;
+            for (; i < cmd.count && running; ++i) {
+                if (win.currentMap() == target && !win.hasPopup()) { break; }
+                /* confirm popups (messages, talks) while waiting */
+                if (cmd.key != scene::Node::KeyNone && win.hasPopup() && i % 15 == 14) {
+                    win.injectKey(cmd.key);
+                }
+                running = runFrame();
+            }
+            if (i >= cmd.count) {
+                fmt::print(stderr, "Timeout waiting for {}\n", cmd.arg);
+            }
+            break;
+        }
+        case Command::Quit:
+            running = false;
+            break;
+        }
+    }
+
+    auto json = toJson(scriptFile, startupMs, double(win.firstFrameTime()) / 1000., stats);
+    if (outFile == "-") {
+        fmt::print("{}", json);
+    } else {
+        auto *f = fopen(outFile.c_str(), "wt");
+        if (!f) {
+            fmt::print(stderr, "Unable to write {}\n", outFile);
+            return 1;
+        }
+        fputs(json.c_str(), f);
+        fclose(f);
+        fmt::print("Frame times written to {}\n", outFile);
+    }
+    return 0;
+}
@@ -63,6 +63,12 @@ bool Config::load(const std::string &filename) {
             }
         }
         shipLogicEnabled_ = main["ship_logic_enabled"].value_or<bool>(std::forward<bool>(shipLogicEnabled_));
+        fightCacheSize_ = main["fight_cache_size"].value_or<int>(std::forward<int>(fightCacheSize_));
+        mmapData_ = main["mmap_data"].value_or<bool>(std::forward<bool>(mmapData_));
+        archive_ = main["archive"].value_or(std::move(archive_));
+        aiWorkPerFrame_ = main["ai_work_per_frame"].value_or<int>(std::forward<int>(aiWorkPerFrame_));
+        randomSeed_ = std::uint64_t(main["random_seed"].value_or<std::int64_t>(std::int64_t(randomSeed_)));
+        randomEngine_ = main["random_engine"].value_or(std::move(randomEngine_));
     }
     auto window = tbl["window"];
     if (window) {
@@ -70,6 +76,9 @@ bool Config::load(const std::string &filename) {
         windowHeight_ = window["height"].value_or<int>(std::forward<int>(windowHeight_));
         showFPS_ = window["show_fps"].value_or<bool>(std::forward<bool>(showFPS_));
         limitFPS_ = window["limit_fps"].value_or<int>(std::forward<int>(limitFPS_));
+        gpuMapRender_ = window["gpu_map_render"].value_or<bool>(std::forward<bool>(gpuMapRender_));
+        showProfiler_ = window["show_profiler"].value_or<bool>(std::forward<bool>(showProfiler_));
+        profilerTrace_ = window["profiler_trace"].value_or(std::move(profilerTrace_));
     }
     auto ui = tbl["ui"];
     if (ui) {
@@ -95,6 +104,7 @@ bool Config::load(const std::string &filename) {
         }
         musicVolume_ = audio["music_volume"].value_or<int>(std::forward<int>(musicVolume_));
         soundVolume_ = audio["sound_volume"].value_or<int>(std::forward<int>(soundVolume_));
+        musicDecodeAhead_ = audio["music_decode_ahead"].value_or<int>(std::forward<int>(musicDecodeAhead_));
     }
 
     auto fixPath = [](std::string &path) {
@@ -155,31 +165,30 @@ void Config::fixOnTextLoaded() {
     }
 }
 
-std::string Config::dataFilePath(const std::string &filename) const {
-    auto fn = gResourceMgr.getFilePath(filename);
-    if (!fn.empty()) { return fn; }
+Config::FilePath Config::dataFilePath(const std::string &filename) const {
+    if (const auto *fn = gResourceMgr.getFilePath(filename)) { return FilePath(fn); }
     if (dataPath_.empty()) {
-        return filename;
+        return FilePath(filename);
     }
-    return dataPath_[0] + filename;
+    return FilePath(dataPath_[0] + filename);
 }
 
-std::string Config::musicFilePath(const std::string &filename) const {
-    auto fn = gResourceMgr.getFilePath(filename);
-    if (!fn.empty()) { return fn; }
-    return musicPath_.empty() ? dataFilePath(filename) : musicPath_ + filename;
+Config::FilePath Config::musicFilePath(const std::string &filename) const {
+    if (musicPath_.empty()) { return dataFilePath(filename); }
+    if (const auto *fn = gResourceMgr.getFilePath(filename)) { return FilePath(fn); }
+    return FilePath(musicPath_ + filename);
 }
 
-std::string Config::soundFilePath(const std::string &filename) const {
-    auto fn = gResourceMgr.getFilePath(filename);
-    if (!fn.empty()) { return fn; }
-    return soundPath_.empty() ? dataFilePath(filename) : soundPath_ + filename;
+Config::FilePath Config::soundFilePath(const std::string &filename) const {
+    if (soundPath_.empty()) { return dataFilePath(filename); }
+    if (const auto *fn = gResourceMgr.getFilePath(filename)) { return FilePath(fn); }
+    return FilePath(soundPath_ + filename);
 }
 
-std::string Config::saveFilePath(const std::string &filename) const {
-    auto fn = gResourceMgr.getFilePath(filename);
-    if (!fn.empty()) { return fn; }
-    return savePath_.empty() ? dataFilePath(filename) : savePath_ + filename;
+Config::FilePath Config::saveFilePath(const std::string &filename) const {
+    if (savePath_.empty()) { return dataFilePath(filename); }
+    if (const auto *fn = gResourceMgr.getFilePath(filename)) { return FilePath(fn); }
+    return FilePath(savePath_ + filename);
 }
 
 }
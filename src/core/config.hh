@@ -21,6 +21,8 @@
 
 #include <string>
 #include <vector>
+#include <utility>
+#include <cstdint>
 
 namespace hojy::core {
 
@@ -31,11 +33,25 @@ public:
     bool postLoad();
     void fixOnTextLoaded();
 
-    [[nodiscard]] std::string dataFilePath(const std::string &filename) const;
+    /* indexed files refer to the path kept in ResourceMgr without copying,
+     * others own the joined path */
+    class FilePath {
+    public:
+        explicit FilePath(const std::string *indexed): indexed_(indexed) {}
+        explicit FilePath(std::string joined): joined_(std::move(joined)) {}
+        [[nodiscard]] const std::string &str() const { return indexed_ ? *indexed_ : joined_; }
+        operator const std::string &() const { return str(); }
 
-    [[nodiscard]] std::string musicFilePath(const std::string &filename) const;
-    [[nodiscard]] std::string soundFilePath(const std::string &filename) const;
-    [[nodiscard]] std::string saveFilePath(const std::string &filename) const;
+    private:
+        const std::string *indexed_ = nullptr;
+        std::string joined_;
+    };
+
+    [[nodiscard]] FilePath dataFilePath(const std::string &filename) const;
+
+    [[nodiscard]] FilePath musicFilePath(const std::string &filename) const;
+    [[nodiscard]] FilePath soundFilePath(const std::string &filename) const;
+    [[nodiscard]] FilePath saveFilePath(const std::string &filename) const;
 
     [[nodiscard]] const std::vector<std::string> &dataPath() const { return dataPath_; }
     [[nodiscard]] const std::vector<std::string> &fonts() const { return fonts_; }
@@ -44,6 +60,12 @@ public:
     [[nodiscard]] const std::string &savePath() const { return savePath_; }
 
     [[nodiscard]] bool shipLogicEnabled() const { return shipLogicEnabled_; }
+    [[nodiscard]] int fightCacheSize() const { return fightCacheSize_; }
+    [[nodiscard]] bool mmapData() const { return mmapData_; }
+    [[nodiscard]] const std::string &archive() const { return archive_; }
+    [[nodiscard]] int aiWorkPerFrame() const { return aiWorkPerFrame_; }
+    [[nodiscard]] std::uint64_t randomSeed() const { return randomSeed_; }
+    [[nodiscard]] const std::string &randomEngine() const { return randomEngine_; }
 
     [[nodiscard]] int windowWidth() const { return windowWidth_; }
     [[nodiscard]] int windowHeight() const { return windowHeight_; }
@@ -63,6 +85,9 @@ public:
 
     [[nodiscard]] bool showFPS() const { return showFPS_; }
     [[nodiscard]] int limitFPS() const { return limitFPS_; }
+    [[nodiscard]] bool gpuMapRender() const { return gpuMapRender_; }
+    [[nodiscard]] bool showProfiler() const { return showProfiler_; }
+    [[nodiscard]] const std::string &profilerTrace() const { return profilerTrace_; }
 
     [[nodiscard]] int sampleRate() const { return sampleRate_; }
     [[nodiscard]] int sampleFormat() const { return sampleFormat_; }
@@ -71,11 +96,18 @@ public:
     void setMusicVolume(int volume) { musicVolume_ = volume; }
     [[nodiscard]] int soundVolume() const { return soundVolume_; }
     void setSoundVolume(int volume) { soundVolume_ = volume; }
+    [[nodiscard]] int musicDecodeAhead() const { return musicDecodeAhead_; }
 
 private:
     std::vector<std::string> dataPath_, fonts_;
     std::string musicPath_, soundPath_, savePath_;
     bool shipLogicEnabled_ = true;
+    int fightCacheSize_ = 16;
+    bool mmapData_ = true;
+    std::string archive_ = "DATA.PAK";
+    int aiWorkPerFrame_ = 8192;
+    std::uint64_t randomSeed_ = 0;
+    std::string randomEngine_ = "mt19937_64";
     int windowWidth_ = 640, windowHeight_ = 480;
     bool simplifiedChinese_ = false;
     bool showPotential_ = false;
@@ -89,10 +121,14 @@ private:
     std::wstring defaultName_;
     bool showFPS_ = false;
     int limitFPS_ = 0;
+    bool gpuMapRender_ = false;
+    bool showProfiler_ = false;
+    std::string profilerTrace_;
     int sampleRate_ = 0;
     int sampleFormat_ = 0;
     int musicVolume_ = 5;
     int soundVolume_ = 5;
+    int musicDecodeAhead_ = 200;
 };
 
 extern Config config;
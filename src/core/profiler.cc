@@ -0,0 +1,107 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.hh"
+
+#if defined(USE_PROFILER)
+
+#include <fmt/format.h>
+#include <cstring>
+
+namespace hojy::core {
+
+Profiler gProfiler;
+
+Profiler::Profiler(): owner_(std::this_thread::get_id()), origin_(Clock::now()) {
+}
+
+Profiler::~Profiler() {
+    stopTrace();
+}
+
+bool Profiler::startTrace(const std::string &filename) {
+    stopTrace();
+    trace_ = fopen(filename.c_str(), "wt");
+    if (!trace_) { return false; }
+    /* Chrome trace_event array format, can be loaded in chrome://tracing or Perfetto */
+    fputs("[\n", trace_);
+    firstEvent_ = true;
+    return true;
+}
+
+void Profiler::stopTrace() {
+    if (!trace_) { return; }
+    fputs("\n]\n", trace_);
+    fclose(trace_);
+    trace_ = nullptr;
+}
+
+size_t Profiler::begin(const char *name) {
+    /* only game thread is profiled */
+    if (std::this_thread::get_id() != owner_) { return size_t(-1); }
+    size_t sz = phases_.size();
+    size_t index = 0;
+    for (; index < sz; ++index) {
+        auto *n = phases_[index].name;
+        if (n == name || strcmp(n, name) == 0) { break; }
+    }
+    if (index == sz) {
+        phases_.emplace_back(Phase {name});
+    }
+    ++phases_[index].active;
+    return index;
+}
+
+void Profiler::end(size_t index, Clock::time_point start) {
+    if (index >= phases_.size()) { return; }
+    auto now = Clock::now();
+    auto &phase = phases_[index];
+    /* nested scopes of the same phase (e.g. Node::doRender of children) are counted once */
+    if (--phase.active == 0) {
+        phase.frameMs += std::chrono::duration<double, std::milli>(now - start).count();
+    }
+    if (trace_) {
+        auto ts = std::chrono::duration<double, std::micro>(start - origin_).count();
+        auto dur = std::chrono::duration<double, std::micro>(now - start).count();
+        fmt::print(trace_, "{}{{\"name\":\"{}\",\"ph\":\"X\",\"ts\":{:.1f},\"dur\":{:.1f},\"pid\":1,\"tid\":1}}",
+                   firstEvent_ ? "" : ",\n", phase.name, ts, dur);
+        firstEvent_ = false;
+    }
+}
+
+void Profiler::frameEnd() {
+    if (std::this_thread::get_id() != owner_) { return; }
+    for (auto &phase: phases_) {
+        auto &slot = phase.history[frameIndex_];
+        phase.rollingSum += phase.frameMs - slot;
+        slot = phase.frameMs;
+        phase.frameMs = 0.;
+    }
+    frameIndex_ = (frameIndex_ + 1) % RollingFrames;
+    if (trace_) {
+        auto ts = std::chrono::duration<double, std::micro>(Clock::now() - origin_).count();
+        fmt::print(trace_, "{}{{\"name\":\"frame\",\"ph\":\"i\",\"s\":\"g\",\"ts\":{:.1f},\"pid\":1,\"tid\":1}}",
+                   firstEvent_ ? "" : ",\n", ts);
+        firstEvent_ = false;
+    }
+}
+
+}
+
+#endif
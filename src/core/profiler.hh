@@ -0,0 +1,98 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+/* Frame phase profiler, enabled by cmake option USE_PROFILER.
+ * PROFILE_SCOPE(name) times the rest of enclosing scope, PROFILE_FRAME_END() closes a frame,
+ * both expand to nothing when profiler is disabled */
+
+#if defined(USE_PROFILER)
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdio>
+
+namespace hojy::core {
+
+class Profiler final {
+public:
+    using Clock = std::chrono::steady_clock;
+    enum {
+        RollingFrames = 60,
+    };
+    struct Phase {
+        const char *name;
+        int active = 0;
+        double frameMs = 0.;
+        double history[RollingFrames] = {};
+        double rollingSum = 0.;
+    };
+
+public:
+    Profiler();
+    ~Profiler();
+
+    bool startTrace(const std::string &filename);
+    void stopTrace();
+
+    size_t begin(const char *name);
+    void end(size_t index, Clock::time_point start);
+    void frameEnd();
+
+    [[nodiscard]] inline const std::vector<Phase> &phases() const { return phases_; }
+    /* average milliseconds per frame in last RollingFrames frames */
+    [[nodiscard]] static inline double average(const Phase &phase) { return phase.rollingSum / RollingFrames; }
+
+private:
+    std::vector<Phase> phases_;
+    size_t frameIndex_ = 0;
+    std::thread::id owner_;
+    Clock::time_point origin_;
+    FILE *trace_ = nullptr;
+    bool firstEvent_ = true;
+};
+
+extern Profiler gProfiler;
+
+class ProfileScope final {
+public:
+    explicit inline ProfileScope(const char *name): index_(gProfiler.begin(name)), start_(Profiler::Clock::now()) {}
+    inline ~ProfileScope() { gProfiler.end(index_, start_); }
+
+private:
+    size_t index_;
+    Profiler::Clock::time_point start_;
+};
+
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ::hojy::core::ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#define PROFILE_FRAME_END() ::hojy::core::gProfiler.frameEnd()
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+
+#endif
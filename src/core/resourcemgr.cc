@@ -21,133 +21,201 @@
 
 #include "config.hh"
 #include <fmt/format.h>
+#include <algorithm>
 #include <filesystem>
+#include <vector>
+#include <cctype>
 
 namespace hojy::core {
 
 ResourceMgr gResourceMgr;
 
-void ResourceMgr::init() {
-    const std::set<std::string, StringCaseInsensitiveLess> dataFiles = {
-        /* strings.toml */
-        "strings.toml",
-        /* default def file */
-        "ALLDEF.GRP", "ALLDEF.IDX",
-        /* default sin file */
-        "ALLSIN.GRP", "ALLSIN.IDX",
-        /* global map data */
-        "BUILDING.002", "BUILDX.002", "BUILDY.002", "EARTH.002", "SURFACE.002",
-        /* cloud textures */
-        "CLOUD.GRP", "CLOUD.IDX",
-        /* dead screen */
-        "DEAD.BIG",
-        /* effect textures */
-        "EFT.GRP", "EFT.IDX",
-        /* end screen */
-        "ENDCOL.COL", "ENDWORD.GRP", "ENDWORD.IDX", "KEND.GRP", "KEND.IDX",
-        /* head textures */
-        "HDGRP.GRP", "HDGRP.IDX",
-        /* event defs */
-        "KDEF.GRP", "KDEF.IDX",
-        /* global map data */
-        "MMAP.COL", "MMAP.GRP", "MMAP.IDX",
-        /* default ranger file */
-        "RANGER.GRP", "RANGER.IDX",
-        /* talk data */
-        "TALK.GRP", "TALK.IDX",
-        /* title screen */
-        "TITLE.BIG", "TITLE.GRP", "TITLE.IDX",
-        /* warfield data and textures */
-        "WAR.STA", "WARFLD.GRP", "WARFLD.IDX",
-        /* main program, we reads some important values from it */
-        "Z.DAT",
-    }, dataFilesOpt = {
-        /* sub map textures */
-        "SDX", "SMP",
-        /* warfield textures */
-        "WDX", "WMP",
-    }, musicFiles = {
-        /* music */
-        "GAME01.XMI", "GAME02.XMI", "GAME03.XMI", "GAME04.XMI", "GAME05.XMI", "GAME06.XMI",
-        "GAME07.XMI", "GAME08.XMI", "GAME09.XMI", "GAME10.XMI", "GAME11.XMI", "GAME12.XMI",
-        "GAME13.XMI", "GAME14.XMI", "GAME15.XMI", "GAME16.XMI", "GAME17.XMI", "GAME18.XMI",
-        "GAME19.XMI", "GAME20.XMI", "GAME21.XMI", "GAME22.XMI", "GAME23.XMI", "GAME24.XMI",
-    }, soundFiles = {
-        /* sound */
-        "ATK00.WAV", "ATK01.WAV", "ATK02.WAV", "ATK03.WAV", "ATK04.WAV", "ATK05.WAV", "ATK06.WAV",
-        "ATK07.WAV", "ATK08.WAV", "ATK09.WAV", "ATK10.WAV", "ATK11.WAV", "ATK12.WAV", "ATK13.WAV",
-        "ATK14.WAV", "ATK15.WAV", "ATK16.WAV", "ATK17.WAV", "ATK18.WAV", "ATK19.WAV", "ATK20.WAV",
-        "ATK21.WAV", "ATK22.WAV", "ATK23.WAV",
-        "E00.WAV", "E01.WAV", "E02.WAV", "E03.WAV", "E04.WAV", "E05.WAV", "E06.WAV", "E07.WAV", "E08.WAV",
-        "E09.WAV", "E10.WAV", "E11.WAV", "E12.WAV", "E13.WAV", "E14.WAV", "E15.WAV", "E16.WAV", "E17.WAV",
-        "E18.WAV", "E19.WAV", "E20.WAV", "E21.WAV", "E22.WAV", "E23.WAV", "E24.WAV", "E25.WAV", "E26.WAV",
-        "E27.WAV", "E28.WAV", "E29.WAV", "E30.WAV", "E31.WAV", "E32.WAV", "E33.WAV", "E34.WAV", "E35.WAV",
-        "E36.WAV", "E37.WAV", "E38.WAV", "E39.WAV", "E40.WAV", "E41.WAV", "E42.WAV", "E43.WAV", "E44.WAV",
-        "E45.WAV", "E46.WAV", "E47.WAV", "E48.WAV", "E49.WAV", "E50.WAV", "E51.WAV", "E52.WAV",
-    }, saveFiles = {
-        "D1.GRP", "D1.IDX", "D2.GRP", "D2.IDX", "D3.GRP", "D3.IDX",
-        "R1.GRP", "R1.IDX", "R2.GRP", "R2.IDX", "R3.GRP", "R3.IDX",
-        "S1.GRP", "S1.IDX", "S2.GRP", "S2.IDX", "S3.GRP", "S3.IDX",
-    };
-    std::set<std::string, StringCaseInsensitiveLess> texFiles;
-    for (int i = 0; i < 1000; ++i) {
-        texFiles.insert(fmt::format("FIGHT{:03}.IDX", i));
-        texFiles.insert(fmt::format("FIGHT{:03}.GRP", i));
-        texFiles.insert(fmt::format("SDX{:03}", i));
-        texFiles.insert(fmt::format("SMP{:03}", i));
-        texFiles.insert(fmt::format("WDX{:03}", i));
-        texFiles.insert(fmt::format("WMP{:03}", i));
+enum : unsigned {
+    CategoryData = 1U,
+    CategoryMusic = 2U,
+    CategorySound = 4U,
+    CategorySave = 8U,
+};
+
+/* no resource file has longer name, longer ones are never indexed */
+constexpr size_t NameMax = 64;
+
+static const std::string_view RequiredDataFiles[] = {
+    /* strings.toml */
+    "strings.toml",
+    /* default def file */
+    "ALLDEF.GRP", "ALLDEF.IDX",
+    /* default sin file */
+    "ALLSIN.GRP", "ALLSIN.IDX",
+    /* global map data */
+    "BUILDING.002", "BUILDX.002", "BUILDY.002", "EARTH.002", "SURFACE.002",
+    /* cloud textures */
+    "CLOUD.GRP", "CLOUD.IDX",
+    /* dead screen */
+    "DEAD.BIG",
+    /* effect textures */
+    "EFT.GRP", "EFT.IDX",
+    /* end screen */
+    "ENDCOL.COL", "ENDWORD.GRP", "ENDWORD.IDX", "KEND.GRP", "KEND.IDX",
+    /* head textures */
+    "HDGRP.GRP", "HDGRP.IDX",
+    /* event defs */
+    "KDEF.GRP", "KDEF.IDX",
+    /* global map data */
+    "MMAP.COL", "MMAP.GRP", "MMAP.IDX",
+    /* default ranger file */
+    "RANGER.GRP", "RANGER.IDX",
+    /* talk data */
+    "TALK.GRP", "TALK.IDX",
+    /* title screen */
+    "TITLE.BIG", "TITLE.GRP", "TITLE.IDX",
+    /* warfield data and textures */
+    "WAR.STA", "WARFLD.GRP", "WARFLD.IDX",
+    /* main program, we reads some important values from it */
+    "Z.DAT",
+};
+
+static const std::string_view OptionalDataFiles[] = {
+    /* sub map textures */
+    "SDX", "SMP",
+    /* warfield textures */
+    "WDX", "WMP",
+};
+
+static const std::string_view SaveFiles[] = {
+    "D1.GRP", "D1.IDX", "D2.GRP", "D2.IDX", "D3.GRP", "D3.IDX",
+    "R1.GRP", "R1.IDX", "R2.GRP", "R2.IDX", "R3.GRP", "R3.IDX",
+    "S1.GRP", "S1.IDX", "S2.GRP", "S2.IDX", "S3.GRP", "S3.IDX",
+};
+
+/* upper-cased copy of name in buf, empty if name is too long */
+static std::string_view foldName(std::string_view name, char (&buf)[NameMax]) {
+    if (name.empty() || name.size() >= NameMax) { return {}; }
+    for (size_t i = 0; i < name.size(); ++i) {
+        buf[i] = char(std::toupper(static_cast<unsigned char>(name[i])));
     }
-    auto fn = [this](const std::string &path,
-                     const std::set<std::string, StringCaseInsensitiveLess> &sset,
-                     const std::set<std::string, StringCaseInsensitiveLess> &sset2) {
-        for (auto &p: std::filesystem::directory_iterator(path)) {
-            if (!p.is_regular_file()) { continue; }
-            auto filename = p.path().filename().string();
-            if (files_.find(filename) != files_.end()) {
-                continue;
-            }
-            {
-                auto ite = sset.find(filename);
-                if (ite != sset.end()) {
-                    files_[*ite] = p.path().string();
-                    continue;
-                }
-            }
-            if (!sset2.empty()) {
-                auto ite = sset2.find(filename);
-                if (ite != sset2.end()) {
-                    files_[*ite] = p.path().string();
-                    continue;
-                }
+    return {buf, name.size()};
+}
+
+static bool isDigits(std::string_view str, size_t count) {
+    return str.size() == count && std::all_of(str.begin(), str.end(), [](char c) { return c >= '0' && c <= '9'; });
+}
+
+static bool hasPrefix(std::string_view str, std::string_view prefix) {
+    return str.substr(0, prefix.size()) == prefix;
+}
+
+/* category of a folded filename, numbered families are matched by pattern, 0 if it is not a resource file */
+static unsigned classify(std::string_view name) {
+    static const auto fixedNames = [] {
+        static std::deque<std::string> folded;
+        std::unordered_map<std::string_view, unsigned> res;
+        auto add = [&res](std::string_view n, unsigned category) {
+            char buf[NameMax];
+            res.emplace(folded.emplace_back(foldName(n, buf)), category);
+        };
+        for (auto n: RequiredDataFiles) { add(n, CategoryData); }
+        for (auto n: OptionalDataFiles) { add(n, CategoryData); }
+        for (auto n: SaveFiles) { add(n, CategorySave); }
+        return res;
+    }();
+    {
+        auto ite = fixedNames.find(name);
+        if (ite != fixedNames.end()) { return ite->second; }
+    }
+    auto pos = name.find('.');
+    auto base = name.substr(0, pos);
+    auto ext = pos == std::string_view::npos ? std::string_view() : name.substr(pos + 1);
+    /* FIGHT???.GRP/IDX */
+    if ((ext == "GRP" || ext == "IDX") && hasPrefix(base, "FIGHT") && isDigits(base.substr(5), 3)) {
+        return CategoryData;
+    }
+    /* SDX???, SMP???, WDX???, WMP??? */
+    if (ext.empty() && base.size() == 6 && isDigits(base.substr(3), 3)) {
+        auto prefix = base.substr(0, 3);
+        if (prefix == "SDX" || prefix == "SMP" || prefix == "WDX" || prefix == "WMP") { return CategoryData; }
+    }
+    /* GAME??.XMI */
+    if (ext == "XMI" && hasPrefix(base, "GAME") && isDigits(base.substr(4), 2)) {
+        return CategoryMusic;
+    }
+    /* ATK??.WAV, E??.WAV */
+    if (ext == "WAV" && ((hasPrefix(base, "ATK") && isDigits(base.substr(3), 2)) || (hasPrefix(base, "E") && isDigits(base.substr(1), 2)))) {
+        return CategorySound;
+    }
+    return 0;
+}
+
+void ResourceMgr::init() {
+    files_.clear();
+    storage_.clear();
+    missingFiles_.clear();
+    missingFilesOpt_.clear();
+    if (!config.archive().empty()) {
+        for (auto &path: config.dataPath()) {
+            if (std::filesystem::is_regular_file(path + config.archive()) && archive_.open(path + config.archive())) {
+                fmt::print("Using archive {} with {} entries\n", path + config.archive(), archive_.size());
+                break;
             }
         }
+    }
+
+    /* each folder is scanned once, earlier ones take precedence */
+    std::vector<std::pair<std::string, unsigned>> dirs;
+    auto addDir = [&dirs](const std::string &path, unsigned categories) {
+        if (path.empty()) { return; }
+        auto ite = std::find_if(dirs.begin(), dirs.end(), [&path](const auto &p) { return p.first == path; });
+        if (ite == dirs.end()) {
+            dirs.emplace_back(path, categories);
+        } else {
+            ite->second |= categories;
+        }
     };
     for (auto &path: config.dataPath()) {
-        fn(path, dataFiles, dataFilesOpt);
-        fn(path, texFiles, {});
+        addDir(path, CategoryData);
     }
-    fn(config.musicPath(), musicFiles, {});
-    fn(config.soundPath(), soundFiles, {});
-    fn(config.savePath(), saveFiles, {});
-    auto fn2 = [this](std::set<std::string> &missingFiles, const std::set<std::string, StringCaseInsensitiveLess> &sset) {
-        for (auto &fn: sset) {
-            if (files_.find(fn) == files_.end()) {
-                missingFiles.insert(fn);
-            }
+    addDir(config.musicPath(), CategoryMusic);
+    addDir(config.soundPath(), CategorySound);
+    addDir(config.savePath(), CategorySave);
+    for (auto &p: dirs) {
+        scanDir(p.first, p.second);
+    }
+
+    for (auto n: RequiredDataFiles) {
+        if (!getFilePath(n) && !archive_.contains(std::string(n))) {
+            missingFiles_.emplace(n);
         }
+    }
+    auto checkOpt = [this](const std::string &n) {
+        if (!getFilePath(n)) { missingFilesOpt_.insert(n); }
     };
-    fn2(missingFiles_, dataFiles);
-    fn2(missingFilesOpt_, musicFiles);
-    fn2(missingFilesOpt_, soundFiles);
+    for (int i = 1; i <= 24; ++i) { checkOpt(fmt::format("GAME{:02}.XMI", i)); }
+    for (int i = 0; i <= 23; ++i) { checkOpt(fmt::format("ATK{:02}.WAV", i)); }
+    for (int i = 0; i <= 52; ++i) { checkOpt(fmt::format("E{:02}.WAV", i)); }
 }
 
-const std::string &ResourceMgr::getFilePath(const std::string &file) const {
-    static const std::string dummy;
-    auto ite = files_.find(file);
-    if (ite == files_.end()) {
-        return dummy;
+void ResourceMgr::scanDir(const std::string &path, unsigned categories) {
+    std::error_code ec;
+    for (auto &p: std::filesystem::directory_iterator(path, ec)) {
+        if (!p.is_regular_file(ec)) { continue; }
+        auto filename = p.path().filename().string();
+        char buf[NameMax];
+        auto folded = foldName(filename, buf);
+        if (folded.empty() || !(classify(folded) & categories) || files_.find(folded) != files_.end()) {
+            continue;
+        }
+        const auto &name = storage_.emplace_back(folded);
+        const auto &fullPath = storage_.emplace_back(p.path().string());
+        files_.emplace(name, &fullPath);
     }
+}
+
+const std::string *ResourceMgr::getFilePath(std::string_view file) const {
+    char buf[NameMax];
+    auto folded = foldName(file, buf);
+    if (folded.empty()) { return nullptr; }
+    auto ite = files_.find(folded);
+    if (ite == files_.end()) { return nullptr; }
     return ite->second;
 }
 
@@ -19,36 +19,34 @@
 
 #pragma once
 
+#include "util/archive.hh"
+
+#include <deque>
 #include <set>
-#include <map>
 #include <string>
-#include <cctype>
+#include <string_view>
+#include <unordered_map>
 
 namespace hojy::core {
 
 class ResourceMgr {
-    struct StringCaseInsensitiveLess {
-        // case-independent (ci) compare_less binary function
-        struct CanseInsensitiveCompare {
-            bool operator() (const unsigned char &c1, const unsigned char &c2) const {
-                return std::tolower(c1) < std::tolower(c2);
-            }
-        };
-        bool operator() (const std::string &s1, const std::string &s2) const {
-            return std::lexicographical_compare(s1.begin (), s1.end (),
-                                                s2.begin (), s2.end (),
-                                                CanseInsensitiveCompare ());
-        }
-    };
 public:
     void init();
     [[nodiscard]] const std::set<std::string> &missingFiles() const { return missingFiles_; }
-    [[nodiscard]] const std::set<std::string> &missingFilesOpt() const { return missingFiles_; }
-    [[nodiscard]] const std::string &getFilePath(const std::string &file) const;
+    [[nodiscard]] const std::set<std::string> &missingFilesOpt() const { return missingFilesOpt_; }
+    /* case-insensitive, returns nullptr if file was not found, the path stays valid until next init() */
+    [[nodiscard]] const std::string *getFilePath(std::string_view file) const;
+    [[nodiscard]] const util::Archive &archive() const { return archive_; }
+
+private:
+    void scanDir(const std::string &path, unsigned categories);
 
 private:
+    util::Archive archive_;
     std::set<std::string> missingFiles_, missingFilesOpt_;
-    std::map<std::string, std::string, StringCaseInsensitiveLess> files_;
+    /* folded name -> path, both pointing into storage_ */
+    std::unordered_map<std::string_view, const std::string*> files_;
+    std::deque<std::string> storage_;
 };
 
 extern ResourceMgr gResourceMgr;
@@ -40,20 +40,24 @@ void Event::loadEvent(const std::string &name) {
 }
 
 void Event::loadTalk(const std::string &name) {
-    if (!GrpData::loadData(name, origTalks_)) { return; }
-    auto sz = origTalks_.size();
-    talks_.resize(sz);
-    for (size_t i = 0; i < sz; ++i) {
-        auto &t = origTalks_[i];
-        for (auto &c: t) {
-            if (c) { c = ~c; }
-        }
-        talks_[i] = util::big5Conv.toUnicode(t.c_str());
+    GrpView view;
+    if (!view.load(name)) { return; }
+    size_t total = 0;
+    for (auto e: view.entries()) {
+        total += e.size() + 1;
     }
-    if (core::config.simplifiedChinese()) {
-        for (auto &t: talks_) {
-            t = util::trad2SimpConv.convert(t);
+    talkData_.clear();
+    talkData_.reserve(total);
+    talkOffsets_.resize(view.size());
+    for (size_t i = 0; i < view.size(); ++i) {
+        talkOffsets_[i] = std::uint32_t(talkData_.size());
+        for (auto c: view[i]) {
+            talkData_ += c ? char(~c) : c;
         }
+        talkData_ += '\0';
+    }
+    for (auto &c: talkCache_) {
+        c.index = size_t(-1);
     }
 }
 
@@ -65,20 +69,56 @@ const std::vector<std::int16_t> &Event::event(size_t index) const {
     return empty;
 }
 
-const std::string &Event::origTalk(size_t index) const {
-    if (index < origTalks_.size()) {
-        return origTalks_[index];
+std::string_view Event::origTalk(size_t index) const {
+    if (index < talkOffsets_.size()) {
+        return talkData_.c_str() + talkOffsets_[index];
     }
-    static std::string empty;
-    return empty;
+    return "";
 }
 
 const std::wstring &Event::talk(size_t index) const {
-    if (index < talks_.size()) {
-        return talks_[index];
+    if (index < talkOffsets_.size()) {
+        auto &cached = talkCache_[index % TalkCacheSize];
+        if (cached.index != index) {
+            cached.text = util::big5Conv.toUnicode(origTalk(index));
+            if (core::config.simplifiedChinese()) {
+                cached.text = util::trad2SimpConv.convert(cached.text);
+            }
+            cached.index = index;
+        }
+        return cached.text;
     }
     static std::wstring empty;
     return empty;
 }
 
+std::wstring Event::talkCharset() const {
+    /* decode each distinct BIG5 code once instead of decoding every talk */
+    std::vector<bool> used(0x10000);
+    const auto *data = reinterpret_cast<const std::uint8_t*>(talkData_.data());
+    size_t sz = talkData_.size();
+    for (size_t i = 0; i < sz; ++i) {
+        auto c = data[i];
+        if (c == 0) { continue; }
+        if (c < 0x80) {
+            used[c] = true;
+        } else if (i + 1 < sz && data[i + 1] != 0) {
+            used[(std::uint32_t(c) << 8) | data[i + 1]] = true;
+            ++i;
+        }
+    }
+    std::string codes;
+    for (std::uint32_t code = 1; code < 0x10000; ++code) {
+        if (!used[code]) { continue; }
+        if (code >= 0x100) { codes += char(code >> 8); }
+        codes += char(code & 0xFF);
+    }
+    auto res = util::big5Conv.toUnicode(codes);
+    if (core::config.simplifiedChinese()) {
+        /* phrases are not matched in a string of distinct chars, so add all chars they may be converted to */
+        res = util::trad2SimpConv.convert(res) + util::Trad2SimpConv::phraseChars();
+    }
+    return res;
+}
+
 }
@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 namespace hojy::data {
@@ -31,13 +32,28 @@ public:
     void loadTalk(const std::string &name);
 
     [[nodiscard]] const std::vector<std::int16_t> &event(size_t index) const;
-    [[nodiscard]] const std::string &origTalk(size_t index) const;
+    /* decrypted BIG5 bytes, terminated by 0 */
+    [[nodiscard]] std::string_view origTalk(size_t index) const;
+    /* decoded on first access and kept in a small cache,
+     * the result is valid until another talk using the same cache slot is decoded */
     [[nodiscard]] const std::wstring &talk(size_t index) const;
+    /* distinct chars used in all talks, for glyph prewarming */
+    [[nodiscard]] std::wstring talkCharset() const;
 
 private:
+    enum {
+        TalkCacheSize = 64,
+    };
+    struct CachedTalk {
+        size_t index = size_t(-1);
+        std::wstring text;
+    };
+
     std::vector<std::vector<std::int16_t>> events_;
-    std::vector<std::string> origTalks_;
-    std::vector<std::wstring> talks_;
+    /* bytes of all talks, each followed by 0, talk `i` starts at talkOffsets_[i] */
+    std::string talkData_;
+    std::vector<std::uint32_t> talkOffsets_;
+    mutable CachedTalk talkCache_[TalkCacheSize];
 };
 
 extern Event gEvent;
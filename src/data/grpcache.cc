@@ -0,0 +1,125 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "grpcache.hh"
+
+#include <fmt/format.h>
+#include <algorithm>
+
+namespace hojy::data {
+
+GrpCache::GrpCache(std::string prefix, size_t count, size_t budget): prefix_(std::move(prefix)), entries_(count), budget_(budget) {
+}
+
+GrpCache::~GrpCache() {
+    {
+        std::unique_lock<std::mutex> lk(mutex_);
+        quit_ = true;
+    }
+    prefetchCond_.notify_one();
+    if (prefetchThread_.joinable()) {
+        prefetchThread_.join();
+    }
+}
+
+GrpCache::DataSetPtr GrpCache::get(std::int16_t index) {
+    if (index < 0 || size_t(index) >= entries_.size()) { return nullptr; }
+    std::unique_lock<std::mutex> lk(mutex_);
+    auto &e = entries_[index];
+    cond_.wait(lk, [&e] { return !e.loading; });
+    if (e.data) {
+        lru_.splice(lru_.begin(), lru_, e.lruIte);
+        return e.data;
+    }
+    return load(lk, index, false);
+}
+
+void GrpCache::prefetch(const std::vector<std::int16_t> &indices) {
+    {
+        std::unique_lock<std::mutex> lk(mutex_);
+        for (auto index: indices) {
+            if (index < 0 || size_t(index) >= entries_.size()) { continue; }
+            auto &e = entries_[index];
+            if (e.data || e.loading || std::find(pending_.begin(), pending_.end(), index) != pending_.end()) { continue; }
+            pending_.push_back(index);
+        }
+        if (pending_.empty()) { return; }
+        if (!prefetchThread_.joinable()) {
+            prefetchThread_ = std::thread([this] { prefetchProc(); });
+        }
+    }
+    prefetchCond_.notify_one();
+}
+
+GrpCache::DataSetPtr GrpCache::load(std::unique_lock<std::mutex> &lk, std::int16_t index, bool prefetching) {
+    auto &e = entries_[index];
+    e.loading = true;
+    lk.unlock();
+    auto dset = std::make_shared<GrpView>();
+    dset->load(fmt::format("{}{:03}", prefix_, index));
+    size_t bytes = sizeof(GrpView) + dset->size() * sizeof(std::string_view) + dset->storageSize();
+    lk.lock();
+    e.loading = false;
+    if (prefetching && used_ + bytes > budget_) {
+        /* would evict sets loaded before, drop it and stop prefetching */
+        pending_.clear();
+        dset.reset();
+    } else {
+        e.data = dset;
+        e.bytes = bytes;
+        lru_.push_front(index);
+        e.lruIte = lru_.begin();
+        used_ += bytes;
+        evict();
+    }
+    lk.unlock();
+    cond_.notify_all();
+    lk.lock();
+    return dset;
+}
+
+void GrpCache::prefetchProc() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    for (;;) {
+        prefetchCond_.wait(lk, [this] { return quit_ || !pending_.empty(); });
+        if (quit_) { break; }
+        auto index = pending_.front();
+        pending_.pop_front();
+        auto &e = entries_[index];
+        if (e.data || e.loading) { continue; }
+        if (used_ >= budget_) {
+            pending_.clear();
+            continue;
+        }
+        load(lk, index, true);
+    }
+}
+
+void GrpCache::evict() {
+    /* never drop the most recent one, sets still in use are kept alive by their shared_ptr */
+    while (used_ > budget_ && lru_.size() > 1) {
+        auto &e = entries_[lru_.back()];
+        used_ -= e.bytes;
+        e.bytes = 0;
+        e.data.reset();
+        lru_.pop_back();
+    }
+}
+
+}
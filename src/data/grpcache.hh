@@ -0,0 +1,75 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "grpdata.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace hojy::data {
+
+/* Numbered GRP sets ({prefix}000.IDX/GRP ...) loaded on demand and kept in a LRU with byte budget */
+class GrpCache final {
+public:
+    using DataSetPtr = std::shared_ptr<const GrpView>;
+
+public:
+    GrpCache(std::string prefix, size_t count, size_t budget);
+    GrpCache(const GrpCache&) = delete;
+    ~GrpCache();
+
+    inline void setBudget(size_t budget) { budget_ = budget; }
+    /* returns nullptr for invalid index, loads the set if it is not cached */
+    DataSetPtr get(std::int16_t index);
+    /* queue missing sets to be loaded by a background thread, never blocks,
+     * prefetching stops when byte budget is reached so it never evicts other sets */
+    void prefetch(const std::vector<std::int16_t> &indices);
+
+private:
+    DataSetPtr load(std::unique_lock<std::mutex> &lk, std::int16_t index, bool prefetching);
+    void evict();
+    void prefetchProc();
+
+private:
+    struct Entry {
+        DataSetPtr data;
+        size_t bytes = 0;
+        bool loading = false;
+        std::list<std::int16_t>::iterator lruIte;
+    };
+    std::string prefix_;
+    std::vector<Entry> entries_;
+    /* most recently used first */
+    std::list<std::int16_t> lru_;
+    size_t budget_ = 0, used_ = 0;
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<std::int16_t> pending_;
+    bool quit_ = false;
+    std::condition_variable prefetchCond_;
+    std::thread prefetchThread_;
+};
+
+}
@@ -20,11 +20,54 @@
 #include "grpdata.hh"
 
 #include "core/config.hh"
+#include "core/resourcemgr.hh"
 #include "util/file.hh"
+#include "util/mmapfile.hh"
+
+#include <fmt/format.h>
+#include <chrono>
+#include <cstring>
 
 namespace hojy::data {
 
+/* IDX/GRP pair from packed archive, returns false if any of them is not in archive */
+static bool getFromArchive(const std::string &idx, const std::string &grp, util::Archive::Data &idxData, util::Archive::Data &grpData) {
+    const auto &archive = core::gResourceMgr.archive();
+    if (!archive) { return false; }
+    idxData = archive.get(idx);
+    if (!idxData) { return false; }
+    grpData = archive.get(grp);
+    return bool(grpData);
+}
+
+template<typename F>
+static void forEachEntry(std::string_view idx, std::string_view grp, F &&func) {
+    auto count = idx.size() / sizeof(std::uint32_t);
+    auto fileSize = std::uint32_t(grp.size());
+    std::uint32_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        std::uint32_t endoffset;
+        memcpy(&endoffset, idx.data() + i * sizeof(std::uint32_t), sizeof(endoffset));
+        if (endoffset == 0 || endoffset > fileSize) {
+            endoffset = fileSize;
+        }
+        if (endoffset > offset) {
+            func(i, grp.substr(offset, endoffset - offset));
+            offset = endoffset;
+        }
+    }
+}
+
 bool GrpData::loadData(const std::string &idx, const std::string &grp, GrpData::DataSet &dset, bool isSave) {
+    util::Archive::Data idxData, grpData;
+    if (!isSave && getFromArchive(idx, grp, idxData, grpData)) {
+        dset.clear();
+        dset.resize(idxData.view.size() / sizeof(std::uint32_t));
+        forEachEntry(idxData.view, grpData.view, [&dset](size_t i, std::string_view data) {
+            dset[i].assign(data);
+        });
+        return true;
+    }
     util::File ifs, ifs2;
     if (isSave) {
         ifs = util::File::open(core::config.saveFilePath(idx));
@@ -81,4 +124,87 @@ bool GrpData::saveData(const std::string &name, const GrpData::DataSet &dset, bo
     return true;
 }
 
+bool GrpView::load(const std::string &idx, const std::string &grp) {
+    auto start = std::chrono::steady_clock::now();
+    util::Archive::Data idxData, grpData;
+    if (getFromArchive(idx, grp, idxData, grpData)) {
+        clear();
+        entries_.resize(idxData.view.size() / sizeof(std::uint32_t));
+        forEachEntry(idxData.view, grpData.view, [this](size_t i, std::string_view data) {
+            entries_[i] = data;
+        });
+        storageSize_ = grpData.view.size();
+        /* uncompressed entries point into archive mapping, which lives until exit */
+        if (grpData.copy) {
+            storage_.emplace_back(std::move(grpData.copy));
+        }
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        fmt::print("{}: archived {} entries, {:.1f}KB in {:.2f}ms\n", grp, entries_.size(),
+                   double(storageSize_) / 1024., elapsed);
+        return true;
+    }
+    std::vector<std::uint32_t> offsets;
+    if (!util::File::getFileContent(core::config.dataFilePath(idx), offsets)) {
+        return false;
+    }
+    std::shared_ptr<util::MMapFile> file;
+    if (core::config.mmapData()) {
+        file = std::make_shared<util::MMapFile>(util::MMapFile::open(core::config.dataFilePath(grp)));
+    }
+    bool mapped = file && *file;
+    if (mapped) {
+        const auto *data = file->data();
+        auto fileSize = std::uint32_t(file->size());
+        clear();
+        entries_.resize(offsets.size());
+        std::uint32_t offset = 0;
+        for (size_t i = 0; i < offsets.size(); ++i) {
+            auto endoffset = offsets[i];
+            if (endoffset == 0 || endoffset > fileSize) {
+                endoffset = fileSize;
+            }
+            if (endoffset > offset) {
+                entries_[i] = std::string_view(data + offset, endoffset - offset);
+                offset = endoffset;
+            }
+        }
+        storageSize_ = file->size();
+        storage_.emplace_back(std::move(file));
+    } else {
+        auto dset = std::make_shared<GrpData::DataSet>();
+        if (!GrpData::loadData(idx, grp, *dset)) {
+            return false;
+        }
+        clear();
+        entries_.assign(dset->begin(), dset->end());
+        for (auto &s: *dset) {
+            storageSize_ += s.size();
+        }
+        storage_.emplace_back(std::move(dset));
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fmt::print("{}: {} {} entries, {:.1f}KB in {:.2f}ms\n", grp, mapped ? "mapped" : "read", entries_.size(),
+               double(storageSize_) / 1024., elapsed);
+    return true;
+}
+
+void GrpView::merge(GrpView &&other) {
+    if (other.entries_.size() > entries_.size()) {
+        entries_.resize(other.entries_.size());
+    }
+    for (size_t i = 0; i < other.entries_.size(); ++i) {
+        if (other.entries_[i].empty() || !entries_[i].empty()) { continue; }
+        entries_[i] = other.entries_[i];
+    }
+    storage_.insert(storage_.end(), std::make_move_iterator(other.storage_.begin()), std::make_move_iterator(other.storage_.end()));
+    storageSize_ += other.storageSize_;
+    other.clear();
+}
+
+void GrpView::clear() {
+    entries_.clear();
+    storage_.clear();
+    storageSize_ = 0;
+}
+
 }
@@ -22,6 +22,8 @@
 #include <unordered_map>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <memory>
 #include <cstdint>
 
 namespace hojy::data {
@@ -37,4 +39,27 @@ public:
 
 };
 
+/* Read-only GRP data set, entries are views into the memory-mapped GRP file
+ * (or into a copy read by GrpData::loadData() if mapping is disabled or fails) */
+class GrpView final {
+public:
+    bool load(const std::string &idx, const std::string &grp);
+    inline bool load(const std::string &name) { return load(name + ".IDX", name + ".GRP"); }
+    /* fill empty entries with the ones from other set, its backing storage is kept alive */
+    void merge(GrpView &&other);
+    void clear();
+
+    [[nodiscard]] inline size_t size() const { return entries_.size(); }
+    [[nodiscard]] inline bool empty() const { return entries_.empty(); }
+    [[nodiscard]] inline std::string_view operator[](size_t index) const { return entries_[index]; }
+    [[nodiscard]] inline const std::vector<std::string_view> &entries() const { return entries_; }
+    /* bytes of backing storage, either mapped or copied */
+    [[nodiscard]] inline size_t storageSize() const { return storageSize_; }
+
+private:
+    std::vector<std::string_view> entries_;
+    std::vector<std::shared_ptr<const void>> storage_;
+    size_t storageSize_ = 0;
+};
+
 }
@@ -32,4 +32,13 @@ void loadData() {
     gWarfieldData.load("WAR.STA", "WARFLD");
 }
 
+LoadTasks loadData(util::TaskGraph &graph) {
+    LoadTasks tasks;
+    graph.add("events", [] { gEvent.loadEvent("KDEF"); });
+    tasks.talks = graph.add("talks", [] { gEvent.loadTalk("TALK"); });
+    graph.add("warfields", [] { gWarfieldData.load("WAR.STA", "WARFLD"); });
+    tasks.factors = graph.add("factors", [] { gFactors.load("Z.DAT"); });
+    return tasks;
+}
+
 }
@@ -19,8 +19,17 @@
 
 #pragma once
 
+#include "util/taskgraph.hh"
+
 namespace hojy::data {
 
+/* ids of queued load tasks that other tasks depend on */
+struct LoadTasks {
+    util::TaskGraph::TaskId factors, talks;
+};
+
 void loadData();
+/* queue the loads above as independent tasks */
+LoadTasks loadData(util::TaskGraph &graph);
 
 }
@@ -40,6 +40,12 @@ struct WarfieldLayers {
     std::int16_t layers[data::WarFieldLayerCount][data::WarFieldWidth *data::WarFieldHeight];
 };
 
+/* ids are layer values >> 1 */
+inline bool isWarfieldCellBlocked(std::int16_t earthId, std::int16_t buildingId) {
+    return buildingId > 0 || (earthId >= 179 && earthId <= 181) || earthId == 261 || earthId == 511
+        || (earthId >= 662 && earthId <= 665) || earthId == 674;
+}
+
 class WarfieldData {
 public:
     void load(const std::string &warsta, const std::string &warfld);
@@ -24,19 +24,47 @@
 #endif
 
 #include "core/config.hh"
-#include "data/loader.hh"
 #include "mem/strings.hh"
+#include "scene/inputrecord.hh"
 #include "scene/window.hh"
+#include "util/random.hh"
+#include <fmt/format.h>
+#include <string>
+#include <cstdlib>
 
 using namespace hojy;
 
+/* usage: hojy [--seed <seed>] [--record <file>|--replay <file>] */
 int main(int argc, char *argv[]) {
     core::config.load("config.toml");
     core::config.load(core::config.saveFilePath("options.toml"));
     core::config.postLoad();
     mem::gStrings.load("strings.toml");
     core::config.fixOnTextLoaded();
-    data::loadData();
+
+    auto seed = core::config.randomSeed();
+    auto engine = core::config.randomEngine();
+    std::string recordFile, replayFile;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--seed") {
+            seed = std::strtoull(argv[i + 1], nullptr, 10);
+        } else if (arg == "--record") {
+            recordFile = argv[i + 1];
+        } else if (arg == "--replay") {
+            replayFile = argv[i + 1];
+        }
+    }
+    if (!replayFile.empty()) {
+        if (!scene::gInputRecord.startReplaying(replayFile)) { return -1; }
+        seed = scene::gInputRecord.seed();
+        engine = scene::gInputRecord.engine();
+    }
+    seed = util::seedRandom(seed, util::Random::engineFromName(engine));
+    fmt::print("Random seed: {} ({})\n", seed, engine);
+    if (!recordFile.empty() && replayFile.empty()) {
+        scene::gInputRecord.startRecording(recordFile, seed, engine);
+    }
     scene::Window win(core::config.windowWidth(), core::config.windowHeight());
     for (;;) {
         win.update();
@@ -48,6 +76,7 @@ eventStart:
         if (!win.flush()) {
             goto eventStart;
         }
+        win.waitIdle();
     }
     return 0;
 }
@@ -201,7 +201,7 @@ std::int16_t tryUseBagItem(CharacterData *charInfo, PropType type, std::int16_t
         auto p1 = *ite;
         auto p2 = *(++ite);
         if (p1.first * 100 / p2.first >= 80) {
-            return util::gRandom(2) ? p1.second : p2.second;
+            return util::gCombatRandom(2) ? p1.second : p2.second;
         }
     }
     return optionalItems.begin()->second;
@@ -268,7 +268,7 @@ std::int16_t tryUseNpcItem(CharacterData *charInfo, PropType type, std::int16_t
         auto p1 = *ite;
         auto p2 = *(++ite);
         if (p1.first * 100 / p2.first >= 80) {
-            return util::gRandom(2) ? p1.second : p2.second;
+            return util::gCombatRandom(2) ? p1.second : p2.second;
         }
     }
     return optionalItems.begin()->second;
@@ -431,7 +431,7 @@ bool actDamage(CharacterData *c1, CharacterData *c2, std::int16_t knowledge1, st
     const auto *skill = mem::gSaveData.skillInfo[skillId];
     if (!skill) { return false; }
     if (skill->damageType > 0) {
-        std::int16_t drainMp = skill->drainMp[level] + util::gRandom(5) - util::gRandom(5);
+        std::int16_t drainMp = skill->drainMp[level] + util::gCombatRandom(5) - util::gCombatRandom(5);
         std::int16_t oldMp = c2->mp;
         c2->mp = std::clamp<std::int16_t>(c2->mp - drainMp, 0, c2->maxMp);
         drainMp = oldMp - c2->mp;
@@ -443,9 +443,9 @@ bool actDamage(CharacterData *c1, CharacterData *c2, std::int16_t knowledge1, st
     c1->mp = std::max(0, c1->mp - skill->reqMp);
     int atk = calcRealAttack(c1, knowledge1, skill, level);
     int def = calcRealDefense(c2, knowledge2);
-    int dmg = (atk - def * 3) * 2 / 3 + int(util::gRandom(21) - util::gRandom(21));
+    int dmg = (atk - def * 3) * 2 / 3 + int(util::gCombatRandom(21) - util::gCombatRandom(21));
     if (dmg < 0) {
-        dmg = atk / 10 + int(util::gRandom(5) - util::gRandom(5));
+        dmg = atk / 10 + int(util::gCombatRandom(5) - util::gCombatRandom(5));
     }
     if (dmg > 0) {
         dmg += c1->stamina / 15 + c2->hurt / 20;
@@ -482,7 +482,7 @@ bool actDamage(CharacterData *c1, CharacterData *c2, std::int16_t knowledge1, st
 void postDamage(CharacterData *c, int index, std::int16_t stamina, bool &levelup) {
     if (c->skillLevel[index] < data::SkillLevelMax) {
         int oldlevel = c->skillLevel[index] / 100;
-        c->skillLevel[index] = std::clamp<std::int16_t>(c->skillLevel[index] + util::gRandom(1, 2),
+        c->skillLevel[index] = std::clamp<std::int16_t>(c->skillLevel[index] + util::gCombatRandom(1, 2),
                                                         0, data::SkillLevelMax);
         levelup = c->skillLevel[index] / 100 != oldlevel;
         if (levelup) {
@@ -517,7 +517,7 @@ std::int16_t actMedic(CharacterData *c1, CharacterData *c2, std::int16_t stamina
     } else {
         heal = c1->medic / 2;
     }
-    c2->hp = std::clamp<std::int16_t>(c2->hp + heal + util::gRandom(6), 0, c2->maxHp);
+    c2->hp = std::clamp<std::int16_t>(c2->hp + heal + util::gCombatRandom(6), 0, c2->maxHp);
     c2->hurt = std::clamp<std::int16_t>(c2->hurt - c1->medic, 0, data::HurtMax);
     if (stamina) {
         c1->stamina = std::clamp<std::int16_t>(c1->stamina - stamina, 0, data::StaminaMax);
@@ -528,7 +528,7 @@ std::int16_t actMedic(CharacterData *c1, CharacterData *c2, std::int16_t stamina
 std::int16_t actDepoison(CharacterData *c1, CharacterData *c2, std::int16_t stamina) {
     if (!c1 || !c2) { return 0; }
     auto oldPs = c2->poisoned;
-    c2->poisoned = std::clamp<std::int16_t>(c2->poisoned - c1->depoison / 3 + util::gRandom(6) - util::gRandom(6), 0, data::PoisonedMax);
+    c2->poisoned = std::clamp<std::int16_t>(c2->poisoned - c1->depoison / 3 + util::gCombatRandom(6) - util::gCombatRandom(6), 0, data::PoisonedMax);
     if (stamina) {
         c1->stamina = std::clamp<std::int16_t>(c1->stamina - stamina, 0, data::StaminaMax);
     }
@@ -551,9 +551,9 @@ std::int16_t actThrow(CharacterData *c1, CharacterData *c2, std::int16_t itemId,
         div = 1;
     }
     auto oldHp = c2->hp;
-    c2->hp = std::clamp<std::int16_t>(c2->hp - std::max<std::int16_t>(1, (-itemInfo->addHp / div + util::gRandom(6) + c1->throwing * 2) / 3), 0, c2->maxHp);
+    c2->hp = std::clamp<std::int16_t>(c2->hp - std::max<std::int16_t>(1, (-itemInfo->addHp / div + util::gCombatRandom(6) + c1->throwing * 2) / 3), 0, c2->maxHp);
     if (c2->antipoison < 100) {
-        auto ps = itemInfo->addPoisoned <= 0 ? (itemInfo->addPoisoned / 2 + util::gRandom(6) - util::gRandom(6))
+        auto ps = itemInfo->addPoisoned <= 0 ? (itemInfo->addPoisoned / 2 + util::gCombatRandom(6) - util::gCombatRandom(6))
             : ((itemInfo->addPoisoned - c2->throwing) / 2 - c2->antipoison) / 2;
         if (ps > 0) {
             c2->poisoned = std::clamp<std::int16_t>(c2->poisoned - ps, 0, data::PoisonedMax);
@@ -577,13 +577,13 @@ void actRest(CharacterData *c) {
     c->stamina = std::clamp<std::int16_t>(c->stamina + 3, 0, data::StaminaMax);
     /* TODO: fix following formulas? */
     if (c->hp < c->maxHp) {
-        std::int16_t n = c->maxHp / 100 + util::gRandom(3) - util::gRandom(3);
+        std::int16_t n = c->maxHp / 100 + util::gCombatRandom(3) - util::gCombatRandom(3);
         if (n > 0) {
             c->hp = std::clamp<std::int16_t>(c->hp + n, 0, c->maxHp);
         }
     }
     if (c->mp < c->maxMp) {
-        std::int16_t n = c->maxMp / 100 + util::gRandom(3) - util::gRandom(3);
+        std::int16_t n = c->maxMp / 100 + util::gCombatRandom(3) - util::gCombatRandom(3);
         if (n > 0) {
             c->mp = std::clamp<std::int16_t>(c->mp + n, 0, c->maxMp);
         }
@@ -591,26 +591,26 @@ void actRest(CharacterData *c) {
 }
 
 void actLevelup(CharacterData *c) {
-    auto factor = util::gRandom(1, std::max(c->potential / 15, 3));
+    auto factor = util::gCombatRandom(1, std::max(c->potential / 15, 3));
     ++c->level;
     c->attack = std::clamp<std::int16_t>(c->attack + factor, 0, data::AttackMax);
     c->defence = std::clamp<std::int16_t>(c->defence + factor, 0, data::DefenceMax);
     c->speed = std::clamp<std::int16_t>(c->speed + factor, 0, data::SpeedMax);
-    c->maxHp = std::clamp<std::int16_t>(c->maxHp + c->hpAddOnLevelUp * 3 + util::gRandom(7), 0, data::HpMax);
+    c->maxHp = std::clamp<std::int16_t>(c->maxHp + c->hpAddOnLevelUp * 3 + util::gCombatRandom(7), 0, data::HpMax);
     c->maxMp = std::clamp<std::int16_t>(c->maxMp + 3 * (9 - factor), 0, data::MpMax);
     c->hp = c->maxHp;
     c->mp = c->maxMp;
     c->stamina = data::StaminaMax;
     c->poisoned = 0;
     c->hurt = 0;
-    if (c->medic) { c->medic = std::clamp<std::int16_t>(c->medic + util::gRandom(3), 0, data::MedicMax); }
-    if (c->poison) { c->poison = std::clamp<std::int16_t>(c->poison + util::gRandom(3), 0, data::PoisonMax); }
-    if (c->depoison) { c->depoison = std::clamp<std::int16_t>(c->depoison + util::gRandom(3), 0, data::DepoisonMax); }
-    if (c->fist) { c->fist = std::clamp<std::int16_t>(c->fist + util::gRandom(3), 0, data::FistMax); }
-    if (c->sword) { c->sword = std::clamp<std::int16_t>(c->sword + util::gRandom(3), 0, data::SwordMax); }
-    if (c->blade) { c->blade = std::clamp<std::int16_t>(c->blade + util::gRandom(3), 0, data::BladeMax); }
-    if (c->special) { c->special = std::clamp<std::int16_t>(c->special + util::gRandom(3), 0, data::SpecialMax); }
-    if (c->throwing) { c->throwing = std::clamp<std::int16_t>(c->throwing + util::gRandom(3), 0, data::ThrowingMax); }
+    if (c->medic) { c->medic = std::clamp<std::int16_t>(c->medic + util::gCombatRandom(3), 0, data::MedicMax); }
+    if (c->poison) { c->poison = std::clamp<std::int16_t>(c->poison + util::gCombatRandom(3), 0, data::PoisonMax); }
+    if (c->depoison) { c->depoison = std::clamp<std::int16_t>(c->depoison + util::gCombatRandom(3), 0, data::DepoisonMax); }
+    if (c->fist) { c->fist = std::clamp<std::int16_t>(c->fist + util::gCombatRandom(3), 0, data::FistMax); }
+    if (c->sword) { c->sword = std::clamp<std::int16_t>(c->sword + util::gCombatRandom(3), 0, data::SwordMax); }
+    if (c->blade) { c->blade = std::clamp<std::int16_t>(c->blade + util::gCombatRandom(3), 0, data::BladeMax); }
+    if (c->special) { c->special = std::clamp<std::int16_t>(c->special + util::gCombatRandom(3), 0, data::SpecialMax); }
+    if (c->throwing) { c->throwing = std::clamp<std::int16_t>(c->throwing + util::gCombatRandom(3), 0, data::ThrowingMax); }
 }
 
 }
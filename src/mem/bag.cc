@@ -25,7 +25,7 @@
 
 namespace hojy::mem {
 
-Bag gBag;
+thread_local Bag gBag;
 
 void Bag::syncFromSave() {
     items_.clear();
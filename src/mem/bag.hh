@@ -43,6 +43,7 @@ private:
     bool dirty_ = false;
 };
 
-extern Bag gBag;
+/* thread local like gSaveData */
+extern thread_local Bag gBag;
 
 }
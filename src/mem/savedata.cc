@@ -23,7 +23,7 @@
 
 namespace hojy::mem {
 
-SaveData gSaveData;
+thread_local SaveData gSaveData;
 
 static void buildSaveFilename(int num, std::string &rangerFile, std::string &sinFile, std::string &defFile) {
     if (num == 0) {
@@ -45,6 +45,7 @@ public:
     ShopInfo shopInfo;
 };
 
-extern SaveData gSaveData;
+/* thread local, headless battle simulation gives each worker thread its own copy */
+extern thread_local SaveData gSaveData;
 
 }
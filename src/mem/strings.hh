@@ -46,6 +46,7 @@ public:
         static const std::wstring empty;
         return index < strings_[type].size() ? strings_[type][index] : empty;
     }
+    [[nodiscard]] inline const std::vector<std::wstring> &strings(Type type) const { return strings_[type]; }
 
 private:
     std::vector<std::wstring> strings_[StringsMax];
@@ -0,0 +1,185 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "battleai.hh"
+
+#include "mem/action.hh"
+#include "mem/savedata.hh"
+#include "util/random.hh"
+#include <fmt/format.h>
+#include <algorithm>
+
+namespace hojy::scene {
+
+bool BattleAI::resume(int budget) {
+    if (ready_) { return true; }
+    if (!scorer_.run(budget)) { return false; }
+    finish();
+    ready_ = true;
+    return true;
+}
+
+void BattleAI::movePath(int x, int y, std::vector<std::pair<int, int>> &path) {
+    auto *sc = area_.find(x, y);
+    while (sc) {
+        path.emplace_back(std::make_pair(sc->x, sc->y));
+        sc = sc->moveParent;
+    }
+}
+
+int BattleAI::prepare(const Unit &actor, std::int16_t knowledge) {
+    actor_ = actor;
+    plan_ = Plan {};
+    planned_ = false;
+    ready_ = false;
+    skillCount_ = 0;
+    auto *info = actor.info;
+    auto tryUseItem = [info, side = actor.side](mem::PropType type, std::int16_t value) {
+        return side == 1 ? mem::tryUseNpcItem(info, type, value) : mem::tryUseBagItem(info, type, value);
+    };
+    if (info->stamina < 10) {
+        planned_ = true;
+        plan_.action = Plan::UseItem;
+        plan_.itemId = tryUseItem(mem::PropType::Stamina, data::StaminaMax - info->stamina);
+    } else if (info->hp < 20 || info->hp <= info->maxHp / 5) {
+        auto itemId = tryUseItem(mem::PropType::Hp, info->maxHp - info->hp);
+        if (itemId >= 0 || info->hp <= 20) {
+            planned_ = true;
+            plan_.action = Plan::UseItem;
+            plan_.itemId = itemId;
+        }
+    } else if (info->poisoned > 33 && actor.side == 1) {
+        auto itemId = tryUseItem(mem::PropType::Poisoned, info->poisoned);
+        if (itemId >= 0) {
+            planned_ = true;
+            plan_.action = Plan::UseItem;
+            plan_.itemId = itemId;
+        }
+    }
+    int maxRange = 0;
+    if (planned_) { return maxRange; }
+    for (int i = 0; i < data::LearnSkillCount; ++i) {
+        if (info->skillId[i] <= 0) { continue; }
+        const auto *skill = mem::gSaveData.skillInfo[info->skillId[i]];
+        if (!skill || skill->damageType > 0) { continue; }
+        std::int16_t level = mem::calcRealSkillLevel(skill->reqMp,
+                                                     std::clamp<std::int16_t>(info->skillLevel[i] / 100, 0, 9),
+                                                     info->mp);
+        if (level < 0) { continue; }
+        std::int16_t atk = mem::calcRealAttack(info, knowledge, skill, level);
+        std::int16_t type = skill->attackAreaType, range = skill->selRange[level], area = skill->area[level];
+        skills_[skillCount_++] = SkillPredict {std::int16_t(i), atk, type, range, area};
+        if (type == 0 || type == 3) {
+            maxRange = std::max<int>(maxRange, range);
+        }
+    }
+    if (!skillCount_) {
+        planned_ = true;
+        plan_.action = Plan::UseItem;
+        plan_.itemId = tryUseItem(mem::PropType::Mp, info->maxMp - info->mp);
+    }
+    return maxRange;
+}
+
+void BattleAI::start(const Unit *enemies, int enemyCount, int width, int height) {
+    scorer_.reset(area_, width, height);
+    for (int i = 0; i < enemyCount; ++i) {
+        scorer_.addEnemy(enemies[i].x, enemies[i].y);
+    }
+    if (planned_) {
+        /* move as far as possible from enemies before using item or resting */
+        auto [mx, my] = scorer_.farthestCell();
+        plan_.moveX = std::int16_t(mx);
+        plan_.moveY = std::int16_t(my);
+        ready_ = true;
+        return;
+    }
+    const auto *info = actor_.info;
+    for (int j = 0; j < skillCount_; ++j) {
+        const auto &sk = skills_[j];
+        auto s = scorer_.addSkill(TargetScorer::Skill {sk.index, sk.rangeType, sk.skillRange, sk.area});
+        for (int i = 0; i < enemyCount; ++i) {
+            const auto *enemy = enemies[i].info;
+            for (std::int16_t d = 0; d < TargetScorer::DistanceSteps; ++d) {
+                int dmg = mem::calcPredictDamage(sk.atk, enemy->defence, info->stamina, enemy->hurt, d);
+                if (dmg >= enemy->hp) {
+                    if (sk.rangeType >= 1 && sk.rangeType <= 3) {
+                        dmg = std::max<int>(dmg * 3 / 2, enemy->maxHp);
+                    } else {
+                        dmg = dmg * 3 / 2;
+                    }
+                }
+                scorer_.setDamage(s, i, d, dmg);
+            }
+        }
+    }
+}
+
+void BattleAI::finish() {
+    auto &scores = scorer_.scores();
+    if (scores.empty()) {
+        /* nothing to attack, get close to enemies and rest */
+        auto [mx, my] = scorer_.nearestCell();
+#ifndef NDEBUG
+        fmt::print(stdout, "({},{})->({},{})\n", actor_.x, actor_.y, mx, my);
+        fflush(stdout);
+#endif
+        plan_.action = Plan::Rest;
+        plan_.moveX = std::int16_t(mx);
+        plan_.moveY = std::int16_t(my);
+        return;
+    }
+    std::sort(scores.begin(), scores.end(), [](const TargetScorer::Score &v0, const TargetScorer::Score &v1) {
+        return v0.score > v1.score;
+    });
+    int ratio[3], ratioTotal = 0;
+    int counter = 0;
+    for (auto &s: scores) {
+#ifndef NDEBUG
+        fmt::print(stdout, "({},{})->({},{}): {}={}\n", s.fx, s.fy, s.tx, s.ty, s.skillIndex, s.score);
+        fflush(stdout);
+#endif
+        ratio[counter] = s.score;
+        ratioTotal += s.score;
+        if (++counter == 3) {
+            break;
+        }
+    }
+    int randNum = util::gCombatRandom(ratioTotal);
+    int sel;
+    if (counter > 1) {
+        for (sel = 0; sel < 2; ++sel) {
+            if (randNum < ratio[sel]) {
+                break;
+            }
+            randNum -= ratio[sel];
+        }
+    } else {
+        sel = 0;
+    }
+    const auto &s = scores[sel];
+    plan_.action = Plan::Skill;
+    plan_.moveX = s.fx;
+    plan_.moveY = s.fy;
+    plan_.skillIndex = std::int16_t(s.skillIndex);
+    plan_.targetX = s.tx;
+    plan_.targetY = s.ty;
+}
+
+}
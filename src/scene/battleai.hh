@@ -0,0 +1,147 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "selectablearea.hh"
+#include "targetscorer.hh"
+#include "mem/character.hh"
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace hojy::scene {
+
+/* Decides actions of AI controlled chars in battle, shared by Warfield and the headless battle simulator.
+ * Deciding may be spread over several resume() calls to cap work per frame */
+class BattleAI final {
+public:
+    struct Unit {
+        std::uint8_t side;
+        std::int16_t x, y;
+        mem::CharacterData *info;
+    };
+    struct Plan {
+        enum Action {
+            Rest,
+            /* use item `itemId`, rest instead if it is -1 or not usable */
+            UseItem,
+            /* use skill in slot `skillIndex` facing direction `targetX` if `targetY` < 0, or at cell (targetX, targetY) */
+            Skill,
+        };
+        Action action = Rest;
+        /* cell to move to before acting, -1 if no reachable cell is found */
+        std::int16_t moveX = -1, moveY = -1;
+        std::int16_t itemId = -1;
+        std::int16_t skillIndex = -1;
+        std::int16_t targetX = -1, targetY = -1;
+    };
+
+    /* start deciding for actor, enemies are alive chars of the other side,
+     * cellFlags(index) returns SelectableArea::Cell* flags of cells from actor's side */
+    template<typename F>
+    void begin(const Unit &actor, std::int16_t knowledge, int steps, const Unit *enemies, int enemyCount,
+               int width, int height, F &&cellFlags) {
+        auto maxRange = prepare(actor, knowledge);
+        area_.calc(width, height, actor.x, actor.y, steps, planned_ ? 0 : maxRange, false, cellFlags);
+        start(enemies, enemyCount, width, height);
+    }
+    /* continue deciding with work budget(see TargetScorer::run()), returns true when plan() is ready */
+    bool resume(int budget);
+    [[nodiscard]] inline const Plan &plan() const { return plan_; }
+    /* append cells from (x, y) back to actor's position, (x, y) must be a movable cell */
+    void movePath(int x, int y, std::vector<std::pair<int, int>> &path);
+
+private:
+    int prepare(const Unit &actor, std::int16_t knowledge);
+    void start(const Unit *enemies, int enemyCount, int width, int height);
+    void finish();
+
+private:
+    struct SkillPredict {
+        std::int16_t index;
+        std::int16_t atk;
+        std::int16_t rangeType;
+        std::int16_t skillRange, area;
+    };
+    Unit actor_ = {};
+    SkillPredict skills_[data::LearnSkillCount] = {};
+    int skillCount_ = 0;
+    /* action is decided before scoring, just move away from enemies */
+    bool planned_ = false;
+    bool ready_ = false;
+    Plan plan_;
+    SelectableArea area_;
+    TargetScorer scorer_;
+};
+
+/* call func(x, y, distance) for each cell hit by a skill of attackAreaType `type` used at (x, y) facing `direction`
+ * (values of Map::Direction) to target (tx, ty), in the order damage is dealt */
+template<typename F>
+void forEachSkillCell(int type, int range, int area, int x, int y, int direction, int tx, int ty,
+                      int width, int height, F &&func) {
+    switch (type) {
+    case 1:
+        for (int i = range; i; --i) {
+            switch (direction) {
+            case 0:
+                if (y >= i) { func(x, y - i, i); }
+                break;
+            case 1:
+                if (x + i < width) { func(x + i, y, i); }
+                break;
+            case 2:
+                if (x >= i) { func(x - i, y, i); }
+                break;
+            case 3:
+                if (y + i < height) { func(x, y + i, i); }
+                break;
+            default:
+                break;
+            }
+        }
+        break;
+    case 2:
+        for (int i = range; i; --i) {
+            if (y >= i) { func(x, y - i, i); }
+            if (x + i < width) { func(x + i, y, i); }
+            if (x >= i) { func(x - i, y, i); }
+            if (y + i < height) { func(x, y + i, i); }
+        }
+        break;
+    case 3: {
+        int baseDistance = std::abs(tx - x) + std::abs(ty - y);
+        for (int j = -area; j <= area; ++j) {
+            auto ry = ty + j;
+            if (ry < 0 || ry >= height) { continue; }
+            for (int i = -area; i <= area; ++i) {
+                auto rx = tx + i;
+                if (rx < 0 || rx >= width) { continue; }
+                func(rx, ry, baseDistance + std::abs(i) + std::abs(j));
+            }
+        }
+        break;
+    }
+    default:
+        func(tx, ty, std::abs(tx - x) + std::abs(ty - y));
+        break;
+    }
+}
+
+}
@@ -0,0 +1,180 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "blitter.hh"
+
+#include <SDL.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLITTER_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#define TARGET_SSE2
+#define TARGET_AVX2
+#else
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace hojy::scene {
+
+/* Keep in sync with the rounding of the SIMD versions:
+ *   B/R: (v + (v >> 8) + 1) >> 8
+ *   G:   (v + ((v + 1) >> 8)) >> 8
+ * where v = (255 - a) * dst + a * src */
+static inline std::uint32_t blendAlpha(std::uint32_t p1, std::uint32_t p2) {
+    static const std::uint32_t AMASK = 0xFF000000;
+    static const std::uint32_t RBMASK = 0x00FF00FF;
+    static const std::uint32_t GMASK = 0x0000FF00;
+    std::uint32_t a = (p2 & AMASK) >> 24;
+    std::uint32_t na = 255 - a;
+    std::uint32_t rb = (na * (p1 & RBMASK)) + (a * (p2 & RBMASK));
+    rb = (rb + 0x10001 + ((rb >> 8) & 0xFF00FF)) >> 8;
+    std::uint32_t g = (na * (p1 & GMASK)) + (a * (p2 & GMASK));
+    g = ((g + 1) * 257) >> 16;
+    return (rb & RBMASK) | (g & GMASK) | 0xFF000000u;
+}
+
+static void copyScalar(std::uint32_t *dst, const std::uint8_t *src, int count, const std::uint32_t *colors) {
+    for (; count; --count) {
+        *dst++ = colors[*src++];
+    }
+}
+
+static void blendScalar(std::uint32_t *dst, const std::uint8_t *src, int count, const std::uint32_t *colors) {
+    for (; count; --count) {
+        *dst = blendAlpha(*dst, colors[*src++]);
+        ++dst;
+    }
+}
+
+#ifdef BLITTER_X86
+
+/* blend 2 pixels unpacked to 16bit lanes, lane order is B,G,R,A */
+TARGET_SSE2 static inline __m128i blend2SSE2(__m128i d, __m128i s) {
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i k1 = _mm_set_epi16(0, 0, 1, 0, 0, 0, 1, 0);
+    const __m128i k2 = _mm_set_epi16(0, 1, 0, 1, 0, 1, 0, 1);
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i v = _mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(c255, a)), _mm_mullo_epi16(s, a));
+    v = _mm_add_epi16(_mm_add_epi16(v, _mm_srli_epi16(_mm_add_epi16(v, k1), 8)), k2);
+    return _mm_srli_epi16(v, 8);
+}
+
+TARGET_SSE2 static inline __m128i blend4SSE2(__m128i d, __m128i s) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = blend2SSE2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+    __m128i hi = blend2SSE2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+    return _mm_or_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32(int(0xFF000000u)));
+}
+
+TARGET_SSE2 static inline __m128i load4SSE2(const std::uint8_t *src, const std::uint32_t *colors) {
+    return _mm_setr_epi32(int(colors[src[0]]), int(colors[src[1]]), int(colors[src[2]]), int(colors[src[3]]));
+}
+
+TARGET_SSE2 static void blendSSE2(std::uint32_t *dst, const std::uint8_t *src, int count, const std::uint32_t *colors) {
+    for (; count >= 4; count -= 4, src += 4, dst += 4) {
+        auto *p = reinterpret_cast<__m128i*>(dst);
+        _mm_storeu_si128(p, blend4SSE2(_mm_loadu_si128(p), load4SSE2(src, colors)));
+    }
+    blendScalar(dst, src, count, colors);
+}
+
+TARGET_AVX2 static inline __m256i blend4AVX2(__m256i d, __m256i s) {
+    const __m256i c255 = _mm256_set1_epi16(255);
+    const __m256i k1 = _mm256_set_epi16(0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 0);
+    const __m256i k2 = _mm256_set_epi16(0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1);
+    __m256i a = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m256i v = _mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(c255, a)), _mm256_mullo_epi16(s, a));
+    v = _mm256_add_epi16(_mm256_add_epi16(v, _mm256_srli_epi16(_mm256_add_epi16(v, k1), 8)), k2);
+    return _mm256_srli_epi16(v, 8);
+}
+
+TARGET_AVX2 static inline __m256i load8AVX2(const std::uint8_t *src, const std::uint32_t *colors) {
+    __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src)));
+    return _mm256_i32gather_epi32(reinterpret_cast<const int*>(colors), idx, 4);
+}
+
+TARGET_AVX2 static void copyAVX2(std::uint32_t *dst, const std::uint8_t *src, int count, const std::uint32_t *colors) {
+    for (; count >= 8; count -= 8, src += 8, dst += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), load8AVX2(src, colors));
+    }
+    copyScalar(dst, src, count, colors);
+}
+
+TARGET_AVX2 static void blendAVX2(std::uint32_t *dst, const std::uint8_t *src, int count, const std::uint32_t *colors) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i amask = _mm256_set1_epi32(int(0xFF000000u));
+    for (; count >= 8; count -= 8, src += 8, dst += 8) {
+        auto *p = reinterpret_cast<__m256i*>(dst);
+        __m256i d = _mm256_loadu_si256(p);
+        __m256i s = load8AVX2(src, colors);
+        /* unpack/pack work within 128bit lanes, so pixel order is preserved */
+        __m256i lo = blend4AVX2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+        __m256i hi = blend4AVX2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+        _mm256_storeu_si256(p, _mm256_or_si256(_mm256_packus_epi16(lo, hi), amask));
+    }
+    blendScalar(dst, src, count, colors);
+}
+
+#endif
+
+static const Blitter blitters[Blitter::TypeMax] = {
+    {"scalar", copyScalar, blendScalar},
+#ifdef BLITTER_X86
+    /* no gather in SSE2, palette lookups are not faster than the scalar copy */
+    {"sse2", copyScalar, blendSSE2},
+    {"avx2", copyAVX2, blendAVX2},
+#else
+    {"sse2", nullptr, nullptr},
+    {"avx2", nullptr, nullptr},
+#endif
+};
+
+const Blitter *Blitter::current_ = Blitter::best();
+
+const Blitter *Blitter::get(Type type) {
+    switch (type) {
+    case Scalar:
+        return &blitters[Scalar];
+#ifdef BLITTER_X86
+    case SSE2:
+        return SDL_HasSSE2() ? &blitters[SSE2] : nullptr;
+    case AVX2:
+        return SDL_HasAVX2() ? &blitters[AVX2] : nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+const Blitter *Blitter::best() {
+    for (int i = TypeMax - 1; i > Scalar; --i) {
+        const auto *b = get(Type(i));
+        if (b) { return b; }
+    }
+    return &blitters[Scalar];
+}
+
+void Blitter::setCurrent(const Blitter *blitter) {
+    current_ = blitter ? blitter : best();
+}
+
+}
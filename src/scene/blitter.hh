@@ -0,0 +1,53 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace hojy::scene {
+
+class Blitter final {
+public:
+    enum Type {
+        Scalar,
+        SSE2,
+        AVX2,
+        TypeMax,
+    };
+    /* Blit `count` palette indices from `src` into `dst`.
+     * copy writes colors[src[i]], blend alpha-blends colors[src[i]] over dst[i] */
+    using RunFunc = void(*)(std::uint32_t *dst, const std::uint8_t *src, int count, const std::uint32_t *colors);
+
+    const char *name;
+    RunFunc copy;
+    RunFunc blend;
+
+public:
+    /* returns nullptr if the type is not supported by this cpu/build */
+    [[nodiscard]] static const Blitter *get(Type type);
+    [[nodiscard]] static const Blitter *best();
+    [[nodiscard]] static inline const Blitter &current() { return *current_; }
+    static void setCurrent(const Blitter *blitter);
+
+private:
+    static const Blitter *current_;
+};
+
+}
@@ -20,17 +20,28 @@
 #include "colorpalette.hh"
 
 #include "core/config.hh"
+#include "core/resourcemgr.hh"
 #include "util/file.hh"
 
+#include <cstring>
+
 namespace hojy::scene {
 
 ColorPalette gNormalPalette, gEndPalette, gMaskPalette;
 
 void ColorPalette::load(const std::string &name) {
-    auto ifs = util::File::open(core::config.dataFilePath(name + ".COL"));
+    auto filename = name + ".COL";
+    auto data = core::gResourceMgr.archive().get(filename);
+    std::string content;
+    if (!data) {
+        content = util::File::getFileContent(core::config.dataFilePath(filename));
+        data.view = content;
+    }
     std::uint8_t c[4] = {0, 0, 0, 0xFF};
     for (size_t i = 0; i < 256; ++i) {
-        ifs.read(c, 3);
+        if ((i + 1) * 3 <= data.view.size()) {
+            memcpy(c, data.view.data() + i * 3, 3);
+        }
         for (int j = 0; j < 3; ++j) {
             c[j] = std::uint8_t(std::uint32_t(c[j]) * 4);
         }
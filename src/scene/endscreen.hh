@@ -32,6 +32,7 @@ public:
     void init();
     void render() override;
     void handleKeyInput(Key key) override;
+    [[nodiscard]] std::uint64_t nextWakeTime() const override { return 0; }
 
 private:
     void makeCache() override;
@@ -62,6 +62,10 @@ void ExtendedNode::checkTimeout() {
     }
 }
 
+std::uint64_t ExtendedNode::nextWakeTime() const {
+    return closeType_ == 0 ? closeDeadline_ : NoWakeTime;
+}
+
 void ExtendedNode::handleKeyInput(Node::Key key) {
     if (closeType_ != 0) { return; }
     keyPressed_ = key;
@@ -42,6 +42,7 @@ public:
     void checkTimeout();
 
     void handleKeyInput(Key key) override;
+    [[nodiscard]] std::uint64_t nextWakeTime() const override;
 
 protected:
     void makeCache() override;
@@ -26,6 +26,8 @@
 #include "util/file.hh"
 #include "util/random.hh"
 #include "core/config.hh"
+#include "core/profiler.hh"
+#include "util/bytes.hh"
 #include <cstring>
 
 namespace hojy::scene {
@@ -45,19 +47,21 @@ GlobalMap::GlobalMap(Renderer *renderer, int ix, int iy, int width, int height,
     mapHeight_ = GlobalMapHeight;
     cloudTexMgr_.setRenderer(renderer_);
     cloudTexMgr_.setPalette(gNormalPalette);
-    data::GrpData::loadData("MMAP", texData_);
-    renderer_->enableLinear();
-    data::GrpData::DataSet dset;
-    if (data::GrpData::loadData("CLOUD", dset)) {
-        cloudTexMgr_.loadFromRLE(dset);
-    }
-    renderer_->enableLinear(false);
+}
+
+GlobalMap::~GlobalMap() {
+    delete drawingTerrainTex2_;
+}
+
+void GlobalMap::loadData() {
+    texData_.load("MMAP");
+    spriteCache_.load("MMAP", texData_.entries());
     {
-        const auto *arr = reinterpret_cast<const uint16_t*>(texData_[0].data());
-        cellWidth_ = arr[0];
-        cellHeight_ = arr[1];
-        offsetX_ = arr[2];
-        offsetY_ = arr[3];
+        const auto *arr = texData_[0].data();
+        cellWidth_ = util::readLE16(arr);
+        cellHeight_ = util::readLE16(arr + 2);
+        offsetX_ = util::readLE16(arr + 4);
+        offsetY_ = util::readLE16(arr + 6);
     }
     int cellDiffX = cellWidth_ / 2;
     int cellDiffY = cellHeight_ / 2;
@@ -101,10 +105,10 @@ GlobalMap::GlobalMap(Renderer *renderer, int ix, int iy, int width, int height,
                     ci.type = 2;
                 }
                 if (n1 && n1 < texData_.size() && !texData_[n1].empty()) {
-                    const auto *arr = reinterpret_cast<const uint16_t *>(texData_[n1].data());
-                    auto deltaY = (arr[0] + 35) / 36 / 2;
+                    const auto *arr = texData_[n1].data();
+                    auto deltaY = (util::readLE16(arr) + 35) / 36 / 2;
                     if (n1 >= 1176 && n1 <= 1182 || n1 == 1352) {
-                        deltaY = arr[1] / 18 + 1;
+                        deltaY = util::readLE16(arr + 2) / 18 + 1;
                     }
                     if (deltaY) {
                         auto &ci2 = cellInfo_[(j - deltaY) * mapWidth_ + (i - deltaY)];
@@ -118,12 +122,45 @@ GlobalMap::GlobalMap(Renderer *renderer, int ix, int iy, int width, int height,
             }
         }
     }
-    resetTime();
-    updateMainCharTexture();
+    auto updateExtents = [this](std::int16_t id) {
+        int l, t, r, b;
+        if (!spriteCache_.extents(id, l, t, r, b)) { return; }
+        groundLeft_ = std::max(groundLeft_, l);
+        groundTop_ = std::max(groundTop_, t);
+        groundRight_ = std::max(groundRight_, r);
+        groundBottom_ = std::max(groundBottom_, b);
+    };
+    updateExtents(0);
+    std::vector<bool> visited(spriteCache_.size());
+    for (auto &ci: cellInfo_) {
+        for (auto id: {ci.earthId, ci.surfaceId}) {
+            if (id < 0 || size_t(id) >= visited.size() || visited[id]) { continue; }
+            visited[id] = true;
+            updateExtents(id);
+        }
+    }
+    if (!core::config.gpuMapRender()) {
+        groundBuffer_.resize(int(auxWidth_), int(auxHeight_), cellWidth_ * 2);
+    }
 }
 
-GlobalMap::~GlobalMap() {
-    delete drawingTerrainTex2_;
+void GlobalMap::initTextures() {
+    renderer_->enableLinear();
+    data::GrpData::DataSet dset;
+    if (data::GrpData::loadData("CLOUD", dset)) {
+        cloudTexMgr_.loadFromRLE(dset);
+    }
+    renderer_->enableLinear(false);
+    if (core::config.gpuMapRender()) {
+        /* upload all sprites to atlas pages once, in id order so that neighbouring tiles share pages */
+        auto count = std::int16_t(texData_.size());
+        for (std::int16_t i = 0; i < count; ++i) {
+            if (texData_[i].empty()) { continue; }
+            textureMgr_.loadFromRLE(texData_[i], i);
+        }
+    }
+    resetTime();
+    updateMainCharTexture();
 }
 
 void GlobalMap::load() {
@@ -194,14 +231,22 @@ void GlobalMap::load() {
     if (core::config.shipLogicEnabled()) {
         showShip(!onShip_);
     }
+    /* new or loaded game: repaint ground from current palette and map data on next render */
+    groundBuffer_.invalidate();
 }
 
 void GlobalMap::update() {
     MapWithEvent::update();
+    auto now = gWindow->currTime();
     for (int i = 0; i < 3; ++i) {
         auto &c = cloud_[i];
         if (!c) {
-            if (util::gRandom(2500)) { continue; }
+            /* roughly a chance of 1/2500 for each frame at 60fps, rolled ahead so idle waits can wake for it */
+            if (cloudTime_[i] == 0) {
+                cloudTime_[i] = now + util::gRandom(5000) * 1000000ULL / 60ULL;
+            }
+            if (now < cloudTime_[i]) { continue; }
+            cloudTime_[i] = 0;
             c = cloudTexMgr_[util::gRandom(4)];
             cloudStartX_[i] = cameraX_; cloudStartY_[i] = cameraY_;
             cloudX_[i] = -width_ * 3 / 5;
@@ -212,7 +257,8 @@ void GlobalMap::update() {
 
 void GlobalMap::render() {
     Map::render();
-    if (drawDirty_) {
+    if (drawDirty_ && !core::config.gpuMapRender()) {
+        PROFILE_SCOPE("map_composite");
         drawDirty_ = false;
         int cellDiffX = cellWidth_ / 2;
         int cellDiffY = cellHeight_ / 2;
@@ -228,38 +274,21 @@ void GlobalMap::render() {
         int oty = aheight / 2 + cellDiffY - (ocx + ocy) * cellDiffY;
         ocx = camX - ocx; ocy = camY - ocy;
         int delta = -mapWidth_ + 1;
-        int cx = ocx, cy = ocy, tx = otx, ty = oty;
         const auto *colors = gNormalPalette.colors();
         auto *curTex = drawingTerrainTex_;
         int pitch;
         std::uint32_t *pixels = curTex->lock(pitch);
-        memset(pixels, 0, pitch * auxHeight_ * sizeof(std::uint32_t));
-        for (int j = hcount; j; --j) {
-            int x = cx, y = cy;
-            int dx = tx;
-            int offset = y * mapWidth_ + x;
-            for (int i = wcount; i; --i, dx += cellWidth_, offset += delta, ++x, --y) {
-                if (x < 0 || x >= GlobalMapWidth || y < 0 || y >= GlobalMapHeight) {
-                    Texture::renderRLE(texData_[0], colors, pixels, pitch, aheight, dx, ty);
-                    continue;
-                }
-                auto &ci = cellInfo_[offset];
-                Texture::renderRLE(texData_[ci.earthId], colors, pixels, pitch, aheight, dx, ty);
-                if (ci.surfaceId) {
-                    Texture::renderRLE(texData_[ci.surfaceId], colors, pixels, pitch, aheight, dx, ty);
-                }
-            }
-            if (j % 2) {
-                ++cx;
-                tx += cellDiffX;
-                ty += cellDiffY;
-            } else {
-                ++cy;
-                tx -= cellDiffX;
-                ty += cellDiffY;
-            }
+        /* ground layer is taken from scroll buffer, only newly exposed parts are painted */
+        const auto *ground = groundBuffer_.scrollTo((camX - camY) * cellDiffX - int(auxWidth_) / 2,
+                                                    (camX + camY - 1) * cellDiffY - aheight / 2,
+                                                    [this](std::uint32_t *buf, int bufPitch, int x, int y, int w, int h) {
+                                                        paintGround(buf, bufPitch, x, y, w, h);
+                                                    });
+        int groundPitch = groundBuffer_.pitch();
+        for (int j = 0; j < aheight; ++j) {
+            memcpy(pixels + j * pitch, ground + j * groundPitch, auxWidth_ * sizeof(std::uint32_t));
         }
-        cx = ocx; cy = ocy; tx = otx; ty = oty;
+        int cx = ocx, cy = ocy, tx = otx, ty = oty;
         int charX = currX_, charY = currY_;
         for (int j = hcount; j; --j) {
             int x = cx, y = cy;
@@ -271,7 +300,7 @@ void GlobalMap::render() {
                 }
                 auto &ci = cellInfo_[offset];
                 if (ci.buildingId) {
-                    Texture::renderRLE(texData_[ci.buildingId], colors, pixels, pitch, aheight, dx, ty + ci.buildingDeltaY);
+                    spriteCache_.render(ci.buildingId, colors, pixels, pitch, aheight, dx, ty + ci.buildingDeltaY);
                 }
                 if (x == charX && y == charY) {
                     curTex->unlock();
@@ -291,15 +320,20 @@ void GlobalMap::render() {
             }
         }
         curTex->unlock();
-        int miniMapStartX = 2 * (mapHeight_ - 1) + 1 + 2 * (cameraX_ - cameraY_);
-        int miniMapStartY = 1 + cameraX_ + cameraY_;
-        miniMapAuxX_ = miniMapStartX - miniMapAuxW_ / 2;
-        miniMapAuxY_ = miniMapStartY - miniMapAuxH_ / 2;
     }
+    int miniMapStartX = 2 * (mapHeight_ - 1) + 1 + 2 * (cameraX_ - cameraY_);
+    int miniMapStartY = 1 + cameraX_ + cameraY_;
+    miniMapAuxX_ = miniMapStartX - miniMapAuxW_ / 2;
+    miniMapAuxY_ = miniMapStartY - miniMapAuxH_ / 2;
     renderer_->clear(0, 0, 0, 255);
-    renderer_->renderTexture(drawingTerrainTex_, x_, y_, width_, height_, 0, 0, auxWidth_, auxHeight_);
-    renderChar();
-    renderer_->renderTexture(drawingTerrainTex2_, x_, y_, width_, height_, 0, 0, auxWidth_, auxHeight_);
+    if (core::config.gpuMapRender()) {
+        drawDirty_ = false;
+        renderBatched();
+    } else {
+        renderer_->renderTexture(drawingTerrainTex_, x_, y_, width_, height_, 0, 0, auxWidth_, auxHeight_);
+        renderChar();
+        renderer_->renderTexture(drawingTerrainTex2_, x_, y_, width_, height_, 0, 0, auxWidth_, auxHeight_);
+    }
     for (int i = 0; i < 3; ++i) {
         auto &c = cloud_[i];
         if (!c) {
@@ -319,6 +353,16 @@ void GlobalMap::render() {
     showMiniPanel();
 }
 
+std::uint64_t GlobalMap::nextWakeTime() const {
+    auto res = MapWithEvent::nextWakeTime();
+    for (int i = 0; i < 3; ++i) {
+        /* clouds drift every frame */
+        if (cloud_[i]) { return 0; }
+        if (cloudTime_[i]) { res = std::min(res, cloudTime_[i]); }
+    }
+    return res;
+}
+
 void GlobalMap::showShip(bool show) {
     int shipX0 = mem::gSaveData.baseInfo->shipX;
     int shipY0 = mem::gSaveData.baseInfo->shipY;
@@ -398,6 +442,98 @@ bool GlobalMap::tryMove(int x, int y, bool checkEvent) {
     return true;
 }
 
+void GlobalMap::paintGround(std::uint32_t *pixels, int pitch, int x, int y, int w, int h) {
+    /* cell (cx, cy) is placed at world position ((cx - cy) * cellDiffX, (cx + cy) * cellDiffY),
+     * paint all cells touching the rect in the same order as a full redraw:
+     * ascending (cx + cy), then ascending cx */
+    auto floorDiv = [](int a, int b) { return a >= 0 ? a / b : -((-a + b - 1) / b); };
+    int cellDiffX = cellWidth_ / 2;
+    int cellDiffY = cellHeight_ / 2;
+    const auto *colors = gNormalPalette.colors();
+    int sumFrom = floorDiv(y - groundBottom_, cellDiffY), sumTo = floorDiv(y + h + groundTop_, cellDiffY) + 1;
+    int diffFrom = floorDiv(x - groundRight_, cellDiffX), diffTo = floorDiv(x + w + groundLeft_, cellDiffX) + 1;
+    for (int sum = sumFrom; sum <= sumTo; ++sum) {
+        int ty = sum * cellDiffY - y;
+        int diff = diffFrom;
+        if ((diff - sum) & 1) { ++diff; }
+        for (; diff <= diffTo; diff += 2) {
+            int cx = (sum + diff) / 2, cy = (sum - diff) / 2;
+            int dx = diff * cellDiffX - x;
+            if (cx < 0 || cx >= GlobalMapWidth || cy < 0 || cy >= GlobalMapHeight) {
+                spriteCache_.render(0, colors, pixels, pitch, w, h, dx, ty);
+                continue;
+            }
+            auto &ci = cellInfo_[cy * mapWidth_ + cx];
+            spriteCache_.render(ci.earthId, colors, pixels, pitch, w, h, dx, ty);
+            if (ci.surfaceId) {
+                spriteCache_.render(ci.surfaceId, colors, pixels, pitch, w, h, dx, ty);
+            }
+        }
+    }
+}
+
+void GlobalMap::renderBatched() {
+    /* same cell walk as software composition, but every sprite is queued as a quad from
+     * atlas pages, so nothing has to be uploaded to GPU per frame */
+    int cellDiffX = cellWidth_ / 2;
+    int cellDiffY = cellHeight_ / 2;
+    int nx = int(auxWidth_) / 2 + cellWidth_ * 2;
+    int ny = int(auxHeight_) / 2 + cellHeight_ * 2;
+    int ocx = (nx / cellDiffX + ny / cellDiffY) / 2;
+    int ocy = (ny / cellDiffY - nx / cellDiffX) / 2;
+    int wcount = nx * 2 / cellWidth_;
+    int hcount = (ny * 2 + 4 * cellHeight_) / cellDiffY;
+    int otx = -(ocx - ocy) * cellDiffX;
+    int oty = cellDiffY - (ocx + ocy) * cellDiffY;
+    ocx = cameraX_ - ocx; ocy = cameraY_ - ocy;
+    int centerX = x_ + (width_ >> 1), centerY = y_ + (height_ >> 1);
+    auto batch = [this, centerX, centerY](std::int16_t id, int dx, int dy) {
+        const auto *tex = getOrLoadTexture(id);
+        if (!tex) { return; }
+        renderer_->batchTexture(tex, centerX + dx * scale_.first / scale_.second,
+                                centerY + dy * scale_.first / scale_.second, scale_);
+    };
+    bool charRendered = false;
+    for (int pass = 0; pass < 2; ++pass) {
+        int cx = ocx, cy = ocy, tx = otx, ty = oty;
+        for (int j = hcount; j; --j) {
+            int x = cx, y = cy;
+            int dx = tx;
+            for (int i = wcount; i; --i, dx += cellWidth_, ++x, --y) {
+                if (x < 0 || x >= GlobalMapWidth || y < 0 || y >= GlobalMapHeight) {
+                    if (pass == 0) { batch(0, dx, ty); }
+                    continue;
+                }
+                auto &ci = cellInfo_[y * mapWidth_ + x];
+                if (pass == 0) {
+                    batch(ci.earthId, dx, ty);
+                    if (ci.surfaceId) { batch(ci.surfaceId, dx, ty); }
+                    continue;
+                }
+                if (ci.buildingId) {
+                    batch(ci.buildingId, dx, ty + ci.buildingDeltaY);
+                }
+                if (x == currX_ && y == currY_) {
+                    renderer_->flushBatch();
+                    renderChar();
+                    charRendered = true;
+                }
+            }
+            if (j % 2) {
+                ++cx;
+                tx += cellDiffX;
+                ty += cellDiffY;
+            } else {
+                ++cy;
+                tx -= cellDiffX;
+                ty += cellDiffY;
+            }
+        }
+    }
+    renderer_->flushBatch();
+    if (!charRendered) { renderChar(); }
+}
+
 void GlobalMap::updateMainCharTexture() {
     if (onShip_) {
         mainCharTex_ = getOrLoadTexture(3715 + int(direction_) * 4 + currMainCharFrame_);
@@ -420,4 +556,8 @@ bool GlobalMap::checkTime() {
     return MapWithEvent::checkTime();
 }
 
+bool GlobalMap::mainCharAnimating() const {
+    return !onShip_ && MapWithEvent::mainCharAnimating();
+}
+
 }
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "mapwithevent.hh"
+#include "scrollbuffer.hh"
 
 #include <map>
 
@@ -37,27 +38,40 @@ public:
     GlobalMap(Renderer *renderer, int x, int y, int width, int height, std::pair<int, int> scale);
     ~GlobalMap() override;
 
+    /* read map data and sprites, does not touch renderer so it is safe to run in worker thread */
+    void loadData();
+    /* upload textures on render thread, after loadData() */
+    void initTextures();
     void load();
     void update() override;
     void render() override;
+    [[nodiscard]] std::uint64_t nextWakeTime() const override;
     [[nodiscard]] bool onShip() const { return onShip_; }
 
 protected:
     void showShip(bool show);
+    void paintGround(std::uint32_t *pixels, int pitch, int x, int y, int w, int h);
+    void renderBatched();
     bool tryMove(int x, int y, bool checkEvent) override;
     void updateMainCharTexture() override;
     void resetTime() override;
     bool checkTime() override;
+    [[nodiscard]] bool mainCharAnimating() const override;
 
 private:
     bool onShip_ = false;
     Texture *drawingTerrainTex2_ = nullptr;
     std::vector<std::uint16_t> building_, buildx_, buildy_;
     std::vector<CellInfo> cellInfo_;
+    ScrollBuffer groundBuffer_;
+    /* max extents of earth/surface sprites around cell position */
+    int groundLeft_ = 0, groundTop_ = 0, groundRight_ = 0, groundBottom_ = 0;
     TextureMgr cloudTexMgr_;
     int cloudStartX_[3] = {}, cloudStartY_[3] = {};
     int cloudX_[3] = {}, cloudY_[3] = {};
     const Texture *cloud_[3] = {};
+    /* time for next cloud to appear in each empty slot, 0 if not rolled yet */
+    std::uint64_t cloudTime_[3] = {};
     std::map<std::pair<std::int16_t, std::int16_t>, std::int16_t> subMapEntries_;
 };
 
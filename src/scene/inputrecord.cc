@@ -0,0 +1,147 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "inputrecord.hh"
+
+#include "util/conv.hh"
+#include "util/file.hh"
+#include <fmt/format.h>
+#include <iterator>
+#include <sstream>
+
+namespace hojy::scene {
+
+InputRecord gInputRecord;
+
+static const char *const keyNames[] = {
+    "none", "up", "down", "left", "right", "ok", "cancel", "space", "backspace",
+};
+
+InputRecord::~InputRecord() {
+    if (file_) { std::fclose(file_); }
+}
+
+bool InputRecord::startRecording(const std::string &filename, std::uint64_t seed, const std::string &engine) {
+    file_ = std::fopen(filename.c_str(), "w");
+    if (!file_) {
+        fmt::print(stderr, "Unable to write input record {}\n", filename);
+        return false;
+    }
+    mode_ = Recording;
+    fmt::print(file_, "# input record, `f <time>` for each frame, `k <time> <key>` for keys, `t <time> <text>` for text input\n");
+    fmt::print(file_, "seed {} {}\n", seed, engine);
+    return true;
+}
+
+bool InputRecord::startReplaying(const std::string &filename) {
+    std::istringstream iss(util::File::getFileContent(filename));
+    std::string line;
+    int lineNo = 0;
+    entries_.clear();
+    pos_ = 0;
+    while (std::getline(iss, line)) {
+        ++lineNo;
+        if (line.empty() || line[0] == '#') { continue; }
+        std::istringstream ls(line);
+        std::string op;
+        ls >> op;
+        bool ok;
+        if (op == "seed") {
+            ok = bool(ls >> seed_ >> engine_);
+        } else if (op == "f") {
+            Entry entry {0, -1};
+            ok = bool(ls >> entry.time);
+            if (ok) { entries_.emplace_back(std::move(entry)); }
+        } else if (op == "k") {
+            Entry entry {0, -1};
+            std::string name;
+            ok = bool(ls >> entry.time >> name);
+            for (int i = 0; ok && i < int(std::size(keyNames)); ++i) {
+                if (name == keyNames[i]) { entry.key = i; }
+            }
+            ok = ok && entry.key > 0;
+            if (ok) { entries_.emplace_back(std::move(entry)); }
+        } else if (op == "t") {
+            Entry entry {0, Node::KeyNone};
+            ok = bool(ls >> entry.time);
+            if (ok) {
+                std::string text;
+                ls.get();
+                std::getline(ls, text);
+                entry.text = util::Utf8Conv::toUnicode(text);
+                entries_.emplace_back(std::move(entry));
+            }
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fmt::print(stderr, "Invalid input record line {}: {}\n", lineNo, line);
+            return false;
+        }
+    }
+    if (entries_.empty()) {
+        fmt::print(stderr, "Empty input record {}\n", filename);
+        return false;
+    }
+    mode_ = Replaying;
+    fmt::print("Replaying {} entries from {}\n", entries_.size(), filename);
+    return true;
+}
+
+void InputRecord::recordFrame(std::uint64_t time) {
+    if (mode_ != Recording) { return; }
+    fmt::print(file_, "f {}\n", time);
+}
+
+void InputRecord::recordKey(std::uint64_t time, Node::Key key) {
+    if (mode_ != Recording) { return; }
+    fmt::print(file_, "k {} {}\n", time, keyNames[key]);
+}
+
+void InputRecord::recordText(std::uint64_t time, const std::wstring &text) {
+    if (mode_ != Recording) { return; }
+    fmt::print(file_, "t {} {}\n", time, util::Utf8Conv::fromUnicode(text));
+}
+
+bool InputRecord::nextFrame(std::uint64_t &time) {
+    if (mode_ != Replaying) { return false; }
+    /* inputs not consumed by last frame are dropped, they never happen while replay is in sync */
+    while (pos_ < entries_.size() && entries_[pos_].key >= 0) { ++pos_; }
+    if (pos_ >= entries_.size()) { return false; }
+    time = entries_[pos_++].time;
+    return true;
+}
+
+bool InputRecord::nextEvent(Event &ev) {
+    if (mode_ != Replaying || pos_ >= entries_.size() || entries_[pos_].key < 0) { return false; }
+    auto &entry = entries_[pos_++];
+    ev.time = entry.time;
+    ev.key = Node::Key(entry.key);
+    ev.text = std::move(entry.text);
+    return true;
+}
+
+std::uint64_t InputRecord::nextFrameTime() const {
+    for (auto i = pos_; i < entries_.size(); ++i) {
+        if (entries_[i].key < 0) { return entries_[i].time; }
+    }
+    return Node::NoWakeTime;
+}
+
+}
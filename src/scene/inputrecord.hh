@@ -0,0 +1,85 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "node.hh"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+
+namespace hojy::scene {
+
+/* Records input delivered to nodes together with update times of each frame, and replays them instead of
+ * real input, so a session runs the same game logic again (with same random seed) for profiling.
+ * Times are microseconds since window creation */
+class InputRecord final {
+public:
+    enum Mode {
+        Off,
+        Recording,
+        Replaying,
+    };
+    struct Event {
+        std::uint64_t time;
+        /* KeyNone for text input */
+        Node::Key key;
+        std::wstring text;
+    };
+
+    ~InputRecord();
+
+    bool startRecording(const std::string &filename, std::uint64_t seed, const std::string &engine);
+    bool startReplaying(const std::string &filename);
+    [[nodiscard]] inline Mode mode() const { return mode_; }
+    /* random seed and engine name recorded, valid after startReplaying() */
+    [[nodiscard]] inline std::uint64_t seed() const { return seed_; }
+    [[nodiscard]] inline const std::string &engine() const { return engine_; }
+
+    void recordFrame(std::uint64_t time);
+    void recordKey(std::uint64_t time, Node::Key key);
+    void recordText(std::uint64_t time, const std::wstring &text);
+
+    /* move to next recorded frame, returns false if the record ends */
+    bool nextFrame(std::uint64_t &time);
+    /* pop next input of current frame, returns false if there is no more */
+    bool nextEvent(Event &ev);
+    /* time of next frame, NoWakeTime if the record ends */
+    [[nodiscard]] std::uint64_t nextFrameTime() const;
+
+private:
+    struct Entry {
+        std::uint64_t time;
+        /* -1 for frame start */
+        int key;
+        std::wstring text;
+    };
+    Mode mode_ = Off;
+    std::FILE *file_ = nullptr;
+    std::uint64_t seed_ = 0;
+    std::string engine_;
+    std::vector<Entry> entries_;
+    size_t pos_ = 0;
+};
+
+extern InputRecord gInputRecord;
+
+}
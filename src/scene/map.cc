@@ -52,10 +52,9 @@ Map::~Map() {
     delete drawingTerrainTex_;
 }
 
-const std::string &Map::texData(std::int16_t id) const {
+std::string_view Map::texData(std::int16_t id) const {
     if (id < 0 || id >= texData_.size()) {
-        static const std::string dummy;
-        return dummy;
+        return {};
     }
     return texData_[id];
 }
@@ -76,6 +75,10 @@ void Map::render() {
     }
 }
 
+std::uint64_t Map::nextWakeTime() const {
+    return drawDirty_ ? 0 : NoWakeTime;
+}
+
 Map::Direction Map::calcDirection(int fx, int fy, int tx, int ty) {
     (void)this;
     int dx = tx - fx, dy = ty - fy;
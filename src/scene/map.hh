@@ -21,6 +21,8 @@
 
 #include "node.hh"
 #include "texture.hh"
+#include "spritecache.hh"
+#include "data/grpdata.hh"
 
 #include <cstdint>
 
@@ -43,12 +45,13 @@ public:
     ~Map() override;
 
     [[nodiscard]] std::int16_t subMapId() const { return subMapId_; }
-    [[nodiscard]] const std::string &texData(std::int16_t id) const;
+    [[nodiscard]] std::string_view texData(std::int16_t id) const;
     [[nodiscard]] const Texture *getOrLoadTexture(std::int16_t id);
 
     void resetFrame();
 
     void render() override;
+    [[nodiscard]] std::uint64_t nextWakeTime() const override;
 
 protected:
     Direction calcDirection(int fx, int fy, int tx, int ty);
@@ -73,7 +76,8 @@ protected:
     std::uint64_t eachFrameTime_ = 0;
     std::int32_t mapWidth_ = 0, mapHeight_ = 0, cellWidth_ = 0, cellHeight_ = 0;
     std::int32_t offsetX_ = 0, offsetY_ = 0;
-    std::vector<std::string> texData_;
+    data::GrpView texData_;
+    SpriteCache spriteCache_;
     Texture *drawingTerrainTex_ = nullptr;
     Texture *miniMapTex_ = nullptr;
     Texture *miniPanelTex_ = nullptr;
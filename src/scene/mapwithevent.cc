@@ -327,6 +327,18 @@ void MapWithEvent::update() {
     }
 }
 
+std::uint64_t MapWithEvent::nextWakeTime() const {
+    auto res = Map::nextWakeTime();
+    if (!moving_.empty() || animCurrTex_[0] != 0) {
+        res = std::min(res, nextFrameTime_);
+    }
+    /* resting animation of main char, see checkTime() */
+    if (mainCharAnimating()) {
+        res = std::min(res, nextMainTexTime_);
+    }
+    return res;
+}
+
 void MapWithEvent::handleKeyInput(Node::Key key) {
     switch (key) {
     case KeyUp:
@@ -995,7 +1007,7 @@ int MapWithEvent::checkHas5Item(MapWithEvent *map, std::int16_t itemId0, std::in
 }
 
 bool MapWithEvent::tutorialTalk(MapWithEvent *map) {
-    return doTalk(map, 2547 + util::gRandom(18), 114, 0);
+    return doTalk(map, 2547 + util::gWorldRandom(18), 114, 0);
 }
 
 bool MapWithEvent::showIntegrity(MapWithEvent *map) {
@@ -1054,9 +1066,9 @@ bool MapWithEvent::tournament(MapWithEvent *map) {
     };
 
     for (int i = 0; i < 15; ++i) {
-        int n = util::gRandom(2);
+        int n = util::gWorldRandom(2);
         map->pendingSubEvents_.emplace_back([map, i, n] {
-            doTalk(map, 2854 + i * 2 + n, heads[i * 2 + n], util::gRandom(2) * 4 + util::gRandom(2));
+            doTalk(map, 2854 + i * 2 + n, heads[i * 2 + n], util::gWorldRandom(2) * 4 + util::gWorldRandom(2));
             return false;
         });
         map->pendingSubEvents_.emplace_back([i, n] {
@@ -1224,7 +1236,7 @@ bool MapWithEvent::randomShop(MapWithEvent *map) {
             break;
         }
     }
-    const auto &evi = shopEventInfo[util::gRandom(5)];
+    const auto &evi = shopEventInfo[util::gShopRandom(5)];
     auto &ev = mem::gSaveData.subMapEventInfo[evi.subMapId]->events[evi.shopEventIndex];
     ev.blocked = 1;
     ev.event[0] = data::ShopEventId;
@@ -1330,7 +1342,7 @@ bool MapWithEvent::runExtendedEvent(MapWithEvent *map, std::int16_t v0, std::int
     case 8: {
         auto val = movCmd(v1, v2, 1);
         auto *ptr = &extendedRAM_[v3];
-        const auto &str = data::gEvent.origTalk(val);
+        auto str = data::gEvent.origTalk(val);
         memcpy(&extendedRAM_[v3], str.data(), str.length() + 1);
         break;
     }
@@ -1542,7 +1554,7 @@ bool MapWithEvent::runExtendedEvent(MapWithEvent *map, std::int16_t v0, std::int
     }
     case 38: {
         auto n0 = movCmd(v1, v2, 1);
-        extendedRAM_[v3] = util::gRandom(n0);
+        extendedRAM_[v3] = util::gWorldRandom(n0);
         break;
     }
     case 39:
@@ -45,6 +45,7 @@ public:
 
     void update() override;
     void handleKeyInput(Key key) override;
+    [[nodiscard]] std::uint64_t nextWakeTime() const override;
 
 protected:
     void doInteract();
@@ -61,6 +62,7 @@ protected:
     void resetTime() override;
     void frameUpdate() override;
     virtual bool checkTime();
+    [[nodiscard]] virtual bool mainCharAnimating() const { return animEventId_[0] >= 0; }
     virtual void setCellTexture(int x, int y, int layer, std::int16_t tex) {}
 
     void ensureExtendedNode();
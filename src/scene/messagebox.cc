@@ -70,28 +70,13 @@ void MessageBox::makeCache() {
     auto windowBorder = core::config.windowBorder();
 
     std::vector<std::wstring> lines;
-    size_t widthMax = width_ - windowBorder * 2;
+    int widthMax = width_ - windowBorder * 2;
     int textW = 0, textH;
     for (auto &l: text_) {
-        size_t w = 0;
-        size_t len = l.length();
-        size_t idx = 0;
-        for (size_t i = 0; i < len; ++i) {
-            auto ch = l[i];
-            std::uint8_t width;
-            std::int8_t y0, y1;
-            ttf->charDimension(ch, width, y0, y1);
-            w += width;
-            if (w > widthMax) {
-                textW = std::max(textW, int(w - width));
-                lines.emplace_back(l.substr(idx, i - idx));
-                idx = i;
-                w = width;
-            }
-        }
-        if (idx < len) {
-            textW = std::max(textW, int(w));
-            lines.emplace_back(l.substr(idx));
+        const auto &lo = ttf->layout(l, widthMax);
+        textW = std::max(textW, lo.width);
+        for (const auto &tl: lo.lines) {
+            lines.emplace_back(l.substr(tl.start, tl.length));
         }
     }
     textW += windowBorder * 2;
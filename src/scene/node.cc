@@ -20,6 +20,7 @@
 #include "node.hh"
 
 #include "mask.hh"
+#include "core/profiler.hh"
 
 #include <algorithm>
 
@@ -81,6 +82,7 @@ void Node::doUpdate() {
 }
 
 void Node::doRender() {
+    PROFILE_SCOPE("render");
     render();
     for (auto *node : children_) {
         node->doRender();
@@ -103,6 +105,16 @@ void Node::doTextInput(const std::wstring &str) {
     children_.back()->doTextInput(str);
 }
 
+std::uint64_t Node::doNextWakeTime() const {
+    if (fadeNode_ || runFadePostAction_) { return 0; }
+    auto res = nextWakeTime();
+    for (auto *node : children_) {
+        if (res == 0) { break; }
+        res = std::min(res, node->doNextWakeTime());
+    }
+    return res;
+}
+
 void Node::removeAllChildren() {
     for (auto *n: children_) {
         n->parent_ = nullptr;
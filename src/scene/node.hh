@@ -23,6 +23,7 @@
 
 #include <vector>
 #include <functional>
+#include <cstdint>
 
 namespace hojy::scene {
 
@@ -40,6 +41,7 @@ public:
         KeySpace,
         KeyBackspace,
     };
+    static constexpr std::uint64_t NoWakeTime = ~0ULL;
 public:
     Node(Node *parent, int x, int y, int width, int height);
     Node(Renderer *renderer, int x, int y, int width, int height): parent_(nullptr), renderer_(renderer), x_(x), y_(y), width_(width), height_(height) {}
@@ -64,12 +66,16 @@ public:
     virtual void render() = 0;
     virtual void handleKeyInput(Key key) {}
     virtual void handleTextInput(const std::wstring &str) {}
+    /* time (same clock as Window::currTime()) this node needs next update at,
+     * 0 if it animates every frame, NoWakeTime if it only changes on input */
+    [[nodiscard]] virtual std::uint64_t nextWakeTime() const { return NoWakeTime; }
 
 protected:
     void doUpdate();
     void doRender();
     void doHandleKeyInput(Key key);
     void doTextInput(const std::wstring &str);
+    [[nodiscard]] std::uint64_t doNextWakeTime() const;
     void removeAllChildren();
 
 protected:
@@ -21,13 +21,33 @@
 
 #include "window.hh"
 #include "core/config.hh"
+#include "core/profiler.hh"
 #include <SDL2_gfxPrimitives.h>
+#include <vector>
 
 namespace hojy::scene {
 
+struct RenderBatch {
+    SDL_Texture *texture = nullptr;
+    float invWidth = 0.f, invHeight = 0.f;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+#endif
+};
+
+static SDL_Renderer *createRenderer(SDL_Window *win) {
+    auto *renderer = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE);
+    if (!renderer) {
+        /* no GPU renderer available, e.g. running with dummy/offscreen video driver */
+        renderer = SDL_CreateRenderer(win, -1, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE);
+    }
+    return renderer;
+}
+
 Renderer::Renderer(void *win, int w, int h):
-    renderer_(SDL_CreateRenderer(static_cast<SDL_Window*>(win), -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_TARGETTEXTURE)),
-    ttf_(new TTF(this)) {
+    renderer_(createRenderer(static_cast<SDL_Window*>(win))),
+    ttf_(new TTF(this)), batch_(new RenderBatch) {
     if (core::config.limitFPS() > 0) {
         renderInterval_ = 1000 * 1000;
         renderInterval_ /= core::config.limitFPS();
@@ -48,6 +68,7 @@ Renderer::Renderer(void *win, int w, int h):
 }
 
 Renderer::~Renderer() {
+    delete static_cast<RenderBatch*>(batch_);
     delete ttf_;
     SDL_DestroyRenderer(static_cast<SDL_Renderer*>(renderer_));
 }
@@ -140,6 +161,60 @@ void Renderer::renderTexture(const Texture *tex, int destx, int desty, int destw
     }
 }
 
+void Renderer::batchTexture(const Texture *tex, int x, int y, std::pair<int, int> scale) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    auto *batch = static_cast<RenderBatch*>(batch_);
+    auto *texture = static_cast<SDL_Texture*>(tex->data());
+    if (texture != batch->texture) {
+        flushBatch();
+        int w, h;
+        SDL_QueryTexture(texture, nullptr, nullptr, &w, &h);
+        batch->texture = texture;
+        batch->invWidth = 1.f / float(w);
+        batch->invHeight = 1.f / float(h);
+    }
+    auto w = tex->width(), h = tex->height();
+    float l = float(x - tex->originX() * scale.first / scale.second);
+    float t = float(y - tex->originY() * scale.first / scale.second);
+    float r = l + float(w * scale.first / scale.second);
+    float b = t + float(h * scale.first / scale.second);
+    float u0 = float(tex->x()) * batch->invWidth, v0 = float(tex->y()) * batch->invHeight;
+    float u1 = float(tex->x() + w) * batch->invWidth, v1 = float(tex->y() + h) * batch->invHeight;
+    const SDL_Color c {255, 255, 255, 255};
+    auto base = int(batch->vertices.size());
+    batch->vertices.push_back({{l, t}, c, {u0, v0}});
+    batch->vertices.push_back({{r, t}, c, {u1, v0}});
+    batch->vertices.push_back({{l, b}, c, {u0, v1}});
+    batch->vertices.push_back({{r, b}, c, {u1, v1}});
+    for (int i: {0, 1, 2, 2, 1, 3}) {
+        batch->indices.push_back(base + i);
+    }
+#else
+    renderTexture(tex, x, y, scale);
+#endif
+}
+
+void Renderer::renderGeometry(const Texture *tex, const void *vertices, int vertexCount, const int *indices, int indexCount) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    SDL_RenderGeometry(static_cast<SDL_Renderer*>(renderer_), tex ? static_cast<SDL_Texture*>(tex->data()) : nullptr,
+                       static_cast<const SDL_Vertex*>(vertices), vertexCount, indices, indexCount);
+#endif
+}
+
+void Renderer::flushBatch() {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    auto *batch = static_cast<RenderBatch*>(batch_);
+    if (!batch->indices.empty()) {
+        SDL_RenderGeometry(static_cast<SDL_Renderer*>(renderer_), batch->texture,
+                           batch->vertices.data(), int(batch->vertices.size()),
+                           batch->indices.data(), int(batch->indices.size()));
+        batch->vertices.clear();
+        batch->indices.clear();
+    }
+    batch->texture = nullptr;
+#endif
+}
+
 bool Renderer::canRender() {
     auto now = gWindow->currTime();
     if (renderInterval_) {
@@ -158,6 +233,7 @@ bool Renderer::canRender() {
 }
 
 void Renderer::present() {
+    PROFILE_SCOPE("present");
     SDL_RenderPresent(static_cast<SDL_Renderer*>(renderer_));
     ++frameCount_;
 }
@@ -48,6 +48,12 @@ public:
     void renderTexture(const Texture *tex, int x, int y, std::pair<int, int> scale, bool ignoreOrigin = false);
     void renderTexture(const Texture *tex, int destx, int desty, int x, int y, int w, int h, bool ignoreOrigin = false);
     void renderTexture(const Texture *tex, int destx, int desty, int destw, int desth, int x, int y, int w, int h, bool ignoreOrigin = false);
+    /* Queue texture for batched rendering, queued quads are drawn with a single call
+     * for each run of textures sharing the same atlas page */
+    void batchTexture(const Texture *tex, int x, int y, std::pair<int, int> scale);
+    void flushBatch();
+    /* Draw indexed triangles of `SDL_Vertex` array with a single call, vertex colors modulate tex */
+    void renderGeometry(const Texture *tex, const void *vertices, int vertexCount, const int *indices, int indexCount);
 
     bool canRender();
     void present();
@@ -59,6 +65,7 @@ private:
     float fps_ = 0.f;
     void *renderer_ = nullptr;
     TTF *ttf_ = nullptr;
+    void *batch_ = nullptr;
 
     int frameCount_ = 0;
     std::uint64_t nextCountTime_ = 0;
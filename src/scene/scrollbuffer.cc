@@ -0,0 +1,87 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "scrollbuffer.hh"
+
+#include <cstring>
+#include <cstdlib>
+
+namespace hojy::scene {
+
+void ScrollBuffer::resize(int viewWidth, int viewHeight, int margin) {
+    viewWidth_ = viewWidth;
+    viewHeight_ = viewHeight;
+    margin_ = margin;
+    width_ = viewWidth + margin * 2;
+    height_ = viewHeight + margin * 2;
+    pixels_.assign(size_t(width_) * size_t(height_), 0);
+    valid_ = false;
+}
+
+const std::uint32_t *ScrollBuffer::scrollTo(int x, int y, const PaintFunc &paint) {
+    if (valid_ && x >= originX_ && y >= originY_ && x + viewWidth_ <= originX_ + width_ && y + viewHeight_ <= originY_ + height_) {
+        return pixels_.data() + (y - originY_) * width_ + (x - originX_);
+    }
+    int nx = x - margin_, ny = y - margin_;
+    int dx = nx - originX_, dy = ny - originY_;
+    originX_ = nx;
+    originY_ = ny;
+    if (!valid_ || std::abs(dx) >= width_ || std::abs(dy) >= height_) {
+        valid_ = true;
+        paintRect(0, 0, width_, height_, paint);
+        return pixels_.data() + margin_ * width_ + margin_;
+    }
+    /* move kept pixels to their new place */
+    int srcX = dx > 0 ? dx : 0, dstX = dx > 0 ? 0 : -dx;
+    auto rowSize = size_t(width_ - std::abs(dx)) * sizeof(std::uint32_t);
+    int rows = height_ - std::abs(dy);
+    if (dy >= 0) {
+        for (int j = 0; j < rows; ++j) {
+            memmove(&pixels_[(j * width_) + dstX], &pixels_[(j + dy) * width_ + srcX], rowSize);
+        }
+    } else {
+        for (int j = rows - 1; j >= 0; --j) {
+            memmove(&pixels_[(j - dy) * width_ + dstX], &pixels_[j * width_ + srcX], rowSize);
+        }
+    }
+    /* paint exposed rows, then exposed columns of the remaining rows */
+    int top = 0;
+    if (dy > 0) {
+        paintRect(0, rows, width_, dy, paint);
+    } else if (dy < 0) {
+        paintRect(0, 0, width_, -dy, paint);
+        top = -dy;
+    }
+    if (dx > 0) {
+        paintRect(width_ - dx, top, dx, rows, paint);
+    } else if (dx < 0) {
+        paintRect(0, top, -dx, rows, paint);
+    }
+    return pixels_.data() + margin_ * width_ + margin_;
+}
+
+void ScrollBuffer::paintRect(int x, int y, int w, int h, const PaintFunc &paint) {
+    auto *pixels = pixels_.data() + y * width_ + x;
+    for (int j = 0; j < h; ++j) {
+        memset(pixels + j * width_, 0, w * sizeof(std::uint32_t));
+    }
+    paint(pixels, width_, originX_ + x, originY_ + y, w, h);
+}
+
+}
@@ -0,0 +1,53 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <cstdint>
+
+namespace hojy::scene {
+
+/* Off-screen pixel buffer larger than the view, addressed in world pixel coordinates.
+ * Scrolling the view only paints the newly exposed areas of the buffer */
+class ScrollBuffer final {
+public:
+    /* paint world rect (x, y, w, h) into pixels, which points to the rect's top-left */
+    using PaintFunc = std::function<void(std::uint32_t *pixels, int pitch, int x, int y, int w, int h)>;
+
+public:
+    void resize(int viewWidth, int viewHeight, int margin);
+    inline void invalidate() { valid_ = false; }
+    /* Move view's top-left to world position (x, y), returns view's top-left pixel in buffer */
+    const std::uint32_t *scrollTo(int x, int y, const PaintFunc &paint);
+    [[nodiscard]] int pitch() const { return width_; }
+
+private:
+    void paintRect(int x, int y, int w, int h, const PaintFunc &paint);
+
+private:
+    std::vector<std::uint32_t> pixels_;
+    int width_ = 0, height_ = 0;
+    int viewWidth_ = 0, viewHeight_ = 0, margin_ = 0;
+    int originX_ = 0, originY_ = 0;
+    bool valid_ = false;
+};
+
+}
@@ -0,0 +1,162 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "data/consts.hh"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+namespace hojy::scene {
+
+/* Cells a warfield char can move to (moves >= 0) and cells its skills can reach after moving (moves < 0),
+ * filled by two-phase BFS on a flat grid, buffers are allocated once and reused by later calls */
+class SelectableArea final {
+public:
+    enum : int {
+        MaxWidth = data::WarFieldWidth,
+        MaxHeight = data::WarFieldHeight,
+        MaxCells = MaxWidth * MaxHeight,
+    };
+    enum : std::uint8_t {
+        CellBlocked = 1,
+        CellOccupied = 2,
+        /* occupied by a char of the same side, checked in zoe mode */
+        CellAlly = 4,
+    };
+    struct Cell {
+        int x, y, moves, ranges;
+        Cell *moveParent, *rangeParent;
+    };
+
+    inline SelectableArea(): grid_(MaxCells), stamp_(MaxCells, 0), queue_(MaxCells) {
+        cells_.reserve(MaxCells);
+    }
+    SelectableArea(const SelectableArea&) = delete;
+
+    /* cellFlags(index) returns Cell* flags of the cell at `y * width + x` */
+    template<typename F>
+    void calc(int width, int height, int x, int y, int steps, int ranges, bool zoecheck, F &&cellFlags);
+    inline void clear() {
+        cells_.clear();
+        if (++stampCurr_ == 0) {
+            std::fill(stamp_.begin(), stamp_.end(), 0);
+            stampCurr_ = 1;
+        }
+    }
+
+    [[nodiscard]] inline Cell *find(int x, int y) {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_) { return nullptr; }
+        auto index = y * width_ + x;
+        return stamp_[index] == stampCurr_ ? &grid_[index] : nullptr;
+    }
+    [[nodiscard]] inline bool empty() const { return cells_.empty(); }
+    [[nodiscard]] inline size_t size() const { return cells_.size(); }
+    /* sorted by (x, y) */
+    [[nodiscard]] inline std::vector<Cell*>::const_iterator begin() const { return cells_.begin(); }
+    [[nodiscard]] inline std::vector<Cell*>::const_iterator end() const { return cells_.end(); }
+
+private:
+    inline Cell *add(int index, int x, int y, int moves, int ranges) {
+        stamp_[index] = stampCurr_;
+        auto *c = &grid_[index];
+        *c = Cell {x, y, moves, ranges, nullptr, nullptr};
+        cells_.push_back(c);
+        return c;
+    }
+
+private:
+    std::vector<Cell> grid_;
+    std::vector<std::uint32_t> stamp_;
+    /* each cell is queued at most once in a phase, so the ring never overflows */
+    std::vector<std::int16_t> queue_;
+    std::vector<Cell*> cells_;
+    std::uint32_t stampCurr_ = 1;
+    int width_ = 0, height_ = 0;
+};
+
+template<typename F>
+void SelectableArea::calc(int width, int height, int x, int y, int steps, int ranges, bool zoecheck, F &&cellFlags) {
+    clear();
+    width_ = width;
+    height_ = height;
+    size_t head = 0, tail = 0;
+    auto push = [this, &tail](int index) {
+        queue_[tail++ % MaxCells] = std::int16_t(index);
+    };
+
+    add(y * width + x, x, y, 0, 0);
+    if (steps > 0) {
+        push(y * width + x);
+    }
+    while (head != tail) {
+        auto *mc = &grid_[queue_[head++ % MaxCells]];
+        int nx[4], ny[4], ncnt = 0;
+        /* up, right, left, down */
+        if (mc->y > 0) { nx[ncnt] = mc->x; ny[ncnt++] = mc->y - 1; }
+        if (mc->x + 1 < width) { nx[ncnt] = mc->x + 1; ny[ncnt++] = mc->y; }
+        if (mc->x > 0) { nx[ncnt] = mc->x - 1; ny[ncnt++] = mc->y; }
+        if (mc->y + 1 < height) { nx[ncnt] = mc->x; ny[ncnt++] = mc->y + 1; }
+        if (zoecheck) {
+            bool zoeblocked = false;
+            for (int i = 0; i < ncnt; ++i) {
+                if (cellFlags(ny[i] * width + nx[i]) & CellAlly) {
+                    zoeblocked = true;
+                    break;
+                }
+            }
+            if (zoeblocked) { continue; }
+        }
+        auto currMove = mc->moves + 1;
+        for (int i = 0; i < ncnt; ++i) {
+            auto index = ny[i] * width + nx[i];
+            if (stamp_[index] == stampCurr_ || (cellFlags(index) & (CellBlocked | CellOccupied))) { continue; }
+            add(index, nx[i], ny[i], currMove, 0)->moveParent = mc;
+            if (currMove < steps) { push(index); }
+        }
+    }
+    if (ranges) {
+        head = tail = 0;
+        for (auto *c: cells_) {
+            push(int(c - grid_.data()));
+        }
+        while (head != tail) {
+            auto *mc = &grid_[queue_[head++ % MaxCells]];
+            int nx[4], ny[4], ncnt = 0;
+            /* left, up, right, down */
+            if (mc->x > 0) { nx[ncnt] = mc->x - 1; ny[ncnt++] = mc->y; }
+            if (mc->y > 0) { nx[ncnt] = mc->x; ny[ncnt++] = mc->y - 1; }
+            if (mc->x + 1 < width) { nx[ncnt] = mc->x + 1; ny[ncnt++] = mc->y; }
+            if (mc->y + 1 < height) { nx[ncnt] = mc->x; ny[ncnt++] = mc->y + 1; }
+            auto currRange = mc->ranges + 1;
+            for (int i = 0; i < ncnt; ++i) {
+                auto index = ny[i] * width + nx[i];
+                if (stamp_[index] == stampCurr_ || (cellFlags(index) & CellBlocked)) { continue; }
+                add(index, nx[i], ny[i], -1, currRange)->rangeParent = mc;
+                if (currRange < ranges) { push(index); }
+            }
+        }
+    }
+    std::sort(cells_.begin(), cells_.end(), [](const Cell *a, const Cell *b) {
+        return a->x < b->x || (a->x == b->x && a->y < b->y);
+    });
+}
+
+}
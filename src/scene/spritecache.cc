@@ -0,0 +1,168 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "spritecache.hh"
+
+#include "blitter.hh"
+#include "util/bytes.hh"
+#include <fmt/format.h>
+#include <chrono>
+#include <cstring>
+
+namespace hojy::scene {
+
+/* Walk opaque runs of a RLE sprite, with the same validation as Texture::renderRLE */
+template<typename F>
+static void walkRLE(std::string_view data, F &&func) {
+    size_t left = data.size();
+    if (left < 8) { return; }
+    const auto *obuf = reinterpret_cast<const std::uint8_t*>(data.data()) + 8;
+    left -= 8;
+    std::int32_t h = util::readLE16s(data.data() + 2);
+    for (int row = 0; left && row < h; ++row) {
+        auto size = std::uint32_t(*obuf++);
+        if (--left < size) { break; }
+        const auto *buf = obuf;
+        left -= size;
+        obuf += size;
+        int x = 0;
+        while (size) {
+            auto cnt = *buf++;
+            --size;
+            if (!size) { break; }
+            x += cnt;
+            cnt = *buf++;
+            --size;
+            if (size < cnt) { break; }
+            if (cnt) {
+                func(row, x, cnt, buf);
+            }
+            x += cnt;
+            buf += cnt;
+            size -= cnt;
+        }
+    }
+}
+
+void SpriteCache::load(const std::string &name, const std::vector<std::string_view> &data) {
+    auto start = std::chrono::steady_clock::now();
+    clear();
+    size_t spanCount = 0, indexCount = 0;
+    for (const auto &d: data) {
+        int lastRow = -1, lastEnd = 0;
+        walkRLE(d, [&](int row, int x, int len, const std::uint8_t*) {
+            if (row != lastRow || x != lastEnd) {
+                ++spanCount;
+                lastRow = row;
+            }
+            lastEnd = x + len;
+            indexCount += len;
+        });
+    }
+    indicesOffset_ = spanCount * sizeof(Span);
+    arena_.resize(indicesOffset_ + indexCount);
+    auto *spans = reinterpret_cast<Span*>(arena_.data());
+    auto *indices = arena_.data() + indicesOffset_;
+    std::uint32_t spanIndex = 0, offset = 0;
+    sprites_.resize(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        const auto &d = data[i];
+        if (d.size() < 8) { continue; }
+        const auto *hdr = d.data();
+        auto &spr = sprites_[i];
+        spr.w = util::readLE16s(hdr);
+        spr.h = util::readLE16s(hdr + 2);
+        spr.x = util::readLE16s(hdr + 4);
+        spr.y = util::readLE16s(hdr + 6);
+        spr.spanStart = spanIndex;
+        /* runs without gaps in between are merged into one span */
+        walkRLE(d, [&](int row, int x, int len, const std::uint8_t *src) {
+            auto *last = spanIndex > spr.spanStart ? &spans[spanIndex - 1] : nullptr;
+            if (last && last->row == row && last->x + last->length == x) {
+                last->length += len;
+            } else {
+                spans[spanIndex++] = Span {std::int16_t(row), std::int16_t(x), std::uint16_t(len), offset};
+            }
+            memcpy(indices + offset, src, len);
+            offset += len;
+        });
+        spr.spanCount = spanIndex - spr.spanStart;
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fmt::print(stdout, "{}: decoded {} sprites to {} spans, {:.1f}KB in {:.2f}ms\n",
+               name, data.size(), spanCount, double(memUsage()) / 1024., elapsed);
+}
+
+void SpriteCache::clear() {
+    sprites_.clear();
+    arena_.clear();
+    indicesOffset_ = 0;
+}
+
+bool SpriteCache::extents(std::int32_t id, int &left, int &top, int &right, int &bottom) const {
+    if (id < 0 || size_t(id) >= sprites_.size()) { return false; }
+    const auto &spr = sprites_[id];
+    if (!spr.spanCount) { return false; }
+    left = spr.x;
+    top = spr.y;
+    right = spr.w - spr.x;
+    bottom = spr.h - spr.y;
+    return true;
+}
+
+void SpriteCache::render(std::int32_t id, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int height, int x, int y) const {
+    renderSpans(id, false, colors, pixels, pitch, pitch, height, x, y);
+}
+
+void SpriteCache::render(std::int32_t id, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int width, int height, int x, int y) const {
+    renderSpans(id, false, colors, pixels, pitch, width, height, x, y);
+}
+
+void SpriteCache::renderBlending(std::int32_t id, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int height, int x, int y) const {
+    renderSpans(id, true, colors, pixels, pitch, pitch, height, x, y);
+}
+
+void SpriteCache::renderSpans(std::int32_t id, bool blending, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int width, int height, int x, int y) const {
+    if (id < 0 || size_t(id) >= sprites_.size()) { return; }
+    const auto &spr = sprites_[id];
+    x -= spr.x;
+    y -= spr.y;
+    if (x + spr.w <= 0 || y + spr.h <= 0 || x >= width || y >= height) { return; }
+    auto run = blending ? Blitter::current().blend : Blitter::current().copy;
+    const auto *span = reinterpret_cast<const Span*>(arena_.data()) + spr.spanStart;
+    const auto *end = span + spr.spanCount;
+    const auto *indices = arena_.data() + indicesOffset_;
+    for (; span < end; ++span) {
+        int row = y + span->row;
+        if (row < 0) { continue; }
+        if (row >= height) { break; }
+        int l = x + span->x, r = l + span->length;
+        const auto *src = indices + span->offset;
+        if (l < 0) {
+            src -= l;
+            l = 0;
+        }
+        if (r > width) { r = width; }
+        if (l < r) {
+            run(pixels + row * pitch + l, src, r - l, colors);
+        }
+    }
+}
+
+}
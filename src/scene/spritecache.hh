@@ -0,0 +1,65 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace hojy::scene {
+
+/* RLE sprites pre-decoded to span tables, so that rendering does not
+ * need to re-parse and clip the RLE stream byte by byte */
+class SpriteCache final {
+public:
+    void load(const std::string &name, const std::vector<std::string_view> &data);
+    void clear();
+
+    [[nodiscard]] size_t size() const { return sprites_.size(); }
+    [[nodiscard]] size_t memUsage() const { return arena_.size() + sprites_.size() * sizeof(Sprite); }
+    /* extents of sprite around its origin, returns false for empty/invalid ones */
+    bool extents(std::int32_t id, int &left, int &top, int &right, int &bottom) const;
+
+    void render(std::int32_t id, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int height, int x, int y) const;
+    void render(std::int32_t id, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int width, int height, int x, int y) const;
+    void renderBlending(std::int32_t id, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int height, int x, int y) const;
+
+private:
+    struct Span {
+        std::int16_t row, x;
+        std::uint16_t length;
+        std::uint32_t offset;
+    };
+    struct Sprite {
+        std::int16_t w = 0, h = 0, x = 0, y = 0;
+        std::uint32_t spanStart = 0, spanCount = 0;
+    };
+
+    void renderSpans(std::int32_t id, bool blending, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int width, int height, int x, int y) const;
+
+private:
+    std::vector<Sprite> sprites_;
+    /* span table, followed by palette indices of all spans */
+    std::vector<std::uint8_t> arena_;
+    size_t indicesOffset_ = 0;
+};
+
+}
@@ -23,6 +23,8 @@
 #include "colorpalette.hh"
 #include "data/grpdata.hh"
 #include "mem/savedata.hh"
+#include "core/profiler.hh"
+#include "util/bytes.hh"
 #include <fmt/format.h>
 
 namespace hojy::scene {
@@ -41,24 +43,19 @@ bool SubMap::load(std::int16_t subMapId) {
     if (subMapLoaded_.find(subMapId) == subMapLoaded_.end()) {
         mapWidth_ = data::SubMapWidth;
         mapHeight_ = data::SubMapHeight;
-        if (data::GrpData::loadData("SDX", "SMP", texData_)) {
+        if (texData_.load("SDX", "SMP")) {
             for (std::int16_t i = 0; i < 1000; ++i) {
                 subMapLoaded_.insert(i);
             }
+            spriteCache_.load("SMP", texData_.entries());
         } else {
-            data::GrpData::DataSet dset;
-            if (!data::GrpData::loadData(fmt::format("SDX{:03}", subMapId), fmt::format("SMP{:03}", subMapId), dset)) {
+            data::GrpView dset;
+            if (!dset.load(fmt::format("SDX{:03}", subMapId), fmt::format("SMP{:03}", subMapId))) {
                 return false;
             }
-            if (dset.size() > texData_.size()) {
-                texData_.resize(dset.size());
-            }
-            for (size_t i = 0; i < dset.size(); ++i) {
-                if (dset[i].empty()) { continue; }
-                if (!texData_[i].empty()) { continue; }
-                texData_[i] = std::move(dset[i]);
-            }
+            texData_.merge(std::move(dset));
             subMapLoaded_.insert(subMapId);
+            spriteCache_.load(fmt::format("SMP{:03}", subMapId), texData_.entries());
         }
     }
     cleanupEvents();
@@ -67,17 +64,18 @@ bool SubMap::load(std::int16_t subMapId) {
     eventLoop_.resize(data::SubMapEventCount);
     eventDelay_.resize(data::SubMapEventCount);
     {
-        const auto *arr = reinterpret_cast<const uint16_t*>(texData_[0].data());
-        cellWidth_ = arr[0];
-        cellHeight_ = arr[1];
-        offsetX_ = arr[2];
-        offsetY_ = arr[3];
+        const auto *arr = texData_[0].data();
+        cellWidth_ = util::readLE16(arr);
+        cellHeight_ = util::readLE16(arr + 2);
+        offsetX_ = util::readLE16(arr + 4);
+        offsetY_ = util::readLE16(arr + 6);
     }
     int cellDiffX = cellWidth_ / 2;
     int cellDiffY = cellHeight_ / 2;
     auto size = mapWidth_ * mapHeight_;
     cellInfo_.clear();
     cellInfo_.resize(size);
+    dirtyCells_.clear();
 
     auto &layers = mem::gSaveData.subMapLayerInfo[subMapId]->data;
     auto &events = mem::gSaveData.subMapEventInfo[subMapId]->events;
@@ -116,109 +114,162 @@ void SubMap::forceMainCharTexture(std::int16_t id) {
     drawDirty_ = true;
 }
 
-void SubMap::render() {
-    Map::render();
-
-    if (drawDirty_) {
-        drawDirty_ = false;
-        int cellDiffX = cellWidth_ / 2;
-        int cellDiffY = cellHeight_ / 2;
-        int curX = currX_, curY = currY_;
-        int camX = cameraX_, camY = cameraY_;
-        int aheight = int(auxHeight_);
-        int nx = int(auxWidth_) / 2 + cellWidth_ * 2;
-        int ny = aheight / 2 + cellHeight_ * 2;
-        int wcount = nx * 2 / cellWidth_;
-        int hcount = (ny * 2 + 4 * cellHeight_) / cellDiffY;
-        int cx, cy, tx, ty;
-        int delta = -mapWidth_ + 1;
+void SubMap::paintCells(int rx, int ry, int rw, int rh) {
+    int cellDiffX = cellWidth_ / 2;
+    int cellDiffY = cellHeight_ / 2;
+    int curX = currX_, curY = currY_;
+    int camX = cameraX_, camY = cameraY_;
+    int aheight = int(auxHeight_);
+    int nx = int(auxWidth_) / 2 + cellWidth_ * 2;
+    int ny = aheight / 2 + cellHeight_ * 2;
+    int wcount = nx * 2 / cellWidth_;
+    int hcount = (ny * 2 + 4 * cellHeight_) / cellDiffY;
+    int cx, cy, tx, ty;
+    int delta = -mapWidth_ + 1;
 
-        const auto *colors = gNormalPalette.colors();
-        auto *curTex = drawingTerrainTex_;
-        int pitch;
-        std::uint32_t *pixels = curTex->lock(pitch);
-        memset(pixels, 0, pitch * auxHeight_ * sizeof(std::uint32_t));
+    const auto *colors = gNormalPalette.colors();
+    auto *curTex = drawingTerrainTex_;
+    int pitch;
+    std::uint32_t *pixels = curTex->lock(pitch, rx, ry, rw, rh);
+    for (int j = 0; j < rh; ++j) {
+        memset(pixels + j * pitch, 0, rw * sizeof(std::uint32_t));
+    }
 
 /* NOTE: Do we really need to do this?
  *       Earth with height > 0 should not stack with =0 ones
  *       So I just comment it out
-        cx = (nx / cellDiffX + ny / cellDiffY) / 2;
-        cy = (ny / cellDiffY - nx / cellDiffX) / 2;
-        tx = int(auxWidth_) / 2 - (cx - cy) * cellDiffX;
-        ty = int(auxHeight_) / 2 + cellDiffY - (cx + cy) * cellDiffY;
-        cx = camX - cx; cy = camY - cy;
-        for (int j = hcount; j; --j) {
-            int x = cx, y = cy;
-            int dx = tx;
-            int offset = y * mapWidth_ + x;
-            for (int i = wcount; i; --i, dx += cellWidth_, offset += delta, ++x, --y) {
-                if (x < 0 || x >= data::SubMapWidth || y < 0 || y >= data::SubMapHeight) {
-                    continue;
-                }
-                auto &ci = cellInfo_[offset];
-                auto h = ci.buildingDeltaY;
-                if (h == 0) {
-                    renderer_->renderTexture(ci.earth, dx, ty);
-                }
+    cx = (nx / cellDiffX + ny / cellDiffY) / 2;
+    cy = (ny / cellDiffY - nx / cellDiffX) / 2;
+    tx = int(auxWidth_) / 2 - (cx - cy) * cellDiffX;
+    ty = int(auxHeight_) / 2 + cellDiffY - (cx + cy) * cellDiffY;
+    cx = camX - cx; cy = camY - cy;
+    for (int j = hcount; j; --j) {
+        int x = cx, y = cy;
+        int dx = tx;
+        int offset = y * mapWidth_ + x;
+        for (int i = wcount; i; --i, dx += cellWidth_, offset += delta, ++x, --y) {
+            if (x < 0 || x >= data::SubMapWidth || y < 0 || y >= data::SubMapHeight) {
+                continue;
             }
-            if (j % 2) {
-                ++cx;
-                tx += cellDiffX;
-                ty += cellDiffY;
-            } else {
-                ++cy;
-                tx -= cellDiffX;
-                ty += cellDiffY;
+            auto &ci = cellInfo_[offset];
+            auto h = ci.buildingDeltaY;
+            if (h == 0) {
+                renderer_->renderTexture(ci.earth, dx, ty);
             }
         }
+        if (j % 2) {
+            ++cx;
+            tx += cellDiffX;
+            ty += cellDiffY;
+        } else {
+            ++cy;
+            tx -= cellDiffX;
+            ty += cellDiffY;
+        }
+    }
  */
-        cx = (nx / cellDiffX + ny / cellDiffY) / 2;
-        cy = (ny / cellDiffY - nx / cellDiffX) / 2;
-        tx = int(auxWidth_) / 2 - (cx - cy) * cellDiffX;
-        ty = int(auxHeight_) / 2 + cellDiffY - (cx + cy) * cellDiffY;
-        cx = camX - cx; cy = camY - cy;
-        int texCount = texData_.size();
-        for (int j = hcount; j; --j) {
-            int x = cx, y = cy;
-            int dx = tx;
-            int offset = y * mapWidth_ + x;
-            for (int i = wcount; i; --i, dx += cellWidth_, offset += delta, ++x, --y) {
-                if (x < 0 || x >= data::SubMapWidth || y < 0 || y >= data::SubMapHeight) {
-                    continue;
-                }
-                auto &ci = cellInfo_[offset];
-                auto h = ci.buildingDeltaY;
-                /* if (h > 0) {  NOTE: commented out, see notes above */
-                Texture::renderRLE(texData_[ci.earthId], colors, pixels, pitch, aheight, dx, ty);
-                /* } */
-                if (ci.buildingId > 0 && ci.buildingId < texCount) {
-                    Texture::renderRLE(texData_[ci.buildingId], colors, pixels, pitch, aheight, dx, ty - h);
-                }
-                if (x == curX && y == curY) {
-                    curTex->unlock();
-                    curTex = drawingTerrainTex2_;
-                    pixels = curTex->lock(pitch);
-                    memset(pixels, 0, pitch * auxHeight_ * sizeof(std::uint32_t));
-                    charHeight_ = h;
-                }
-                if (ci.eventId > 0 && ci.eventId < texCount) {
-                    Texture::renderRLE(texData_[ci.eventId], colors, pixels, pitch, aheight, dx, ty - h);
-                }
-                if (ci.decorationId > 0 && ci.decorationId < texCount) {
-                    Texture::renderRLE(texData_[ci.decorationId], colors, pixels, pitch, aheight, dx, ty - ci.decorationDeltaY);
+    cx = (nx / cellDiffX + ny / cellDiffY) / 2;
+    cy = (ny / cellDiffY - nx / cellDiffX) / 2;
+    tx = int(auxWidth_) / 2 - (cx - cy) * cellDiffX - rx;
+    ty = int(auxHeight_) / 2 + cellDiffY - (cx + cy) * cellDiffY - ry;
+    cx = camX - cx; cy = camY - cy;
+    int texCount = texData_.size();
+    for (int j = hcount; j; --j) {
+        int x = cx, y = cy;
+        int dx = tx;
+        int offset = y * mapWidth_ + x;
+        for (int i = wcount; i; --i, dx += cellWidth_, offset += delta, ++x, --y) {
+            if (x < 0 || x >= data::SubMapWidth || y < 0 || y >= data::SubMapHeight) {
+                continue;
+            }
+            auto &ci = cellInfo_[offset];
+            auto h = ci.buildingDeltaY;
+            /* if (h > 0) {  NOTE: commented out, see notes above */
+            spriteCache_.render(ci.earthId, colors, pixels, pitch, rw, rh, dx, ty);
+            /* } */
+            if (ci.buildingId > 0 && ci.buildingId < texCount) {
+                spriteCache_.render(ci.buildingId, colors, pixels, pitch, rw, rh, dx, ty - h);
+            }
+            if (x == curX && y == curY) {
+                curTex->unlock();
+                curTex = drawingTerrainTex2_;
+                pixels = curTex->lock(pitch, rx, ry, rw, rh);
+                for (int k = 0; k < rh; ++k) {
+                    memset(pixels + k * pitch, 0, rw * sizeof(std::uint32_t));
                 }
+                charHeight_ = h;
+            }
+            if (ci.eventId > 0 && ci.eventId < texCount) {
+                spriteCache_.render(ci.eventId, colors, pixels, pitch, rw, rh, dx, ty - h);
             }
-            if (j % 2) {
-                ++cx;
-                tx += cellDiffX;
-                ty += cellDiffY;
-            } else {
-                ++cy;
-                tx -= cellDiffX;
-                ty += cellDiffY;
+            if (ci.decorationId > 0 && ci.decorationId < texCount) {
+                spriteCache_.render(ci.decorationId, colors, pixels, pitch, rw, rh, dx, ty - ci.decorationDeltaY);
             }
         }
-        curTex->unlock();
+        if (j % 2) {
+            ++cx;
+            tx += cellDiffX;
+            ty += cellDiffY;
+        } else {
+            ++cy;
+            tx -= cellDiffX;
+            ty += cellDiffY;
+        }
+    }
+    curTex->unlock();
+}
+
+void SubMap::paintDirtyCells() {
+    int cellDiffX = cellWidth_ / 2;
+    int cellDiffY = cellHeight_ / 2;
+    int awidth = int(auxWidth_), aheight = int(auxHeight_);
+    struct Rect {
+        int l, t, r, b;
+    };
+    std::vector<Rect> rects;
+    for (auto &dc: dirtyCells_) {
+        auto &ci = cellInfo_[dc.y * mapWidth_ + dc.x];
+        int dx = awidth / 2 + ((dc.x - cameraX_) - (dc.y - cameraY_)) * cellDiffX;
+        int dy = aheight / 2 + cellDiffY + ((dc.x - cameraX_) + (dc.y - cameraY_)) * cellDiffY - ci.buildingDeltaY;
+        Rect rc {awidth, aheight, 0, 0};
+        for (auto id: {dc.oldEventId, ci.eventId}) {
+            int el, et, er, eb;
+            if (id <= 0 || !spriteCache_.extents(id, el, et, er, eb)) { continue; }
+            rc.l = std::min(rc.l, std::max(0, dx - el));
+            rc.t = std::min(rc.t, std::max(0, dy - et));
+            rc.r = std::max(rc.r, std::min(awidth, dx + er));
+            rc.b = std::max(rc.b, std::min(aheight, dy + eb));
+        }
+        if (rc.l >= rc.r || rc.t >= rc.b) { continue; }
+        /* merge with overlapping rects, so that no pixel is painted twice */
+        for (auto ite = rects.begin(); ite != rects.end();) {
+            if (ite->l < rc.r && rc.l < ite->r && ite->t < rc.b && rc.t < ite->b) {
+                rc = {std::min(rc.l, ite->l), std::min(rc.t, ite->t), std::max(rc.r, ite->r), std::max(rc.b, ite->b)};
+                rects.erase(ite);
+                ite = rects.begin();
+                continue;
+            }
+            ++ite;
+        }
+        rects.push_back(rc);
+    }
+    dirtyCells_.clear();
+    for (auto &rc: rects) {
+        paintCells(rc.l, rc.t, rc.r - rc.l, rc.b - rc.t);
+    }
+}
+
+void SubMap::render() {
+    Map::render();
+
+    if (drawDirty_) {
+        PROFILE_SCOPE("map_composite");
+        drawDirty_ = false;
+        dirtyCells_.clear();
+        paintCells(0, 0, int(auxWidth_), int(auxHeight_));
+    } else if (!dirtyCells_.empty()) {
+        PROFILE_SCOPE("map_composite");
+        paintDirtyCells();
     }
 
     renderer_->clear(0, 0, 0, 255);
@@ -314,6 +365,18 @@ void SubMap::setCellTexture(int x, int y, int layer, std::int16_t tex) {
     drawDirty_ = true;
 }
 
+std::uint64_t SubMap::nextWakeTime() const {
+    if (!dirtyCells_.empty()) { return 0; }
+    auto res = MapWithEvent::nextWakeTime();
+    if (subMapId_ < 0 || res <= nextFrameTime_) { return res; }
+    /* looping event textures are advanced in frameUpdate() */
+    for (auto &ev: mem::gSaveData.subMapEventInfo[subMapId_]->events) {
+        if (ev.x <= 0) { break; }
+        if (ev.begTex != ev.endTex) { return nextFrameTime_; }
+    }
+    return res;
+}
+
 void SubMap::frameUpdate() {
     MapWithEvent::frameUpdate();
     auto &evlist = mem::gSaveData.subMapEventInfo[subMapId_];
@@ -338,8 +401,10 @@ void SubMap::frameUpdate() {
             ev.currTex += step;
         }
         auto &ci = cellInfo_[ev.y * mapWidth_ + ev.x];
-        ci.eventId = ev.currTex >> 1;
-        drawDirty_ = true;
+        auto frame = ev.currTex >> 1;
+        if (ci.eventId == frame) { continue; }
+        dirtyCells_.push_back({ev.x, ev.y, ci.eventId});
+        ci.eventId = frame;
     }
 }
 
@@ -40,6 +40,7 @@ public:
 
     void render() override;
     void handleKeyInput(Key key) override;
+    [[nodiscard]] std::uint64_t nextWakeTime() const override;
 
 protected:
     bool tryMove(int x, int y, bool checkEvent) override;
@@ -47,12 +48,21 @@ protected:
     void setCellTexture(int x, int y, int layer, std::int16_t tex) override;
     void frameUpdate() override;
 
+private:
+    void paintCells(int rx, int ry, int rw, int rh);
+    void paintDirtyCells();
+
 private:
     std::int16_t charHeight_ = 0;
     std::vector<CellInfo> cellInfo_;
     Texture *drawingTerrainTex2_ = nullptr;
     std::set<std::int16_t> subMapLoaded_;
     std::vector<std::int16_t> eventLoop_, eventDelay_;
+    struct DirtyCell {
+        std::int16_t x, y, oldEventId;
+    };
+    /* cells with changed event texture, redrawn without a full repaint if drawDirty_ is not set */
+    std::vector<DirtyCell> dirtyCells_;
 };
 
 }
@@ -76,14 +76,12 @@ void TalkBox::popup(const std::wstring &text, std::int16_t headId, std::int16_t
     }
 
     auto *ttf = renderer_->ttf();
-    size_t widthMax = width_ - headW - windowBorder * 3;
+    int widthMax = width_ - headW - windowBorder * 3;
     for (auto &l: lines) {
         size_t len = l.length();
         if (!len) {
             continue;
         }
-        idx = 0;
-        size_t w = 0;
         for (size_t i = 0; i < len; ++i) {
             auto &ch = l[i];
             if (ch == L'．') {
@@ -95,18 +93,9 @@ void TalkBox::popup(const std::wstring &text, std::int16_t headId, std::int16_t
                     ch = L'。';
                 }
             }
-            std::uint8_t width;
-            std::int8_t y0, y1;
-            ttf->charDimension(ch, width, y0, y1);
-            w += width;
-            if (w > widthMax) {
-                text_.emplace_back(l.substr(idx, i - idx));
-                idx = i;
-                w = width;
-            }
         }
-        if (idx < len) {
-            text_.emplace_back(l.substr(idx));
+        for (const auto &tl: ttf->layout(l, widthMax).lines) {
+            text_.emplace_back(l.substr(tl.start, tl.length));
         }
     }
     index_ = 0;
@@ -0,0 +1,320 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "targetscorer.hh"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace hojy::scene {
+
+TargetScorer::TargetScorer():
+    anchorDist_(SelectableArea::MaxCells, -1), cellIndex_(SelectableArea::MaxCells, -1),
+    areaGrid_(SelectableArea::MaxCells, 0), nearDist_(SelectableArea::MaxCells, 0) {
+    for (auto &g: lineGrid_) {
+        g.resize(SelectableArea::MaxCells, 0);
+    }
+}
+
+void TargetScorer::reset(const SelectableArea &area, int width, int height) {
+    for (auto index: cellGrid_) {
+        anchorDist_[index] = -1;
+        cellIndex_[index] = -1;
+    }
+    width_ = width;
+    height_ = height;
+    auto count = area.size();
+    cellX_.resize(count);
+    cellY_.resize(count);
+    cellGrid_.resize(count);
+    cellMoves_.resize(count);
+    cellRanges_.resize(count);
+    anchorX_.resize(count);
+    anchorY_.resize(count);
+    size_t i = 0;
+    for (const auto *c: area) {
+        const auto *n = c;
+        if (n->moves > 0) {
+            n = n->moveParent;
+        } else {
+            while (n->moves < 0) {
+                n = n->rangeParent;
+            }
+        }
+        auto index = std::int16_t(c->y * width + c->x);
+        anchorDist_[index] = std::int16_t(std::abs(c->x - n->x) + std::abs(c->y - n->y));
+        cellIndex_[index] = std::int16_t(i);
+        cellX_[i] = std::int16_t(c->x);
+        cellY_[i] = std::int16_t(c->y);
+        cellGrid_[i] = index;
+        cellMoves_[i] = std::int16_t(c->moves);
+        cellRanges_[i] = std::int16_t(c->ranges);
+        anchorX_[i] = std::int16_t(n->x);
+        anchorY_[i] = std::int16_t(n->y);
+        ++i;
+    }
+    enemyCount_ = 0;
+    skillCount_ = 0;
+    currSkill_ = 0;
+    currCell_ = 0;
+    scattered_ = false;
+    scores_.clear();
+}
+
+int TargetScorer::addEnemy(int x, int y) {
+    auto index = enemyCount_++;
+    enemyX_[index] = std::int16_t(x);
+    enemyY_[index] = std::int16_t(y);
+    enemyOrder_[index] = std::int16_t(index);
+    std::sort(enemyOrder_, enemyOrder_ + enemyCount_, [this](std::int16_t a, std::int16_t b) {
+        return enemyX_[a] < enemyX_[b] || (enemyX_[a] == enemyX_[b] && enemyY_[a] < enemyY_[b]);
+    });
+    return index;
+}
+
+int TargetScorer::addSkill(const Skill &skill) {
+    auto index = skillCount_++;
+    skills_[index] = skill;
+    return index;
+}
+
+bool TargetScorer::run(int budget) {
+    bool unlimited = budget <= 0;
+    while (currSkill_ < skillCount_) {
+        if (!unlimited && budget <= 0) { return false; }
+        const auto &skill = skills_[currSkill_];
+        const auto (*damage)[DistanceSteps] = damage_[currSkill_];
+        if (!scattered_) {
+            budget -= scatter(skill, damage);
+            scattered_ = true;
+            continue;
+        }
+        budget -= scan(skill, damage, unlimited ? 0 : budget);
+        if (currCell_ < cellX_.size()) { continue; }
+        clearGrids();
+        ++currSkill_;
+        currCell_ = 0;
+        scattered_ = false;
+    }
+    return true;
+}
+
+int TargetScorer::scatter(const Skill &skill, const int (*damage)[DistanceSteps]) {
+    int w = width_, h = height_, work = 0;
+    auto dist = [](int d) { return std::min(d, DistanceSteps - 1); };
+    switch (skill.rangeType) {
+    case 1:
+    case 2: {
+        /* enemy at (ex, ey) hits cells on its row and column within range */
+        int r = skill.skillRange;
+        lineRange_ = r;
+        auto &up = lineGrid_[0], &right = lineGrid_[1], &left = lineGrid_[2], &down = lineGrid_[3];
+        for (int e = 0; e < enemyCount_; ++e) {
+            int ex = enemyX_[e], ey = enemyY_[e];
+            const auto *dmg = damage[e];
+            int index = ey * w + ex;
+            down[index] += dmg[0];
+            int dmax[4] = {std::min(r, h - 1 - ey), std::min(r, ex), std::min(r, w - 1 - ex), std::min(r, ey)};
+            for (int d = 1; d <= dmax[0]; ++d) { up[index + d * w] += dmg[dist(d)]; }
+            for (int d = 1; d <= dmax[1]; ++d) { right[index - d] += dmg[dist(d)]; }
+            for (int d = 1; d <= dmax[2]; ++d) { left[index + d] += dmg[dist(d)]; }
+            for (int d = 1; d <= dmax[3]; ++d) { down[index - d * w] += dmg[dist(d)]; }
+            work += 1 + dmax[0] + dmax[1] + dmax[2] + dmax[3];
+        }
+        return work;
+    }
+    case 3: {
+        /* enemy hits cells within area, damage decays with distance from where the skill is used */
+        int r = skill.area;
+        areaUsed_ = true;
+        for (int e = 0; e < enemyCount_; ++e) {
+            int ex = enemyX_[e], ey = enemyY_[e];
+            const auto *dmg = damage[e];
+            int x0 = std::max(ex - r, 0), x1 = std::min(ex + r, w - 1);
+            int y0 = std::max(ey - r, 0), y1 = std::min(ey + r, h - 1);
+            for (int y = y0; y <= y1; ++y) {
+                int index = y * w + x0;
+                int dy = std::abs(y - ey);
+                for (int x = x0; x <= x1; ++x, ++index) {
+                    auto ad = anchorDist_[index];
+                    if (ad < 0) { continue; }
+                    areaGrid_[index] += dmg[dist(ad + std::abs(x - ex) + dy)];
+                }
+            }
+            work += (x1 - x0 + 1) * (y1 - y0 + 1);
+        }
+        return work;
+    }
+    default:
+        return 0;
+    }
+}
+
+int TargetScorer::scan(const Skill &skill, const int (*damage)[DistanceSteps], int budget) {
+    auto count = cellX_.size();
+    auto start = currCell_;
+    auto end = budget > 0 ? std::min(count, start + size_t(budget)) : count;
+    int w = width_;
+    auto skillIndex = skill.index;
+    switch (skill.rangeType) {
+    case 1: {
+        const auto &up = lineGrid_[0], &right = lineGrid_[1], &left = lineGrid_[2], &down = lineGrid_[3];
+        for (auto i = start; i < end; ++i) {
+            if (cellMoves_[i] < 0) { continue; }
+            auto x = cellX_[i], y = cellY_[i];
+            auto index = y * w + x;
+            int dmg[4] = {up[index], right[index], left[index], down[index]};
+            for (std::int16_t d = 0; d < 4; ++d) {
+                if (dmg[d] > 0) {
+                    scores_.emplace_back(Score {dmg[d], x, y, d, -1, skillIndex});
+                }
+            }
+        }
+        break;
+    }
+    case 2: {
+        const auto &up = lineGrid_[0], &right = lineGrid_[1], &left = lineGrid_[2], &down = lineGrid_[3];
+        for (auto i = start; i < end; ++i) {
+            if (cellMoves_[i] < 0) { continue; }
+            auto x = cellX_[i], y = cellY_[i];
+            auto index = y * w + x;
+            int dmg = up[index] + right[index] + left[index] + down[index];
+            if (dmg > 0) {
+                scores_.emplace_back(Score {dmg, x, y, x, y, skillIndex});
+            }
+        }
+        break;
+    }
+    case 3: {
+        auto range = skill.skillRange;
+        for (auto i = start; i < end; ++i) {
+            if (cellRanges_[i] > range) { continue; }
+            auto x = cellX_[i], y = cellY_[i];
+            int dmg = areaGrid_[y * w + x];
+            if (dmg > 0) {
+                scores_.emplace_back(Score {dmg, anchorX_[i], anchorY_[i], x, y, skillIndex});
+            }
+        }
+        break;
+    }
+    default: {
+        /* only cells with enemies on can be targeted, so scan enemies in (x, y) order instead of cells */
+        auto range = skill.skillRange;
+        for (int j = 0; j < enemyCount_; ++j) {
+            auto e = enemyOrder_[j];
+            auto x = enemyX_[e], y = enemyY_[e];
+            auto i = cellIndex_[y * w + x];
+            if (i < 0 || cellRanges_[i] > range) { continue; }
+            auto mx = anchorX_[i], my = anchorY_[i];
+            int distance = std::min(std::abs(mx - x) + std::abs(my - y), DistanceSteps - 1);
+            scores_.emplace_back(Score {damage[e][distance], mx, my, x, y, skillIndex});
+        }
+        currCell_ = count;
+        return enemyCount_;
+    }
+    }
+    currCell_ = end;
+    return int(end - start);
+}
+
+void TargetScorer::clearGrids() {
+    if (lineRange_ >= 0) {
+        /* walk same cells as scatter(), lines go out of selectable area */
+        int w = width_, h = height_, r = lineRange_;
+        auto &up = lineGrid_[0], &right = lineGrid_[1], &left = lineGrid_[2], &down = lineGrid_[3];
+        for (int e = 0; e < enemyCount_; ++e) {
+            int ex = enemyX_[e], ey = enemyY_[e];
+            int index = ey * w + ex;
+            down[index] = 0;
+            int dmax[4] = {std::min(r, h - 1 - ey), std::min(r, ex), std::min(r, w - 1 - ex), std::min(r, ey)};
+            for (int d = 1; d <= dmax[0]; ++d) { up[index + d * w] = 0; }
+            for (int d = 1; d <= dmax[1]; ++d) { right[index - d] = 0; }
+            for (int d = 1; d <= dmax[2]; ++d) { left[index + d] = 0; }
+            for (int d = 1; d <= dmax[3]; ++d) { down[index - d * w] = 0; }
+        }
+        lineRange_ = -1;
+    }
+    if (areaUsed_) {
+        for (auto index: cellGrid_) {
+            areaGrid_[index] = 0;
+        }
+        areaUsed_ = false;
+    }
+}
+
+std::pair<int, int> TargetScorer::farthestCell() const {
+    if (!enemyCount_) { return {-1, -1}; }
+    /* max of |x - ex| + |y - ey| over enemies only depends on extremes of ex + ey and ex - ey */
+    int minSum = enemyX_[0] + enemyY_[0], maxSum = minSum;
+    int minDiff = enemyX_[0] - enemyY_[0], maxDiff = minDiff;
+    for (int e = 1; e < enemyCount_; ++e) {
+        int sum = enemyX_[e] + enemyY_[e], diff = enemyX_[e] - enemyY_[e];
+        minSum = std::min(minSum, sum); maxSum = std::max(maxSum, sum);
+        minDiff = std::min(minDiff, diff); maxDiff = std::max(maxDiff, diff);
+    }
+    int distance = 0;
+    std::pair<int, int> res = {-1, -1};
+    for (size_t i = 0; i < cellX_.size(); ++i) {
+        if (cellMoves_[i] < 0) { continue; }
+        int sum = cellX_[i] + cellY_[i], diff = cellX_[i] - cellY_[i];
+        int dist = std::max(std::max(sum - minSum, maxSum - sum), std::max(diff - minDiff, maxDiff - diff));
+        if (dist > distance) {
+            distance = dist;
+            res = {cellX_[i], cellY_[i]};
+        }
+    }
+    return res;
+}
+
+std::pair<int, int> TargetScorer::nearestCell() {
+    if (!enemyCount_) { return {-1, -1}; }
+    /* distance field of enemies, two passes of city block distance transform */
+    int w = width_, h = height_;
+    std::fill(nearDist_.begin(), nearDist_.begin() + w * h, 0x3FFF);
+    for (int e = 0; e < enemyCount_; ++e) {
+        nearDist_[enemyY_[e] * w + enemyX_[e]] = 0;
+    }
+    for (int y = 0; y < h; ++y) {
+        for (int x = 0; x < w; ++x) {
+            auto &d = nearDist_[y * w + x];
+            if (x > 0) { d = std::min<std::int16_t>(d, nearDist_[y * w + x - 1] + 1); }
+            if (y > 0) { d = std::min<std::int16_t>(d, nearDist_[(y - 1) * w + x] + 1); }
+        }
+    }
+    for (int y = h - 1; y >= 0; --y) {
+        for (int x = w - 1; x >= 0; --x) {
+            auto &d = nearDist_[y * w + x];
+            if (x + 1 < w) { d = std::min<std::int16_t>(d, nearDist_[y * w + x + 1] + 1); }
+            if (y + 1 < h) { d = std::min<std::int16_t>(d, nearDist_[(y + 1) * w + x] + 1); }
+        }
+    }
+    int distance = 255;
+    std::pair<int, int> res = {-1, -1};
+    for (size_t i = 0; i < cellX_.size(); ++i) {
+        if (cellMoves_[i] < 0) { continue; }
+        int dist = nearDist_[cellY_[i] * w + cellX_[i]];
+        if (dist < distance) {
+            distance = dist;
+            res = {cellX_[i], cellY_[i]};
+        }
+    }
+    return res;
+}
+
+}
@@ -0,0 +1,118 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "selectablearea.hh"
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace hojy::scene {
+
+/* Scores skill targets of a warfield AI turn.
+ * Damage of each (skill, enemy) pair is tabulated by distance once per turn, line and area hits of enemies
+ * are scattered onto per-cell grids, then cells of the selectable area are scored in one pass over arrays,
+ * so scoring never walks all enemies for every cell. run() can be called repeatedly with a work budget
+ * to spread the work over frames */
+class TargetScorer final {
+public:
+    enum : int {
+        MaxSkills = data::LearnSkillCount,
+        MaxEnemies = data::WarFieldEnemyCount > data::TeamMemberCount ? data::WarFieldEnemyCount : data::TeamMemberCount,
+        /* damage is flat for distance > 10, the last step stands for all of them */
+        DistanceSteps = 12,
+    };
+    struct Skill {
+        std::int16_t index;
+        std::int16_t rangeType;
+        std::int16_t skillRange, area;
+    };
+    struct Score {
+        int score;
+        std::int16_t fx, fy, tx, ty;
+        int skillIndex;
+    };
+
+    TargetScorer();
+
+    /* start a new turn with the (already calculated) selectable area of acting char */
+    void reset(const SelectableArea &area, int width, int height);
+    /* returns enemy index */
+    int addEnemy(int x, int y);
+    /* returns skill index */
+    int addSkill(const Skill &skill);
+    /* set damage of skill to enemy at distance, kill bonus should be included */
+    inline void setDamage(int skill, int enemy, int distance, int damage) {
+        damage_[skill][enemy][distance] = damage;
+    }
+    [[nodiscard]] inline int enemyCount() const { return enemyCount_; }
+    [[nodiscard]] inline int skillCount() const { return skillCount_; }
+
+    /* score cells of all skills, stop once budget(in cells/grid writes) is used up,
+     * budget <= 0 means no limit, returns true if all skills are scored */
+    bool run(int budget);
+    [[nodiscard]] inline bool finished() const { return currSkill_ >= skillCount_; }
+    /* in same order as scanning skills then cells of selectable area */
+    [[nodiscard]] inline std::vector<Score> &scores() { return scores_; }
+
+    /* first movable cell (in area order) with the largest distance to any enemy, {-1, -1} if no enemy */
+    [[nodiscard]] std::pair<int, int> farthestCell() const;
+    /* first movable cell (in area order) with the smallest distance to any enemy, {-1, -1} if no enemy */
+    [[nodiscard]] std::pair<int, int> nearestCell();
+
+private:
+    int scatter(const Skill &skill, const int (*damage)[DistanceSteps]);
+    int scan(const Skill &skill, const int (*damage)[DistanceSteps], int budget);
+    void clearGrids();
+
+private:
+    int width_ = 0, height_ = 0;
+
+    /* cells of selectable area, in area order */
+    std::vector<std::int16_t> cellX_, cellY_, cellGrid_, cellMoves_, cellRanges_;
+    /* cell that a target cell is attacked from */
+    std::vector<std::int16_t> anchorX_, anchorY_;
+    /* distance from anchor of each grid cell, -1 if not in selectable area */
+    std::vector<std::int16_t> anchorDist_;
+    /* cell index of each grid cell, -1 if not in selectable area */
+    std::vector<std::int16_t> cellIndex_;
+
+    int enemyCount_ = 0;
+    std::int16_t enemyX_[MaxEnemies] = {}, enemyY_[MaxEnemies] = {};
+    /* enemies sorted by (x, y) */
+    std::int16_t enemyOrder_[MaxEnemies] = {};
+    int skillCount_ = 0;
+    Skill skills_[MaxSkills] = {};
+    int damage_[MaxSkills][MaxEnemies][DistanceSteps] = {};
+
+    /* accumulated damage on each grid cell, from enemies to up/right/left/down of the cell, and in area */
+    std::vector<int> lineGrid_[4], areaGrid_;
+    /* range of lines scattered, -1 if none */
+    int lineRange_ = -1;
+    bool areaUsed_ = false;
+    std::vector<std::int16_t> nearDist_;
+
+    int currSkill_ = 0;
+    size_t currCell_ = 0;
+    bool scattered_ = false;
+    std::vector<Score> scores_;
+};
+
+}
@@ -22,6 +22,9 @@
 #include "renderer.hh"
 #include "colorpalette.hh"
 #include "rectpacker.hh"
+#include "blitter.hh"
+#include "core/profiler.hh"
+#include "util/bytes.hh"
 #include <SDL.h>
 
 namespace hojy::scene {
@@ -94,6 +97,7 @@ void Texture::setBlendColor(std::uint8_t r, std::uint8_t g, std::uint8_t b, std:
 }
 
 std::uint32_t *Texture::lock(int &pitch) {
+    PROFILE_SCOPE("tex_lock");
     std::uint32_t *pixels;
     if (SDL_LockTexture(static_cast<SDL_Texture*>(data_), nullptr, reinterpret_cast<void**>(&pixels), &pitch)) {
         return nullptr;
@@ -103,6 +107,7 @@ std::uint32_t *Texture::lock(int &pitch) {
 }
 
 std::uint32_t *Texture::lock(int &pitch, int x, int y, int w, int h) {
+    PROFILE_SCOPE("tex_lock");
     std::uint32_t *pixels;
     SDL_Rect rc {x, y, w, h};
     if (SDL_LockTexture(static_cast<SDL_Texture*>(data_), &rc, reinterpret_cast<void**>(&pixels), &pitch)) {
@@ -113,13 +118,14 @@ std::uint32_t *Texture::lock(int &pitch, int x, int y, int w, int h) {
 }
 
 void Texture::unlock() {
+    PROFILE_SCOPE("tex_unlock");
     SDL_UnlockTexture(static_cast<SDL_Texture*>(data_));
 }
 
-Texture *Texture::loadFromRLE(Renderer *renderer, const std::string &data, const ColorPalette &palette) {
-    if (data.empty()) { return nullptr; }
-    const auto *arr = reinterpret_cast<const uint16_t*>(data.data());
-    auto w = arr[0], h = arr[1];
+Texture *Texture::loadFromRLE(Renderer *renderer, std::string_view data, const ColorPalette &palette) {
+    if (data.size() < 8) { return nullptr; }
+    const auto *arr = data.data();
+    auto w = util::readLE16(arr), h = util::readLE16(arr + 2);
     auto *tex = Texture::create(renderer, w, h);
     if (!tex) { return nullptr; }
     tex->enableBlendMode(true);
@@ -164,24 +170,24 @@ Texture *Texture::loadFromRAW(Renderer *renderer, const std::string &data, int w
     return tex;
 }
 
-void Texture::renderRLE(const std::string &data, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int height, int ox, int oy, bool ignoreOrigin) {
+void Texture::renderRLE(std::string_view data, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int height, int ox, int oy, bool ignoreOrigin) {
     size_t left = data.size();
     if (left < 8) {
         return;
     }
     const auto *obuf = reinterpret_cast<const std::uint8_t*>(data.data());
-    struct Header {
+    const struct {
         std::int16_t w, h, x, y;
-    };
-    const auto *hdr = reinterpret_cast<const Header*>(obuf);
+    } hdr = {util::readLE16s(obuf), util::readLE16s(obuf + 2), util::readLE16s(obuf + 4), util::readLE16s(obuf + 6)};
     obuf += 8;
     left -= 8;
     if (!ignoreOrigin) {
-        ox -= hdr->x;
-        oy -= hdr->y;
+        ox -= hdr.x;
+        oy -= hdr.y;
     }
-    std::int32_t w = hdr->w, h = hdr->h;
+    std::int32_t w = hdr.w, h = hdr.h;
     if (ox + w <= 0 || oy + h <= 0) { return; }
+    auto run = Blitter::current().copy;
     while (left && h--) {
         auto size = std::uint32_t(*obuf++);
         if (--left < size) {
@@ -208,70 +214,38 @@ void Texture::renderRLE(const std::string &data, const std::uint32_t *colors, st
                 break;
             }
             if (x < 0) {
-                if (x + cnt <= 0) {
-                    ptr += cnt;
-                    buf += cnt;
-                } else {
-                    ptr -= x;
-                    buf -= x;
-                    for (int z = x + cnt; z; --z) {
-                        *ptr++ = colors[*buf++];
-                    }
-                }
-            } else if (x + cnt > pitch) {
-                if (x >= pitch) {
-                    ptr += cnt;
-                    buf += cnt;
-                } else {
-                    for (int z = pitch - x; z; --z) {
-                        *ptr++ = colors[*buf++];
-                    }
-                    int offset = x + cnt - pitch;
-                    ptr += offset;
-                    buf += offset;
-                }
-            } else {
-                for (int z = cnt; z; --z) {
-                    *ptr++ = colors[*buf++];
+                if (x + cnt > 0) {
+                    run(ptr - x, buf - x, x + cnt, colors);
                 }
+            } else if (x < pitch) {
+                run(ptr, buf, x + cnt > pitch ? pitch - x : cnt, colors);
             }
+            ptr += cnt;
+            buf += cnt;
             x += cnt;
             size -= cnt;
         }
     }
 }
 
-inline std::uint32_t blendAlpha(std::uint32_t p1, std::uint32_t p2) {
-    static const std::uint32_t AMASK = 0xFF000000;
-    static const std::uint32_t RBMASK = 0x00FF00FF;
-    static const std::uint32_t GMASK = 0x0000FF00;
-    std::uint32_t a = (p2 & AMASK) >> 24;
-    std::uint32_t na = 255 - a;
-    std::uint32_t rb = (na * (p1 & RBMASK)) + (a * (p2 & RBMASK));
-    rb = (rb + 0x10001 + ((rb >> 8) & 0xFF00FF)) >> 8;
-    std::uint32_t g = (na * (p1 & GMASK)) + (a * (p2 & GMASK));
-    g = ((g + 1) * 257) >> 16;
-    return (rb & RBMASK) | (g & GMASK) | 0xFF000000u;
-}
-
-void Texture::renderRLEBlending(const std::string &data, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int height, int ox, int oy, bool ignoreOrigin) {
+void Texture::renderRLEBlending(std::string_view data, const std::uint32_t *colors, std::uint32_t *pixels, int pitch, int height, int ox, int oy, bool ignoreOrigin) {
     size_t left = data.size();
     if (left < 8) {
         return;
     }
     const auto *obuf = reinterpret_cast<const std::uint8_t*>(data.data());
-    struct Header {
+    const struct {
         std::int16_t w, h, x, y;
-    };
-    const auto *hdr = reinterpret_cast<const Header*>(obuf);
+    } hdr = {util::readLE16s(obuf), util::readLE16s(obuf + 2), util::readLE16s(obuf + 4), util::readLE16s(obuf + 6)};
     obuf += 8;
     left -= 8;
     if (!ignoreOrigin) {
-        ox -= hdr->x;
-        oy -= hdr->y;
+        ox -= hdr.x;
+        oy -= hdr.y;
     }
-    std::int32_t w = hdr->w, h = hdr->h;
+    std::int32_t w = hdr.w, h = hdr.h;
     if (ox + w <= 0 || oy + h <= 0) { return; }
+    auto run = Blitter::current().blend;
     while (left && h--) {
         auto size = std::uint32_t(*obuf++);
         if (--left < size) {
@@ -298,59 +272,36 @@ void Texture::renderRLEBlending(const std::string &data, const std::uint32_t *co
                 break;
             }
             if (x < 0) {
-                if (x + cnt <= 0) {
-                    ptr += cnt;
-                    buf += cnt;
-                } else {
-                    ptr -= x;
-                    buf -= x;
-                    for (int z = x + cnt; z; --z) {
-                        *ptr = blendAlpha(*ptr, colors[*buf++]);
-                        ++ptr;
-                    }
-                }
-            } else if (x + cnt > pitch) {
-                if (x >= pitch) {
-                    ptr += cnt;
-                    buf += cnt;
-                } else {
-                    for (int z = pitch - x; z; --z) {
-                        *ptr = blendAlpha(*ptr, colors[*buf++]);
-                        ++ptr;
-                    }
-                    int offset = x + cnt - pitch;
-                    ptr += offset;
-                    buf += offset;
-                }
-            } else {
-                for (int z = cnt; z; --z) {
-                    *ptr = blendAlpha(*ptr, colors[*buf++]);
-                    ++ptr;
+                if (x + cnt > 0) {
+                    run(ptr - x, buf - x, x + cnt, colors);
                 }
+            } else if (x < pitch) {
+                run(ptr, buf, x + cnt > pitch ? pitch - x : cnt, colors);
             }
+            ptr += cnt;
+            buf += cnt;
             x += cnt;
             size -= cnt;
         }
     }
 }
 
-std::uint32_t Texture::calcRLEAvgColor(const std::string &data, const std::uint32_t *colors) {
+std::uint32_t Texture::calcRLEAvgColor(std::string_view data, const std::uint32_t *colors) {
     size_t left = data.size();
     if (left < 8) {
         return 0;
     }
     const auto *buf = reinterpret_cast<const std::uint8_t*>(data.data());
-    struct Header {
+    const struct {
         std::int16_t w, h, x, y;
-    };
-    const auto *hdr = reinterpret_cast<const Header*>(buf);
-    if (hdr->w == 0 && hdr->h == 0) {
+    } hdr = {util::readLE16s(buf), util::readLE16s(buf + 2), util::readLE16s(buf + 4), util::readLE16s(buf + 6)};
+    if (hdr.w == 0 && hdr.h == 0) {
         return 0;
     }
     buf += 8;
     left -= 8;
     std::uint32_t r = 0, g = 0, b = 0, pixcount = 0;
-    std::int32_t y = 0, w = hdr->w, h = hdr->h;
+    std::int32_t y = 0, w = hdr.w, h = hdr.h;
     while (left && y < h) {
         auto size = std::uint32_t(*buf++);
         if (--left < size) {
@@ -409,13 +360,14 @@ void TextureMgr::setPalette(const ColorPalette &col) {
     palette_ = &col;
 }
 
-Texture *TextureMgr::loadFromRLE(const std::string &data, std::int16_t index) {
+Texture *TextureMgr::loadFromRLE(std::string_view data, std::int16_t index) {
     auto ite = textures_.find(index);
     if (ite != textures_.end()) {
         return ite->second;
     }
-    const auto *arr = reinterpret_cast<const uint16_t*>(data.data());
-    auto w = arr[0], h = arr[1];
+    if (data.size() < 8) { return nullptr; }
+    const auto *arr = data.data();
+    auto w = util::readLE16(arr), h = util::readLE16(arr + 2);
     std::int16_t x, y;
     auto rpidx = rectPacker_->pack(w, h, x, y);
     if (rpidx < 0) {
@@ -436,7 +388,7 @@ Texture *TextureMgr::loadFromRLE(const std::string &data, std::int16_t index) {
         Texture::renderRLE(data, palette_->colors(), pixels, pitch, h, 0, 0, true);
         tex->unlock();
     }
-    auto *texture = new TextureSlice(tex, x, y, w, h, arr[2], arr[3]);
+    auto *texture = new TextureSlice(tex, x, y, w, h, util::readLE16s(arr + 4), util::readLE16s(arr + 6));
     textures_[index] = texture;
     textureIdMax_ = std::max<std::int32_t>(index, textureIdMax_);
     return texture;
@@ -23,6 +23,9 @@
 #include "renderer.hh"
 #include "texture.hh"
 #include "util/file.hh"
+#include "core/profiler.hh"
+#include <SDL.h>
+#include <vector>
 
 #ifdef USE_FREETYPE
 #include <ft2build.h>
@@ -35,7 +38,21 @@
 
 namespace hojy::scene {
 
-TTF::TTF(Renderer *renderer): renderer_(renderer), rectpacker_(new RectPacker(RectPackWidthDefault, RectPackWidthDefault)) {
+enum {
+    LayoutCacheMax = 4096,
+};
+
+struct TextBatch {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    /* quads of a string on each atlas page, shadow quads(if any) are interleaved before their glyph quads.
+     * Kept between calls so buffers are reused */
+    std::vector<std::vector<SDL_Vertex>> pages;
+    std::vector<int> indices;
+#endif
+};
+
+TTF::TTF(Renderer *renderer): renderer_(renderer), batch_(new TextBatch),
+    rectpacker_(new RectPacker(RectPackWidthDefault, RectPackWidthDefault)) {
 #ifdef USE_FREETYPE
     FT_Init_FreeType(&ftLib_);
 #endif
@@ -43,6 +60,7 @@ TTF::TTF(Renderer *renderer): renderer_(renderer), rectpacker_(new RectPacker(Re
 
 TTF::~TTF() {
     deinit();
+    delete static_cast<TextBatch*>(batch_);
 #ifdef USE_FREETYPE
     FT_Done_FreeType(ftLib_);
 #endif
@@ -58,7 +76,10 @@ void TTF::deinit() {
         delete tex;
     }
     textures_.clear();
+    pageAlpha_.clear();
     fontCache_.clear();
+    layoutCache_.clear();
+    layouts_.clear();
     for (auto &p: fonts_) {
 #ifdef USE_FREETYPE
         FT_Done_Face(p.face);
@@ -89,21 +110,10 @@ bool TTF::add(const std::string &filename, int index) {
 
 void TTF::charDimension(std::uint32_t ch, std::uint8_t &width, std::int8_t &t, std::int8_t &b, int fontSize) {
     if (fontSize < 0) fontSize = fontSize_;
-    const FontData *fd;
-    std::uint64_t key = (std::uint64_t(fontSize) << 32) | std::uint64_t(ch);
-    auto ite = fontCache_.find(key);
-    if (ite == fontCache_.end()) {
-        fd = makeCache(ch, fontSize);
-        if (!fd) {
-            width = t = b = 0;
-            return;
-        }
-    } else {
-        fd = &ite->second;
-        if (fd->advW == 0) {
-            width = t = b = 0;
-            return;
-        }
+    const auto *fd = glyph(ch, fontSize);
+    if (!fd) {
+        width = t = b = 0;
+        return;
     }
     if (monoWidth_)
         width = std::max(fd->advW, monoWidth_);
@@ -114,15 +124,66 @@ void TTF::charDimension(std::uint32_t ch, std::uint8_t &width, std::int8_t &t, s
 }
 
 int TTF::stringWidth(const std::wstring &str, int fontSize) {
-    std::uint8_t w;
-    std::int8_t t, b;
-    int res = 0;
-    for (auto &ch: str) {
+    return layout(str, 0, fontSize).width;
+}
+
+const TTF::TextLayout &TTF::layout(std::wstring_view str, int maxWidth, int fontSize) {
+    if (fontSize < 0) fontSize = fontSize_;
+    std::uint64_t key = std::uint64_t(std::hash<std::wstring_view>()(str))
+        ^ ((std::uint64_t(fontSize) << 32 | std::uint64_t(std::uint32_t(maxWidth))) * 0x9E3779B97F4A7C15ULL);
+    std::list<TextLayout>::iterator node;
+    auto ite = layoutCache_.find(key);
+    if (ite != layoutCache_.end()) {
+        node = ite->second;
+        layouts_.splice(layouts_.begin(), layouts_, node);
+        auto &lo = *node;
+        if (lo.fontSize == fontSize && lo.maxWidth == maxWidth && lo.str == str) {
+            ++layoutHits_;
+            return lo;
+        }
+    } else if (layouts_.size() >= LayoutCacheMax) {
+        /* evict the least recently used layout, its buffers are reused for the new one */
+        node = std::prev(layouts_.end());
+        layoutCache_.erase(node->key);
+        layouts_.splice(layouts_.begin(), layouts_, node);
+        node->key = key;
+        layoutCache_.emplace(key, node);
+    } else {
+        node = layouts_.emplace(layouts_.begin());
+        node->key = key;
+        layoutCache_.emplace(key, node);
+    }
+    ++layoutMisses_;
+    auto &lo = *node;
+    lo.str = str;
+    lo.fontSize = fontSize;
+    lo.maxWidth = maxWidth;
+    lo.width = 0;
+    lo.lines.clear();
+    std::uint32_t start = 0;
+    int w = 0;
+    auto len = std::uint32_t(str.length());
+    lo.glyphs.assign(len, nullptr);
+    for (std::uint32_t i = 0; i < len; ++i) {
+        auto ch = str[i];
         if (ch < 32) { continue; }
-        charDimension(ch, w, t, b, fontSize);
-        res += int(std::uint32_t(w));
+        const auto *fd = glyph(ch, fontSize);
+        if (!fd) { continue; }
+        lo.glyphs[i] = fd;
+        int width = monoWidth_ ? std::max(fd->advW, monoWidth_) : fd->advW;
+        if (maxWidth > 0 && w + int(width) > maxWidth && i > start) {
+            lo.lines.push_back({start, i - start, w});
+            lo.width = std::max(lo.width, w);
+            start = i;
+            w = 0;
+        }
+        w += width;
     }
-    return res;
+    if (start < len) {
+        lo.lines.push_back({start, len - start, w});
+        lo.width = std::max(lo.width, w);
+    }
+    return lo;
 }
 
 void TTF::setColor(std::uint8_t r, std::uint8_t g, std::uint8_t b) {
@@ -140,21 +201,40 @@ void TTF::setAltColor(int index, std::uint8_t r, std::uint8_t g, std::uint8_t b)
 
 void TTF::render(std::wstring_view str, int x, int y, bool shadow, int fontSize) {
     if (fontSize < 0) fontSize = fontSize_;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    /* build quads of whole string, grouped by atlas page, and draw each page with one geometry call */
+    auto *batch = static_cast<TextBatch*>(batch_);
+    auto &pages = batch->pages;
+    auto addQuad = [](std::vector<SDL_Vertex> &vertices, const FontData *fd, float l, float t,
+                      float invSize, SDL_Color c) {
+        float r = l + float(fd->w), b = t + float(fd->h);
+        float u0 = float(fd->rpx) * invSize, v0 = float(fd->rpy) * invSize;
+        float u1 = float(fd->rpx + fd->w) * invSize, v1 = float(fd->rpy + fd->h) * invSize;
+        vertices.push_back({{l, t}, c, {u0, v0}});
+        vertices.push_back({{r, t}, c, {u1, v0}});
+        vertices.push_back({{l, b}, c, {u0, v1}});
+        vertices.push_back({{r, b}, c, {u1, v1}});
+    };
+    const float invSize = 1.f / float(RectPackWidthDefault);
+#endif
     int colorIndex = 0;
-    for (auto ch: str) {
+    /* glyphs are resolved once per distinct string, so drawing it again needs no per-char lookups */
+    const auto &lo = layout(str, 0, fontSize);
+    auto len = lo.glyphs.size();
+    for (size_t i = 0; i < len; ++i) {
+        auto ch = lo.str[i];
         if (ch > 0 && ch < 17) { colorIndex = ch - 1; continue; }
-        const FontData *fd;
-        std::uint64_t key = (std::uint64_t(fontSize) << 32) | std::uint64_t(ch);
-        auto ite = fontCache_.find(key);
-        if (ite == fontCache_.end()) {
-            fd = makeCache(ch, fontSize);
-            if (!fd) {
-                continue;
-            }
-        } else {
-            fd = &ite->second;
-            if (fd->advW == 0) continue;
+        const auto *fd = lo.glyphs[i];
+        if (!fd) { continue; }
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        if (fd->rpidx >= pages.size()) { pages.resize(fd->rpidx + 1); }
+        auto &vertices = pages[fd->rpidx];
+        if (shadow) {
+            addQuad(vertices, fd, float(x + fd->ix0 + 2), float(y + fd->iy0 + 2), invSize, SDL_Color {0, 0, 0, 255});
         }
+        addQuad(vertices, fd, float(x + fd->ix0), float(y + fd->iy0), invSize,
+                SDL_Color {altR_[colorIndex], altG_[colorIndex], altB_[colorIndex], 255});
+#else
         if (shadow) {
             auto *tex = textures_[fd->rpidx];
             tex->setBlendColor(0, 0, 0, 255);
@@ -166,13 +246,143 @@ void TTF::render(std::wstring_view str, int x, int y, bool shadow, int fontSize)
             tex->setBlendColor(altR_[colorIndex], altG_[colorIndex], altB_[colorIndex], 255);
             renderer_->renderTexture(tex, x + fd->ix0, y + fd->iy0, fd->rpx, fd->rpy, fd->w, fd->h, true);
         }
+#endif
         x += fd->advW;
     }
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    int pageCount = 0;
+    for (auto &vertices: pages) {
+        if (!vertices.empty()) { ++pageCount; }
+    }
+    if (!pageCount) { return; }
+    auto &indices = batch->indices;
+    /* with shadow, even quads are shadows and odd quads are glyphs */
+    auto addIndices = [&indices](const std::vector<SDL_Vertex> &vertices, int first, int step) {
+        int quads = int(vertices.size()) / 4;
+        for (int q = first; q < quads; q += step) {
+            auto base = q * 4;
+            for (int i: {0, 1, 2, 2, 1, 3}) {
+                indices.push_back(base + i);
+            }
+        }
+    };
+    auto draw = [this, &indices](size_t page, const std::vector<SDL_Vertex> &vertices) {
+        renderer_->renderGeometry(textures_[page], vertices.data(), int(vertices.size()),
+                                  indices.data(), int(indices.size()));
+        indices.clear();
+    };
+    if (!shadow) {
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (pages[i].empty()) { continue; }
+            addIndices(pages[i], 0, 1);
+            draw(i, pages[i]);
+        }
+    } else if (pageCount == 1) {
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (pages[i].empty()) { continue; }
+            addIndices(pages[i], 0, 2);
+            addIndices(pages[i], 1, 2);
+            draw(i, pages[i]);
+        }
+    } else {
+        /* shadows of all pages go under glyphs of all pages */
+        for (int pass = 0; pass < 2; ++pass) {
+            for (size_t i = 0; i < pages.size(); ++i) {
+                if (pages[i].empty()) { continue; }
+                addIndices(pages[i], pass, 2);
+                draw(i, pages[i]);
+            }
+        }
+    }
+    for (auto &vertices: pages) { vertices.clear(); }
+#endif
+}
+
+const TTF::FontData *TTF::glyph(std::uint32_t ch, int fontSize) {
+    std::uint64_t key = (std::uint64_t(fontSize) << 32) | std::uint64_t(ch);
+    auto ite = fontCache_.find(key);
+    const auto *fd = ite == fontCache_.end() ? makeCache(ch, fontSize) : &ite->second;
+    return fd && fd->advW ? fd : nullptr;
 }
 
 const TTF::FontData *TTF::makeCache(std::uint32_t ch, int fontSize) {
+    PROFILE_SCOPE("ttf_cache");
+    if (fontSize < 0) fontSize = fontSize_;
+    std::uint64_t key = (std::uint64_t(fontSize) << 32) | std::uint64_t(ch);
+    GlyphBitmap glyph;
+    if (!rasterizeGlyph(ch, fontSize, glyph)) {
+        memset(&fontCache_[key], 0, sizeof(FontData));
+        return nullptr;
+    }
+    auto *fd = placeGlyph(key, glyph);
+    if (fd) {
+        uploadRect(fd->rpidx, fd->rpx, fd->rpy, int((fd->w + 1u) & ~1u), fd->h);
+    }
+    return fd;
+}
+
+void TTF::rasterize(const std::vector<std::uint32_t> &chars, size_t first, size_t step,
+                    std::vector<GlyphBitmap> &glyphs, int fontSize) const {
     if (fontSize < 0) fontSize = fontSize_;
-    FontInfo *fi = nullptr;
+    for (size_t i = first; i < chars.size(); i += step) {
+        auto &glyph = glyphs.emplace_back();
+        /* missing glyphs are kept with zero advance, so they are cached as missing on upload */
+        rasterizeGlyph(chars[i], fontSize, glyph);
+    }
+}
+
+size_t TTF::upload(std::vector<GlyphBitmap> &glyphs, int fontSize) {
+    if (fontSize < 0) fontSize = fontSize_;
+    struct Dirty {
+        int x0 = RectPackWidthDefault, y0 = RectPackWidthDefault, x1 = 0, y1 = 0;
+    };
+    std::vector<Dirty> dirty;
+    size_t added = 0;
+    for (auto &glyph: glyphs) {
+        std::uint64_t key = (std::uint64_t(fontSize) << 32) | std::uint64_t(glyph.ch);
+        /* may be drawn and cached while being rasterized */
+        if (fontCache_.find(key) != fontCache_.end()) { continue; }
+        if (glyph.fd.advW == 0) {
+            memset(&fontCache_[key], 0, sizeof(FontData));
+            continue;
+        }
+        auto *fd = placeGlyph(key, glyph);
+        if (!fd) { continue; }
+        ++added;
+        if (fd->rpidx >= dirty.size()) { dirty.resize(fd->rpidx + 1); }
+        auto &d = dirty[fd->rpidx];
+        d.x0 = std::min(d.x0, int(fd->rpx));
+        d.y0 = std::min(d.y0, int(fd->rpy));
+        d.x1 = std::max(d.x1, int(fd->rpx) + int((fd->w + 1u) & ~1u));
+        d.y1 = std::max(d.y1, int(fd->rpy) + int(fd->h));
+    }
+    for (size_t i = 0; i < dirty.size(); ++i) {
+        auto &d = dirty[i];
+        if (d.x1 <= d.x0 || d.y1 <= d.y0) { continue; }
+        uploadRect(int(i), d.x0, d.y0, d.x1 - d.x0, d.y1 - d.y0);
+    }
+    glyphs.clear();
+    return added;
+}
+
+size_t TTF::prewarm(const std::vector<std::uint32_t> &chars, int fontSize) {
+    if (fontSize < 0) fontSize = fontSize_;
+    std::vector<std::uint32_t> missing;
+    for (auto ch: chars) {
+        std::uint64_t key = (std::uint64_t(fontSize) << 32) | std::uint64_t(ch);
+        if (fontCache_.find(key) == fontCache_.end()) { missing.push_back(ch); }
+    }
+    std::vector<GlyphBitmap> glyphs;
+    rasterize(missing, 0, 1, glyphs, fontSize);
+    return upload(glyphs, fontSize);
+}
+
+bool TTF::rasterizeGlyph(std::uint32_t ch, int fontSize, GlyphBitmap &glyph) const {
+    glyph.ch = ch;
+#ifdef USE_FREETYPE
+    std::unique_lock lk(ftMutex_);
+#endif
+    const FontInfo *fi = nullptr;
 #ifndef USE_FREETYPE
     stbtt_fontinfo *info;
     std::uint32_t index = 0;
@@ -190,25 +400,17 @@ const TTF::FontData *TTF::makeCache(std::uint32_t ch, int fontSize) {
         if (index != 0) { fi = &f; break; }
 #endif
     }
-    std::uint64_t key = (std::uint64_t(fontSize) << 32) | std::uint64_t(ch);
-    FontData *fd = &fontCache_[key];
-    if (fi == nullptr) {
-        memset(fd, 0, sizeof(FontData));
-        return nullptr;
-    }
+    if (fi == nullptr) { return false; }
 
+    auto *fd = &glyph.fd;
 #ifdef USE_FREETYPE
-    unsigned char *srcPtr;
-    int bitmapPitch;
-    if (FT_Render_Glyph(fi->face->glyph, FT_RENDER_MODE_NORMAL)) return nullptr;
+    if (FT_Render_Glyph(fi->face->glyph, FT_RENDER_MODE_NORMAL)) return false;
     FT_GlyphSlot slot = fi->face->glyph;
     fd->ix0 = slot->bitmap_left;
     fd->iy0 = fontSize * 7 / 8 - slot->bitmap_top;
     fd->w = slot->bitmap.width;
     fd->h = slot->bitmap.rows;
     fd->advW = slot->advance.x >> 6;
-    srcPtr = slot->bitmap.buffer;
-    bitmapPitch = slot->bitmap.pitch;
 #else
     /* Read font data to cache */
     int advW, leftB;
@@ -217,62 +419,79 @@ const TTF::FontData *TTF::makeCache(std::uint32_t ch, int fontSize) {
     int ascent, descent;
     stbtt_GetFontVMetrics(info, &ascent, &descent, nullptr);
     fd->advW = std::uint8_t(std::lround(fontScale * float(advW)));
-    int w, h, x, y;
-    stbtt_GetGlyphBitmap(info, fontScale, fontScale, index, &w, &h, &x, &y);
-    fd->ix0 = x;
-    fd->iy0 = int(float(ascent + descent) * fontScale) + y;
-    fd->w = w;
-    fd->h = h;
+    int x0, y0, x1, y1;
+    stbtt_GetGlyphBitmapBox(info, index, fontScale, fontScale, &x0, &y0, &x1, &y1);
+    fd->ix0 = x0;
+    fd->iy0 = int(float(ascent + descent) * fontScale) + y0;
+    fd->w = x1 - x0;
+    fd->h = y1 - y0;
 #endif
 
     int dstPitch = int((fd->w + 1u) & ~1u);
-    /* Get last rect pack bitmap */
-    auto rpidx = rectpacker_->pack(dstPitch, fd->h, fd->rpx, fd->rpy);
-    if (rpidx < 0) {
-        memset(fd, 0, sizeof(FontData));
-        return nullptr;
-    }
-    // stbrp_rect rc = {0, std::uint16_t((fd->w + 3u) & ~3u), fd->h};
-    fd->rpidx = rpidx;
-
-    std::uint8_t dst[64 * 64];
-
+    glyph.alpha.assign(size_t(dstPitch) * fd->h, 0);
 #ifdef USE_FREETYPE
-    auto *dstPtr = dst;
+    const unsigned char *srcPtr = slot->bitmap.buffer;
+    auto *dstPtr = glyph.alpha.data();
     for (int k = 0; k < fd->h; ++k) {
         memcpy(dstPtr, srcPtr, fd->w);
-        srcPtr += bitmapPitch;
+        srcPtr += slot->bitmap.pitch;
         dstPtr += dstPitch;
     }
 #else
-    stbtt_MakeGlyphBitmapSubpixel(info, dst, fd->w, fd->h, dstPitch, fontScale, fontScale, 0, 0, index);
+    if (!glyph.alpha.empty()) {
+        stbtt_MakeGlyphBitmapSubpixel(info, glyph.alpha.data(), fd->w, fd->h, dstPitch, fontScale, fontScale, 0, 0, index);
+    }
 #endif
+    return true;
+}
+
+TTF::FontData *TTF::placeGlyph(std::uint64_t key, const GlyphBitmap &glyph) {
+    FontData *fd = &fontCache_[key];
+    *fd = glyph.fd;
+    int dstPitch = int((fd->w + 1u) & ~1u);
+    /* Get last rect pack bitmap */
+    auto rpidx = rectpacker_->pack(dstPitch, fd->h, fd->rpx, fd->rpy);
+    if (rpidx < 0) {
+        memset(fd, 0, sizeof(FontData));
+        return nullptr;
+    }
+    fd->rpidx = rpidx;
 
     if (rpidx >= textures_.size()) {
         textures_.resize(rpidx + 1, nullptr);
+        pageAlpha_.resize(rpidx + 1);
     }
     auto *tex = textures_[rpidx];
     if (tex == nullptr) {
         tex = Texture::create(renderer_, RectPackWidthDefault, RectPackWidthDefault);
         tex->enableBlendMode(true);
         textures_[rpidx] = tex;
+        pageAlpha_[rpidx].assign(RectPackWidthDefault * RectPackWidthDefault, 0);
+    }
+    const auto *src = glyph.alpha.data();
+    auto *dst = pageAlpha_[rpidx].data() + fd->rpy * RectPackWidthDefault + fd->rpx;
+    for (int k = 0; k < fd->h; ++k) {
+        memcpy(dst, src, dstPitch);
+        src += dstPitch;
+        dst += RectPackWidthDefault;
     }
+    return fd;
+}
+
+void TTF::uploadRect(int page, int x, int y, int w, int h) {
     int pitch;
-    uint32_t *pixels = tex->lock(pitch, fd->rpx, fd->rpy, dstPitch, fd->h);
-    if (pixels) {
-        auto *pdst = dst;
-        int offset = pitch - dstPitch;
-        int h = fd->h;
-        while (h--) {
-            int w = dstPitch;
-            while (w--) {
-                *pixels++ = 0xFFFFFFu | (std::uint32_t(*pdst++) << 24);
-            }
-            pixels += offset;
+    uint32_t *pixels = textures_[page]->lock(pitch, x, y, w, h);
+    if (!pixels) { return; }
+    const auto *src = pageAlpha_[page].data() + y * RectPackWidthDefault + x;
+    int offset = pitch - w;
+    while (h--) {
+        for (int i = 0; i < w; ++i) {
+            *pixels++ = 0xFFFFFFu | (std::uint32_t(src[i]) << 24);
         }
-        tex->unlock();
+        pixels += offset;
+        src += RectPackWidthDefault;
     }
-    return fd;
+    textures_[page]->unlock();
 }
 
 }
@@ -22,11 +22,13 @@
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <list>
 #include <vector>
 #include <memory>
 #include <cstdint>
 
 #ifdef USE_FREETYPE
+#include <mutex>
 extern "C" {
 typedef struct FT_LibraryRec_ *FT_Library;
 typedef struct FT_FaceRec_    *FT_Face;
@@ -61,6 +63,29 @@ protected:
         std::vector<std::uint8_t> ttf_buffer;
 #endif
     };
+public:
+    /* glyph rendered to 8-bit alpha, rows are padded to even width */
+    struct GlyphBitmap {
+        std::uint32_t ch = 0;
+        FontData fd = {};
+        std::vector<std::uint8_t> alpha;
+    };
+    /* chars [start, start + length) of the string make a line */
+    struct TextLine {
+        std::uint32_t start, length;
+        int width;
+    };
+    struct TextLayout {
+        std::uint64_t key = 0;
+        std::wstring str;
+        int fontSize, maxWidth;
+        /* width of the widest line */
+        int width = 0;
+        std::vector<TextLine> lines;
+        /* glyph run: cached glyph of each char, nullptr for control chars and chars not in fonts */
+        std::vector<const FontData*> glyphs;
+    };
+
 public:
     explicit TTF(Renderer *renderer);
     ~TTF();
@@ -70,6 +95,11 @@ public:
     bool add(const std::string& filename, int index = 0);
     void charDimension(std::uint32_t ch, std::uint8_t &width, std::int8_t &t, std::int8_t &b, int fontSize = -1);
     int stringWidth(const std::wstring &str, int fontSize = -1);
+    /* measure str and break it into lines not wider than maxWidth(0 for no break), cached by content, font size and
+     * max width, the result is valid until next call, render() draws from it as well */
+    const TextLayout &layout(std::wstring_view str, int maxWidth = 0, int fontSize = -1);
+    [[nodiscard]] inline std::uint64_t layoutHits() const { return layoutHits_; }
+    [[nodiscard]] inline std::uint64_t layoutMisses() const { return layoutMisses_; }
 
     inline int fontSize() const { return fontSize_; }
     void setColor(std::uint8_t r, std::uint8_t g, std::uint8_t b);
@@ -77,13 +107,30 @@ public:
 
     void render(std::wstring_view str, int x, int y, bool shadow, int fontSize = -1);
 
+    /* render chars[first], chars[first + step], ... to bitmaps, can be called from worker threads */
+    void rasterize(const std::vector<std::uint32_t> &chars, size_t first, size_t step,
+                   std::vector<GlyphBitmap> &glyphs, int fontSize = -1) const;
+    /* pack glyphs not cached yet and upload them with one texture lock per atlas page, returns count of added glyphs */
+    size_t upload(std::vector<GlyphBitmap> &glyphs, int fontSize = -1);
+    /* rasterize and upload chars not cached yet on calling thread */
+    size_t prewarm(const std::vector<std::uint32_t> &chars, int fontSize = -1);
+
 private:
     const FontData *makeCache(std::uint32_t ch, int fontSize = - 1);
+    /* cached glyph of the char, nullptr if it is not in fonts */
+    const FontData *glyph(std::uint32_t ch, int fontSize);
+    bool rasterizeGlyph(std::uint32_t ch, int fontSize, GlyphBitmap &glyph) const;
+    FontData *placeGlyph(std::uint64_t key, const GlyphBitmap &glyph);
+    void uploadRect(int page, int x, int y, int w, int h);
 
 protected:
     int fontSize_ = 16;
     std::vector<FontInfo> fonts_;
     std::unordered_map<std::uint64_t, FontData> fontCache_;
+    /* layouts ordered by last use, most recent first, the least recent one is reused when the cache is full */
+    std::list<TextLayout> layouts_;
+    std::unordered_map<std::uint64_t, std::list<TextLayout>::iterator> layoutCache_;
+    std::uint64_t layoutHits_ = 0, layoutMisses_ = 0;
     std::uint8_t monoWidth_ = 0;
 
 private:
@@ -91,10 +138,16 @@ private:
 
     std::uint8_t altR_[16] = {}, altG_[16] = {}, altB_[16] = {};
     std::vector<Texture*> textures_;
+    /* alpha copy of each atlas page, texture locks are write-only so batched uploads redraw rects from it */
+    std::vector<std::vector<std::uint8_t>> pageAlpha_;
+    /* vertex buffers of render(), see TextBatch in ttf.cc */
+    void *batch_ = nullptr;
 
     std::unique_ptr<RectPacker> rectpacker_;
 #ifdef USE_FREETYPE
     FT_Library ftLib_ = nullptr;
+    /* faces keep glyph slots, so rendering is serialized */
+    mutable std::mutex ftMutex_;
 #endif
 };
 
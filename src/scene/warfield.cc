@@ -31,7 +31,9 @@
 #include "mem/savedata.hh"
 #include "mem/strings.hh"
 #include "core/config.hh"
+#include "core/profiler.hh"
 #include "util/random.hh"
+#include "util/bytes.hh"
 #include <fmt/format.h>
 #include <map>
 
@@ -39,12 +41,9 @@ namespace hojy::scene {
 
 Warfield::Warfield(Renderer *renderer, int x, int y, int width, int height, std::pair<int, int> scale):
     Map(renderer, x, y, width, height, scale),
-    drawingTerrainTex2_(Texture::create(renderer, auxWidth_, auxHeight_)) {
+    drawingTerrainTex2_(Texture::create(renderer, auxWidth_, auxHeight_)),
+    fightTexCache_("FIGHT", FightTextureListCount, size_t(std::max(core::config.fightCacheSize(), 1)) << 20U) {
     drawingTerrainTex2_->enableBlendMode(true);
-    fightTexData_.resize(FightTextureListCount);
-    for (size_t i = 0; i < FightTextureListCount; ++i) {
-        data::GrpData::loadData(fmt::format("FIGHT{:03}.IDX", i), fmt::format("FIGHT{:03}.GRP", i), fightTexData_[i]);
-    }
 }
 
 Warfield::~Warfield() {
@@ -86,23 +85,25 @@ bool Warfield::load(std::int16_t warId) {
     if (warMapLoaded_.find(warMapId) == warMapLoaded_.end()) {
         mapWidth_ = data::WarFieldWidth;
         mapHeight_ = data::WarFieldHeight;
-        if (data::GrpData::loadData("WDX", "WMP", texData_)) {
+        if (texData_.load("WDX", "WMP")) {
             for (std::int16_t i = 0; i < 1000; ++i) {
                 warMapLoaded_.insert(i);
             }
+            spriteCache_.load("WMP", texData_.entries());
         } else {
-            if (!data::GrpData::loadData(fmt::format("WDX{:03}", warMapId), fmt::format("WMP{:03}", warMapId), texData_)) {
+            if (!texData_.load(fmt::format("WDX{:03}", warMapId), fmt::format("WMP{:03}", warMapId))) {
                 return false;
             }
             warMapLoaded_.insert(warMapId);
+            spriteCache_.load(fmt::format("WMP{:03}", warMapId), texData_.entries());
         }
     }
     {
-        const auto *arr = reinterpret_cast<const uint16_t*>(texData_[0].data());
-        cellWidth_ = arr[0];
-        cellHeight_ = arr[1];
-        offsetX_ = arr[2];
-        offsetY_ = arr[3];
+        const auto *arr = texData_[0].data();
+        cellWidth_ = util::readLE16(arr);
+        cellHeight_ = util::readLE16(arr + 2);
+        offsetX_ = util::readLE16(arr + 4);
+        offsetY_ = util::readLE16(arr + 6);
     }
     int cellDiffX = cellWidth_ / 2;
     int cellDiffY = cellHeight_ / 2;
@@ -120,7 +121,7 @@ bool Warfield::load(std::int16_t warId) {
             auto texId = layers[0][pos] >> 1;
             ci.earthId = texId;
             ci.buildingId = layers[1][pos] >> 1;
-            ci.blocked = ci.buildingId > 0 || texId >= 179 && texId <= 181 || texId == 261 || texId == 511 || texId >= 662 && texId <= 665 || texId == 674;
+            ci.blocked = data::isWarfieldCellBlocked(ci.earthId, ci.buildingId);
         }
         x -= cellDiffX; y += cellDiffY;
     }
@@ -130,6 +131,7 @@ bool Warfield::load(std::int16_t warId) {
     if (!statusPanel_) {
         statusPanel_ = new StatusView(renderer_, x_, y_, width_, height_);
     }
+    prefetchFightTextures();
     return true;
 }
 
@@ -202,6 +204,12 @@ void Warfield::putChars(const std::vector<std::int16_t> &chars) {
         cell.charInfo = &ci;
         ++ite;
     }
+    {
+        /* chars selected by player may be not covered by prefetchFightTextures() */
+        std::vector<std::int16_t> heads;
+        for (auto &ci: chars_) { heads.emplace_back(ci.info.headId); }
+        fightTexCache_.prefetch(heads);
+    }
     recalcKnowledge();
     frameUpdate();
     if (info->music >= 0) {
@@ -210,10 +218,14 @@ void Warfield::putChars(const std::vector<std::int16_t> &chars) {
 }
 
 void Warfield::render() {
+    if (stage_ == Thinking) {
+        continueThinking();
+    }
     Map::render();
 
     bool acting = stage_ == Acting;
     if (drawDirty_) {
+        PROFILE_SCOPE("map_composite");
         drawDirty_ = false;
         int cellDiffX = cellWidth_ / 2;
         int cellDiffY = cellHeight_ / 2;
@@ -337,29 +349,29 @@ void Warfield::render() {
                     continue;
                 }
                 auto &ci = cellInfo_[offset];
-                Texture::renderRLE(texData_[ci.earthId], colors, pixels, pitch, aheight, dx, ty);
+                spriteCache_.render(ci.earthId, colors, pixels, pitch, aheight, dx, ty);
                 if (!movingOrActing) {
                     static std::uint32_t maskColors[256] = {0};
                     if (ci.insideMovingArea == 2) {
                         maskColors[254] = 0xA0A0A0A0u;
-                        Texture::renderRLEBlending(texData_[0], maskColors, pixels, pitch, aheight, dx, ty);
+                        spriteCache_.renderBlending(0, maskColors, pixels, pitch, aheight, dx, ty);
                     } else if (ci.charInfo) {
                         maskColors[254] = 0x80A0A0A0u;
-                        Texture::renderRLEBlending(texData_[0], maskColors, pixels, pitch, aheight, dx, ty);
+                        spriteCache_.renderBlending(0, maskColors, pixels, pitch, aheight, dx, ty);
                     } else if (selecting && !ci.insideMovingArea) {
                         maskColors[254] = 0xD0A0A0A0u;
-                        Texture::renderRLEBlending(texData_[0], maskColors, pixels, pitch, aheight, dx, ty);
+                        spriteCache_.renderBlending(0, maskColors, pixels, pitch, aheight, dx, ty);
                     }
                 }
                 if (ci.buildingId > 0) {
-                    Texture::renderRLE(texData_[ci.buildingId], colors, pixels2, pitch2, aheight, dx, ty);
+                    spriteCache_.render(ci.buildingId, colors, pixels2, pitch2, aheight, dx, ty);
                 } else {
                     if (ci.charInfo) {
                         if (acting && ci.charInfo == ch && fightTex_ && fightTexIdx_ >= 0 && fightTexIdx_ < fightTex_->size()) {
                             Texture::renderRLE((*fightTex_)[fightTexIdx_], colors, pixels2, pitch2, aheight, dx, ty);
                         } else {
-                            Texture::renderRLE(texData_[2553 + 4 * ci.charInfo->texId
-                                + int(ci.charInfo->direction)], colors, pixels2, pitch2, aheight, dx, ty);
+                            spriteCache_.render(2553 + 4 * ci.charInfo->texId
+                                + int(ci.charInfo->direction), colors, pixels2, pitch2, aheight, dx, ty);
                         }
                     }
                     if (ci.effectData) {
@@ -401,7 +413,7 @@ void Warfield::render() {
             ttf->render(n.str, texX, texY, false, fsize);
         }
     }
-    if (stage_ == Idle || stage_ == PlayerMenu || stage_ == Moving) {
+    if (stage_ == Idle || stage_ == PlayerMenu || stage_ == Moving || stage_ == Thinking) {
         statusPanel_->render();
     }
 }
@@ -455,10 +467,9 @@ void Warfield::handleKeyInput(Node::Key key) {
                 stage_ = Idle;
                 break;
             }
-            auto ite = selCells_.find(std::make_pair(x, y));
-            if (ite != selCells_.end()) {
+            auto *sc = selCells_.find(x, y);
+            if (sc) {
                 stage_ = Moving;
-                auto *sc = &ite->second;
                 while (sc) {
                     movingPath_.emplace_back(std::make_pair(sc->x, sc->y));
                     sc = sc->moveParent;
@@ -492,6 +503,19 @@ void Warfield::handleKeyInput(Node::Key key) {
     }
 }
 
+std::uint64_t Warfield::nextWakeTime() const {
+    switch (stage_) {
+    case Thinking:
+        return 0;
+    case Idle:
+    case Moving:
+    case Acting:
+        return std::min(Map::nextWakeTime(), nextFrameTime_);
+    default:
+        return Map::nextWakeTime();
+    }
+}
+
 void Warfield::frameUpdate() {
     switch (stage_) {
     case Idle:
@@ -633,6 +657,15 @@ void Warfield::nextAction() {
     }
 }
 
+inline std::uint8_t Warfield::cellFlags(int index, int myside) const {
+    const auto &ci = cellInfo_[index];
+    std::uint8_t flags = ci.blocked ? SelectableArea::CellBlocked : 0;
+    if (ci.charInfo) {
+        flags |= ci.charInfo->side == myside ? SelectableArea::CellOccupied | SelectableArea::CellAlly : SelectableArea::CellOccupied;
+    }
+    return flags;
+}
+
 void Warfield::autoAction() {
     if (pendingAutoAction_) {
         pendingAutoAction_();
@@ -640,19 +673,40 @@ void Warfield::autoAction() {
         return;
     }
     auto *ch = charQueue_.back();
-    if (ch->info.stamina < 10) {
-        pendingAutoAction_ = [this, ch]() {
+    auto enemySide = ch->side ^ 1;
+    BattleAI::Unit enemies[TargetScorer::MaxEnemies];
+    int enemyCount = 0;
+    for (auto &ci: chars_) {
+        if (ci.side != enemySide || ci.info.hp <= 0) { continue; }
+        enemies[enemyCount++] = BattleAI::Unit {ci.side, ci.x, ci.y, &ci.info};
+    }
+    ai_.begin(BattleAI::Unit {ch->side, ch->x, ch->y, &ch->info}, knowledge_[ch->side], ch->steps,
+              enemies, enemyCount, mapWidth_, mapHeight_, [this, myside = ch->side](int index) {
+        return cellFlags(index, myside);
+    });
+    stage_ = Thinking;
+    continueThinking();
+}
+
+void Warfield::continueThinking() {
+    PROFILE_SCOPE("ai_scoring");
+    if (!ai_.resume(core::config.aiWorkPerFrame())) { return; }
+    stage_ = Idle;
+    auto *ch = charQueue_.back();
+    const auto &plan = ai_.plan();
+    switch (plan.action) {
+    case BattleAI::Plan::UseItem:
+        pendingAutoAction_ = [this, ch, itemId = plan.itemId]() {
             std::map<mem::PropType, std::int16_t> changes;
-            auto delta = data::StaminaMax - ch->info.stamina;
-            std::int16_t itemId;
-            if (ch->side == 1) {
-                itemId = mem::tryUseNpcItem(&ch->info, mem::PropType::Stamina, delta);
-                if (!mem::useNpcItem(&ch->info, itemId, changes)) { itemId = -1; }
-            } else {
-                itemId = mem::tryUseBagItem(&ch->info, mem::PropType::Stamina, delta);
-                if (!mem::useItem(&ch->info, itemId, changes)) { itemId = -1; }
+            bool usedItem = false;
+            if (itemId >= 0) {
+                if (ch->side == 1) {
+                    usedItem = mem::useNpcItem(&ch->info, itemId, changes);
+                } else {
+                    usedItem = mem::useItem(&ch->info, itemId, changes);
+                }
             }
-            if (itemId < 0) {
+            if (!usedItem) {
                 doRest();
             } else {
                 stage_ = PoppingUp;
@@ -663,352 +717,13 @@ void Warfield::autoAction() {
                 });
             }
         };
-    } else if (ch->info.hp < 20 || ch->info.hp <= ch->info.maxHp / 5) {
-        auto delta = ch->info.maxHp - ch->info.hp;
-        std::int16_t itemId;
-        if (ch->side == 1) {
-            itemId = mem::tryUseNpcItem(&ch->info, mem::PropType::Hp, delta);
-        } else {
-            itemId = mem::tryUseBagItem(&ch->info, mem::PropType::Hp, delta);
-        }
-        if (itemId >= 0 || ch->info.hp <= 20) {
-            pendingAutoAction_ = [this, ch, itemId]() {
-                std::map<mem::PropType, std::int16_t> changes;
-                bool usedItem = false;
-                if (itemId >= 0) {
-                    if (ch->side == 1) {
-                        usedItem = mem::useNpcItem(&ch->info, itemId, changes);
-                    } else {
-                        usedItem = mem::useItem(&ch->info, itemId, changes);
-                    }
-                }
-                if (!usedItem) {
-                    doRest();
-                } else {
-                    stage_ = PoppingUp;
-                    auto *msgBox = ItemView::popupUseResult(this, itemId, changes);
-                    msgBox->setCloseHandler([this] {
-                        charQueue_.pop_back();
-                        stage_ = Idle;
-                    });
-                }
-            };
-        }
-    } else if (ch->info.poisoned > 33 && ch->side == 1) {
-        auto delta = ch->info.poisoned;
-        std::int16_t itemId;
-        if (ch->side == 1) {
-            itemId = mem::tryUseNpcItem(&ch->info, mem::PropType::Poisoned, delta);
-        } else {
-            itemId = mem::tryUseBagItem(&ch->info, mem::PropType::Poisoned, delta);
-        }
-        if (itemId >= 0) {
-            pendingAutoAction_ = [this, ch, itemId]() {
-                std::map<mem::PropType, std::int16_t> changes;
-                bool usedItem = false;
-                if (itemId >= 0) {
-                    if (ch->side == 1) {
-                        usedItem = mem::useNpcItem(&ch->info, itemId, changes);
-                    } else {
-                        usedItem = mem::useItem(&ch->info, itemId, changes);
-                    }
-                }
-                if (!usedItem) {
-                    doRest();
-                } else {
-                    stage_ = PoppingUp;
-                    auto *msgBox = ItemView::popupUseResult(this, itemId, changes);
-                    msgBox->setCloseHandler([this] {
-                        charQueue_.pop_back();
-                        stage_ = Idle;
-                    });
-                }
-            };
-        }
-    }
-    struct SkillPredict {
-        const mem::SkillData *skill;
-        std::int16_t index;
-        std::int16_t level;
-        std::int16_t atk;
-        std::int16_t rangeType;
-        std::int16_t skillRange, area;
-    };
-    SkillPredict skills[data::LearnSkillCount];
-    int skillCount = 0, maxRange = 0;
-    if (!pendingAutoAction_) {
-        for (int i = 0; i < data::LearnSkillCount; ++i) {
-            if (ch->info.skillId[i] <= 0) { continue; }
-            const auto *skill = mem::gSaveData.skillInfo[ch->info.skillId[i]];
-            if (!skill || skill->damageType > 0) { continue; }
-            std::int16_t level = mem::calcRealSkillLevel(skill->reqMp,
-                                                         std::clamp<std::int16_t>(ch->info.skillLevel[i] / 100, 0, 9),
-                                                         ch->info.mp);
-            if (level < 0) { continue; }
-            std::int16_t atk = mem::calcRealAttack(&ch->info, knowledge_[ch->side], skill, level);
-            std::int16_t type = skill->attackAreaType, range = skill->selRange[level], area = skill->area[level];
-            skills[skillCount++] = SkillPredict{skill, std::int16_t(i), level, atk, type, range, area};
-            if (type == 0 || type == 3) {
-                maxRange = std::max<int>(maxRange, range);
-            }
-        }
-        if (!skillCount) {
-            pendingAutoAction_ = [this, ch]() {
-                std::map<mem::PropType, std::int16_t> changes;
-                auto delta = ch->info.maxMp - ch->info.mp;
-                std::int16_t itemId;
-                if (ch->side == 1) {
-                    itemId = mem::tryUseNpcItem(&ch->info, mem::PropType::Mp, delta);
-                    if (!mem::useNpcItem(&ch->info, itemId, changes)) { itemId = -1; }
-                } else {
-                    itemId = mem::tryUseBagItem(&ch->info, mem::PropType::Mp, delta);
-                    if (!mem::useItem(&ch->info, itemId, changes)) { itemId = -1; }
-                }
-                if (itemId < 0) {
-                    doRest();
-                } else {
-                    stage_ = PoppingUp;
-                    auto *msgBox = ItemView::popupUseResult(this, itemId, changes);
-                    msgBox->setCloseHandler([this] {
-                        charQueue_.pop_back();
-                        stage_ = Idle;
-                    });
-                }
-            };
-        }
-    }
-    CharInfo *enemies[std::max(data::WarFieldEnemyCount, data::TeamMemberCount)];
-    int enemyCount = 0;
-    auto enemySide = ch->side ^ 1;
-    for (auto &ci: chars_) {
-        if (ci.side != enemySide || ci.info.hp <= 0) { continue; }
-        enemies[enemyCount++] = &ci;
-    }
-    if (pendingAutoAction_) {
-        std::map<std::pair<int, int>, SelectableCell> selCells;
-        getSelectableArea(ch, selCells, ch->steps, 0);
-        int distance = 0;
-        int mx = -1, my = -1;
-        for (auto &c: selCells) {
-            if (c.second.moves < 0) { continue; }
-            std::int16_t x, y;
-            std::tie(x, y) = c.first;
-            for (int i = 0; i < enemyCount; ++i) {
-                auto *enemy = enemies[i];
-                int dist = std::abs(enemy->x - x) + std::abs(enemy->y - y);
-                if (dist > distance) {
-                    distance = dist;
-                    mx = x; my = y;
-                }
-            }
-        }
-        if (mx != ch->x || my != ch->y) {
-            stage_ = Moving;
-            movingPath_.clear();
-            auto sc = &selCells[std::make_pair(mx, my)];
-            while (sc) {
-                movingPath_.emplace_back(std::make_pair(sc->x, sc->y));
-                sc = sc->moveParent;
-            }
-        } else {
-            pendingAutoAction_();
-            pendingAutoAction_ = nullptr;
-        }
-        return;
-    }
-    std::map<std::pair<int, int>, SelectableCell> selCells;
-    int steps = ch->steps;
-    getSelectableArea(ch, selCells, steps, maxRange);
-    struct PredictScore {
-        int score;
-        std::int16_t fx, fy, tx, ty;
-        int skillIndex;
-    };
-    std::vector<PredictScore> scores;
-    scores.reserve(selCells.size());
-    for (int j = 0; j < skillCount; ++j) {
-        auto rt = skills[j].rangeType;
-        for (auto &c: selCells) {
-            std::int16_t x, y;
-            std::tie(x, y) = c.first;
-            switch (rt) {
-            case 1: {
-                if (c.second.moves < 0) { continue; }
-                int totalDmg[4] = {0, 0, 0, 0};
-                for (int i = 0; i < enemyCount; ++i) {
-                    auto *enemy = enemies[i];
-                    std::int16_t ex = enemy->x, ey = enemy->y;
-                    auto r = skills[j].skillRange;
-                    int distance;
-                    if ((ex == x && (distance = std::abs(ey - y)) <= r)
-                        || (ey == y && (distance = std::abs(ex - x)) <= r)) {
-                        int dmg = mem::calcPredictDamage(skills[j].atk, enemy->info.defence,
-                                                         ch->info.stamina, enemy->info.hurt,
-                                                         distance);
-                        if (dmg >= enemy->info.hp) { dmg = std::max<int>(dmg * 3 / 2, enemy->info.maxHp); }
-                        if (ey < y)
-                            totalDmg[0] += dmg;
-                        else if (ex > x)
-                            totalDmg[1] += dmg;
-                        else if (ex < x)
-                            totalDmg[2] += dmg;
-                        else
-                            totalDmg[3] += dmg;
-                    }
-                }
-                for (std::int16_t i = 0; i < 4; ++i) {
-                    if (totalDmg[i] > 0) {
-                        scores.emplace_back(PredictScore{totalDmg[i], x, y, i, -1, skills[j].index});
-                    }
-                }
-                break;
-            }
-            case 2: {
-                if (c.second.moves < 0) { continue; }
-                int totalDmg = 0;
-                auto r = skills[j].skillRange;
-                for (int i = 0; i < enemyCount; ++i) {
-                    auto *enemy = enemies[i];
-                    std::int16_t ex = enemy->x, ey = enemy->y;
-                    int distance;
-                    if ((ex == x && (distance = std::abs(ey - y)) <= r)
-                        || (ey == y && (distance = std::abs(ex - x)) <= r)) {
-                        int dmg = mem::calcPredictDamage(skills[j].atk, enemy->info.defence,
-                                                         ch->info.stamina, enemy->info.hurt,
-                                                         distance);
-                        if (dmg >= enemy->info.hp) { dmg = std::max<int>(dmg * 3 / 2, enemy->info.maxHp); }
-                        totalDmg += dmg;
-                    }
-                }
-                if (totalDmg > 0) {
-                    scores.emplace_back(PredictScore{totalDmg, x, y, x, y, skills[j].index});
-                }
-                break;
-            }
-            case 3: {
-                if (c.second.ranges > skills[j].skillRange) { continue; }
-                int totalDmg = 0;
-                auto r = skills[j].area;
-                auto *n = &c.second;
-                if (n->moves > 0) {
-                    n = n->moveParent;
-                } else {
-                    while (n->moves < 0) {
-                        n = n->rangeParent;
-                    }
-                }
-                std::int16_t mx = n->x, my = n->y;
-                for (int i = 0; i < enemyCount; ++i) {
-                    auto *enemy = enemies[i];
-                    std::int16_t ex = enemy->x, ey = enemy->y;
-                    if (std::abs(ex - x) > r || std::abs(ey - y) > r) { continue; }
-                    int distance = std::abs(x - mx) + std::abs(y - my)
-                                 + std::abs(x - ex) + std::abs(y - ey);
-                    int dmg = mem::calcPredictDamage(skills[j].atk, enemy->info.defence,
-                                                     ch->info.stamina, enemy->info.hurt,
-                                                     distance);
-                    if (dmg >= enemy->info.hp) { dmg = std::max<int>(dmg * 3 / 2, enemy->info.maxHp); }
-                    totalDmg += dmg;
-                }
-                if (totalDmg > 0) {
-                    scores.emplace_back(PredictScore{totalDmg, mx, my, x, y, skills[j].index});
-                }
-                break;
-            }
-            default: {
-                if (c.second.ranges > skills[j].skillRange) { continue; }
-                auto *enemy = cellInfo_[y * mapWidth_ + x].charInfo;
-                if (!enemy || enemy->side != enemySide) { continue; }
-                auto *n = &c.second;
-                if (n->moves > 0) {
-                    n = n->moveParent;
-                } else {
-                    while (n->moves < 0) {
-                        n = n->rangeParent;
-                    }
-                }
-                std::int16_t mx = n->x, my = n->y;
-                int distance = std::abs(mx - x) + std::abs(my - y);
-                int dmg = mem::calcPredictDamage(skills[j].atk, enemy->info.defence,
-                                                 ch->info.stamina, enemy->info.hurt,
-                                                 distance);
-                if (dmg >= enemy->info.hp) { dmg = dmg * 3 / 2; }
-                scores.emplace_back(PredictScore{dmg, mx, my, x, y, skills[j].index});
-                break;
-            }
-            }
-        }
-    }
-    if (scores.empty()) {
-        int distance = 255;
-        int mx = -1, my = -1;
-        for (auto &c: selCells) {
-            if (c.second.moves < 0) { continue; }
-            std::int16_t x, y;
-            std::tie(x, y) = c.first;
-            for (int i = 0; i < enemyCount; ++i) {
-                auto *enemy = enemies[i];
-                int dist = std::abs(enemy->x - x) + std::abs(enemy->y - y);
-                if (dist < distance) {
-                    distance = dist;
-                    mx = x; my = y;
-                }
-            }
-        }
-#ifndef NDEBUG
-        fmt::print(stdout, "({},{})->({},{})\n", ch->x, ch->y, mx, my);
-        fflush(stdout);
-#endif
-        pendingAutoAction_ = [this]() {
-            doRest();
-        };
-        if (mx != ch->x || my != ch->y) {
-            stage_ = Moving;
-            movingPath_.clear();
-            auto sc = &selCells[std::make_pair(mx, my)];
-            while (sc) {
-                movingPath_.emplace_back(std::make_pair(sc->x, sc->y));
-                sc = sc->moveParent;
-            }
-        } else {
-            pendingAutoAction_();
-            pendingAutoAction_ = nullptr;
-        }
-    } else {
-        std::sort(scores.begin(), scores.end(), [](const PredictScore &v0, const PredictScore &v1) {
-            return v0.score > v1.score;
-        });
-        int ratio[3], ratioTotal = 0;
-        int counter = 0;
-        for (auto &s: scores) {
-#ifndef NDEBUG
-            fmt::print(stdout, "({},{})->({},{}): {}={}\n", s.fx, s.fy, s.tx, s.ty, s.skillIndex, s.score);
-            fflush(stdout);
-#endif
-            ratio[counter] = s.score;
-            ratioTotal += s.score;
-            if (++counter == 3) {
-                break;
-            }
-        }
-        int randNum = util::gRandom(ratioTotal);
-        int sel;
-        if (counter > 1) {
-            for (sel = 0; sel < 2; ++sel) {
-                if (randNum < ratio[sel]) {
-                    break;
-                }
-                randNum -= ratio[sel];
-            }
-        } else {
-            sel = 0;
-        }
-        auto &s = scores[sel];
-        pendingAutoAction_ = [this, ch, s]() {
-            actIndex_ = s.skillIndex;
-            actId_ = ch->info.skillId[s.skillIndex];
+        break;
+    case BattleAI::Plan::Skill:
+        pendingAutoAction_ = [this, ch, plan]() {
+            actIndex_ = plan.skillIndex;
+            actId_ = ch->info.skillId[plan.skillIndex];
             attackTimesLeft_ = ch->info.doubleAttack ? 2 : 1;
-            actLevel_ = std::clamp<std::int16_t>(ch->info.skillLevel[s.skillIndex] / 100, 0, 9);
+            actLevel_ = std::clamp<std::int16_t>(ch->info.skillLevel[plan.skillIndex] / 100, 0, 9);
             const auto *skill = mem::gSaveData.skillInfo[actId_];
             if (!skill || (actLevel_ = mem::calcRealSkillLevel(skill->reqMp, actLevel_, ch->info.mp)) < 0) {
                 /* impossible to run these codes if no logic bug */
@@ -1016,26 +731,28 @@ void Warfield::autoAction() {
                 stage_ = Idle;
                 return;
             }
-            if (s.ty < 0) {
-                ch->direction = Map::Direction(s.tx);
-                cursorX_ = s.fx; cursorY_ = s.fy;
+            if (plan.targetY < 0) {
+                ch->direction = Map::Direction(plan.targetX);
+                cursorX_ = plan.moveX; cursorY_ = plan.moveY;
             } else {
-                cursorX_ = s.tx; cursorY_ = s.ty;
+                cursorX_ = plan.targetX; cursorY_ = plan.targetY;
             }
             startActAction();
         };
-        if (s.fx != ch->x || s.fy != ch->y) {
-            stage_ = Moving;
-            movingPath_.clear();
-            auto sc = &selCells[std::make_pair(s.fx, s.fy)];
-            while (sc) {
-                movingPath_.emplace_back(std::make_pair(sc->x, sc->y));
-                sc = sc->moveParent;
-            }
-        } else {
-            pendingAutoAction_();
-            pendingAutoAction_ = nullptr;
-        }
+        break;
+    default:
+        pendingAutoAction_ = [this]() {
+            doRest();
+        };
+        break;
+    }
+    if (plan.moveX >= 0 && (plan.moveX != ch->x || plan.moveY != ch->y)) {
+        stage_ = Moving;
+        movingPath_.clear();
+        ai_.movePath(plan.moveX, plan.moveY, movingPath_);
+    } else {
+        pendingAutoAction_();
+        pendingAutoAction_ = nullptr;
     }
 }
 
@@ -1224,9 +941,8 @@ void Warfield::maskSelectableArea(int steps, int ranges, bool zoecheck) {
     auto *ch = charQueue_.back();
     getSelectableArea(ch, selCells_, steps, ranges, zoecheck);
     int w = mapWidth_;
-    for (auto &c: selCells_) {
-        auto &ci = cellInfo_[c.first.first + c.first.second * w];
-        ci.insideMovingArea = true;
+    for (auto *c: selCells_) {
+        cellInfo_[c->x + c->y * w].insideMovingArea = true;
     }
     cursorX_ = ch->x;
     cursorY_ = ch->y;
@@ -1234,164 +950,16 @@ void Warfield::maskSelectableArea(int steps, int ranges, bool zoecheck) {
 
 void Warfield::unmaskArea() {
     int w = mapWidth_;
-    for (auto c: selCells_) {
-        cellInfo_[c.first.first + c.first.second * w].insideMovingArea = false;
+    for (auto *c: selCells_) {
+        cellInfo_[c->x + c->y * w].insideMovingArea = false;
     }
     selCells_.clear();
 }
 
-void Warfield::getSelectableArea(CharInfo *ch, std::map<std::pair<int, int>, SelectableCell> &selCells, int steps, int ranges, bool zoecheck) {
-    struct CompareSelCells {
-        bool operator()(const SelectableCell *a, const SelectableCell *b) {
-            return a->moves > b->moves;
-        }
-    };
-    auto myside = ch->side;
-    int w = mapWidth_, h = mapHeight_;
-    std::vector<SelectableCell*> sortedMovable;
-
-    selCells.clear();
-    auto &start = selCells[std::make_pair(ch->x, ch->y)];
-    start.x = ch->x;
-    start.y = ch->y;
-    start.moves = 0;
-    start.ranges = 0;
-    start.moveParent = nullptr;
-    start.rangeParent = nullptr;
-    if (steps > 0) {
-        sortedMovable.push_back(&start);
-    }
-    while (!sortedMovable.empty()) {
-        std::pop_heap(sortedMovable.begin(), sortedMovable.end(), CompareSelCells());
-        auto *mc = sortedMovable.back();
-        sortedMovable.erase(sortedMovable.end() - 1);
-        bool zoeblocked = false;
-        int nx[4], ny[4], ncnt = 0;
-        for (int i = 0; i < 4; ++i) {
-            int tx, ty;
-            switch (i) {
-            case 0:
-                if (mc->y <= 0) { continue; }
-                tx = mc->x;
-                ty = mc->y - 1;
-                break;
-            case 1:
-                if (mc->x + 1 >= w) { continue; }
-                tx = mc->x + 1;
-                ty = mc->y;
-                break;
-            case 2:
-                if (mc->x <= 0) { continue; }
-                tx = mc->x - 1;
-                ty = mc->y;
-                break;
-            default:
-                if (mc->y + 1 >= h) { continue; }
-                tx = mc->x;
-                ty = mc->y + 1;
-                break;
-            }
-            if (zoecheck) {
-                auto &ci = cellInfo_[ty * w + tx];
-                if (ci.charInfo && ci.charInfo->side == myside) {
-                    zoeblocked = true;
-                    break;
-                }
-            }
-            nx[ncnt] = tx;
-            ny[ncnt] = ty;
-            ++ncnt;
-        }
-        if (zoeblocked) { continue; }
-        for (int i = 0; i < ncnt; ++i) {
-            int tx = nx[i], ty = ny[i];
-            auto &ci = cellInfo_[ty * w + tx];
-            if (ci.charInfo || ci.blocked) {
-                continue;
-            }
-            auto currMove = mc->moves + 1;
-            auto ite = selCells.find(std::make_pair(tx, ty));
-            if (ite == selCells.end()) {
-                auto &mcell = selCells[std::make_pair(tx, ty)];
-                mcell.x = tx;
-                mcell.y = ty;
-                mcell.moves = currMove;
-                mcell.moveParent = mc;
-                if (currMove < steps) {
-                    sortedMovable.push_back(&mcell);
-                    std::push_heap(sortedMovable.begin(), sortedMovable.end(), CompareSelCells());
-                }
-            }
-        }
-    }
-    if (ranges) {
-        struct CompareRangeCells {
-            bool operator()(const SelectableCell *a, const SelectableCell *b) {
-                return a->ranges > b->ranges;
-            }
-        };
-        std::vector<SelectableCell*> sortedAttackable;
-        sortedAttackable.reserve(selCells.size());
-        for (auto &p: selCells) {
-            sortedAttackable.push_back(&p.second);
-        }
-        std::make_heap(sortedAttackable.begin(), sortedAttackable.end(), CompareRangeCells());
-        while (!sortedAttackable.empty()) {
-            std::pop_heap(sortedAttackable.begin(), sortedAttackable.end(), CompareRangeCells());
-            auto *mc = sortedAttackable.back();
-            sortedAttackable.erase(sortedAttackable.end() - 1);
-            int nx[4], ny[4], ncnt = 0;
-            for (int i = 0; i < 4; ++i) {
-                int tx, ty;
-                switch (i) {
-                case 0:
-                    if (mc->x <= 0) { continue; }
-                    tx = mc->x - 1;
-                    ty = mc->y;
-                    break;
-                case 1:
-                    if (mc->y <= 0) { continue; }
-                    tx = mc->x;
-                    ty = mc->y - 1;
-                    break;
-                case 2:
-                    if (mc->x + 1 >= w) { continue; }
-                    tx = mc->x + 1;
-                    ty = mc->y;
-                    break;
-                default:
-                    if (mc->y + 1 >= h) { continue; }
-                    tx = mc->x;
-                    ty = mc->y + 1;
-                    break;
-                }
-                nx[ncnt] = tx;
-                ny[ncnt] = ty;
-                ++ncnt;
-            }
-            for (int i = 0; i < ncnt; ++i) {
-                int tx = nx[i], ty = ny[i];
-                auto &ci = cellInfo_[ty * w + tx];
-                if (ci.blocked) {
-                    continue;
-                }
-                auto currRange = mc->ranges + 1;
-                auto ite = selCells.find(std::make_pair(tx, ty));
-                if (ite == selCells.end()) {
-                    auto &mcell = selCells[std::make_pair(tx, ty)];
-                    mcell.x = tx;
-                    mcell.y = ty;
-                    mcell.moves = -1;
-                    mcell.ranges = currRange;
-                    mcell.rangeParent = mc;
-                    if (currRange < ranges) {
-                        sortedAttackable.push_back(&mcell);
-                        std::push_heap(sortedAttackable.begin(), sortedAttackable.end(), CompareRangeCells());
-                    }
-                }
-            }
-        }
-    }
+void Warfield::getSelectableArea(CharInfo *ch, SelectableArea &selCells, int steps, int ranges, bool zoecheck) {
+    selCells.calc(mapWidth_, mapHeight_, ch->x, ch->y, steps, ranges, zoecheck, [this, myside = ch->side](int index) {
+        return cellFlags(index, myside);
+    });
 }
 
 class DirectionSelMessageBox: public MessageBox {
@@ -1553,8 +1121,7 @@ void Warfield::startActAction() {
         if (cameraX_ != cursorX_ || cameraY_ != cursorY_) {
             ch->direction = calcDirection(cameraX_, cameraY_, cursorX_, cursorY_);
         }
-        fightTex_ = ch->info.headId >= 0 && ch->info.headId < fightTexData_.size()
-            ? &fightTexData_[ch->info.headId] : nullptr;
+        fightTex_ = fightTexCache_.get(ch->info.headId);
         fightTexCount_ = ch->info.frame[0];
         fightTexIdx_ = fightTexCount_ * int(ch->direction);
         fightTexCount_ += fightTexIdx_;
@@ -1573,8 +1140,7 @@ void Warfield::startActAction() {
             && (cameraX_ != cursorX_ || cameraY_ != cursorY_)) {
             ch->direction = calcDirection(cameraX_, cameraY_, cursorX_, cursorY_);
         }
-        fightTex_ = ch->info.headId >= 0 && ch->info.headId < fightTexData_.size()
-                    ? &fightTexData_[ch->info.headId] : nullptr;
+        fightTex_ = fightTexCache_.get(ch->info.headId);
         fightTexIdx_ = 0;
         for (std::int16_t i = 0; i < skillType; ++i) {
             fightTexIdx_ += 4 * ch->info.frame[i];
@@ -1585,62 +1151,11 @@ void Warfield::startActAction() {
         effectTexIdx_ = -ch->info.frameDelay[skillType];
         fightFrame_ = -ch->info.frameSoundDelay[skillType];
 
-        switch (skillInfo->attackAreaType) {
-        case 1: {
-            auto sx = cameraX_, sy = cameraY_;
-            int r = skillInfo->selRange[actLevel_];
-            for (int i = r; i; --i) {
-                switch (ch->direction) {
-                case Map::DirUp:
-                    if (sy >= i) { makeDamage(ch, sx, sy - i, i); }
-                    break;
-                case Map::DirRight:
-                    if (sx + i < mapWidth_) { makeDamage(ch, sx + i, sy, i); }
-                    break;
-                case Map::DirLeft:
-                    if (sx >= i) { makeDamage(ch, sx - i, sy, i); }
-                    break;
-                case Map::DirDown:
-                    if (sy + i < mapHeight_) { makeDamage(ch, sx, sy + i, i); }
-                    break;
-                default:
-                    break;
-                }
-            }
-            break;
-        }
-        case 2: {
-            auto sx = cameraX_, sy = cameraY_;
-            int r = skillInfo->selRange[actLevel_];
-            for (int i = r; i; --i) {
-                if (sy >= i) { makeDamage(ch, sx, sy - i, i); }
-                if (sx + i < mapWidth_) { makeDamage(ch, sx + i, sy, i); }
-                if (sx >= i) { makeDamage(ch, sx - i, sy, i); }
-                if (sy + i < mapHeight_) { makeDamage(ch, sx, sy + i, i); }
-            }
-            break;
-        }
-        case 3: {
-            auto sx = cursorX_, sy = cursorY_;
-            int r = skillInfo->area[actLevel_];
-            int baseDistance = std::abs(sx - cameraX_) + std::abs(sy - cameraY_);
-            for (int j = -r; j <= r; ++j) {
-                auto ry = sy + j;
-                if (ry < 0 || ry >= mapHeight_) { continue; }
-                for (int i = -r; i <= r; ++i) {
-                    auto rx = sx + i;
-                    if (rx < 0 || rx >= mapWidth_) { continue; }
-                    makeDamage(ch, rx, ry, baseDistance + std::abs(i) + std::abs(j));
-                }
-            }
-            break;
-        }
-        default: {
-            int x = cursorX_, y = cursorY_;
-            makeDamage(ch, x, y, std::abs(x - cameraX_) + std::abs(y - cameraY_));
-            break;
-        }
-        }
+        forEachSkillCell(skillInfo->attackAreaType, skillInfo->selRange[actLevel_], skillInfo->area[actLevel_],
+                         cameraX_, cameraY_, int(ch->direction), cursorX_, cursorY_, mapWidth_, mapHeight_,
+                         [this, ch](int x, int y, int distance) {
+            makeDamage(ch, x, y, distance);
+        });
         mem::postDamage(&ch->info, actIndex_, attackTimesLeft_ == 1 ? 3 : 0, skillLevelup_);
         if (skillLevelup_) {
             actLevel_ = std::clamp<std::int16_t>(ch->info.skillLevel[actIndex_] / 100, 0, 9);
@@ -1806,7 +1321,7 @@ void Warfield::endWar() {
                             auto addMp = skillInfo->addMp[newlevel];
                             if (addMp) {
                                 charInfo->maxMp = std::clamp<std::int16_t>(
-                                    charInfo->maxMp + util::gRandom(1, addMp / 2), 0, data::MpMax);
+                                    charInfo->maxMp + util::gCombatRandom(1, addMp / 2), 0, data::MpMax);
                             }
                         }
                     }
@@ -1839,7 +1354,7 @@ void Warfield::endWar() {
                     }
                     charInfo->expForMakeItem = 0;
                     mem::gBag.remove(itemInfo->reqMaterial, 1);
-                    auto index = util::gRandom(count);
+                    auto index = util::gCombatRandom(count);
                     mem::gBag.add(itemInfo->makeItem[index], itemInfo->makeItemCount[index]);
                     messages.emplace_back(std::make_pair(0, fmt::format(GETTEXT(99),
                                                                         name, GETITEMNAME(itemInfo->makeItem[index]))));
@@ -1875,4 +1390,21 @@ void Warfield::popupFinishMessages(std::vector<std::pair<int, std::wstring>> mes
     });
 }
 
+void Warfield::prefetchFightTextures() {
+    const auto *info = data::gWarfieldData.info(warId_);
+    std::vector<std::int16_t> heads;
+    auto addChar = [&heads](std::int16_t id) {
+        if (id < 0) { return; }
+        const auto *charInfo = mem::gSaveData.charInfo[id];
+        if (charInfo) { heads.emplace_back(charInfo->headId); }
+    };
+    if (info->forceMembers[0] >= 0) {
+        for (auto id: info->forceMembers) { addChar(id); }
+    } else {
+        for (auto id: mem::gSaveData.baseInfo->members) { addChar(id); }
+    }
+    for (auto id: info->enemy) { addChar(id); }
+    fightTexCache_.prefetch(heads);
+}
+
 }
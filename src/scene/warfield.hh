@@ -20,6 +20,8 @@
 #pragma once
 
 #include "map.hh"
+#include "battleai.hh"
+#include "data/grpcache.hh"
 #include "mem/character.hh"
 #include <vector>
 #include <map>
@@ -38,6 +40,8 @@ class Warfield: public Map {
         AttackSelecting,
         Moving,
         Acting,
+        /* AI is scoring targets, spread over frames */
+        Thinking,
         PoppingUp,
         Finished,
     };
@@ -59,10 +63,7 @@ class Warfield: public Map {
         CharInfo *charInfo = nullptr;
         std::uint8_t insideMovingArea = 0;
     };
-    struct SelectableCell {
-        int x, y, moves, ranges;
-        SelectableCell *moveParent, *rangeParent;
-    };
+    using SelectableCell = SelectableArea::Cell;
     struct PopupNumber {
         std::wstring str;
         int x, y;
@@ -76,22 +77,26 @@ public:
     bool load(std::int16_t warId);
     inline void setGetExpOnLose(bool b) { getExpOnLose_ = b; }
     inline void setDeadOnLose(bool b) { deadOnLose_ = b; }
+    inline void setAutoControl(bool b) { autoControl_ = b; }
     bool getDefaultChars(std::set<std::int16_t> &chars) const;
     void putChars(const std::vector<std::int16_t> &chars);
 
     void render() override;
     void handleKeyInput(Key key) override;
+    [[nodiscard]] std::uint64_t nextWakeTime() const override;
 
 protected:
     void frameUpdate() override;
 
     void nextAction();
     void autoAction();
+    void continueThinking();
     void recalcKnowledge();
     void playerMenu();
     void maskSelectableArea(int steps, int ranges, bool zoecheck = false);
     void unmaskArea();
-    void getSelectableArea(CharInfo *ch, std::map<std::pair<int, int>, SelectableCell> &selCells, int steps, int ranges, bool zoecheck = false);
+    [[nodiscard]] std::uint8_t cellFlags(int index, int myside) const;
+    void getSelectableArea(CharInfo *ch, SelectableArea &selCells, int steps, int ranges, bool zoecheck = false);
     bool tryUseSkill(int index);
     void startActAction();
     void makeDamage(CharInfo *ch, int x, int y, int distance);
@@ -99,6 +104,7 @@ protected:
     void endTurn();
     void endWar();
     void popupFinishMessages(std::vector<std::pair<int, std::wstring>> messages, int index);
+    void prefetchFightTextures();
 
 private:
     std::int16_t warId_ = -1;
@@ -116,18 +122,20 @@ private:
     bool autoControl_ = false;
     bool won_ = false;
     bool skillLevelup_ = false;
-    std::map<std::pair<int, int>, SelectableCell> selCells_;
+    SelectableArea selCells_;
+    /* used by autoAction() only, so it never clobbers the player's masked area */
+    BattleAI ai_;
     std::vector<std::pair<int, int>> movingPath_;
     /* -3poison -2depoison -1medic 0~skillId */
     std::int16_t actIndex_ = -1, actId_ = -1, actLevel_ = 0;
     int effectId_ = -1, effectTexIdx_ = -1, fightTexIdx_ = -1, fightTexCount_ = 0, fightFrame_ = 0;
     int attackTimesLeft_ = 0;
-    const std::vector<std::string> *fightTex_ = nullptr;
+    data::GrpCache::DataSetPtr fightTex_;
     std::vector<PopupNumber> popupNumbers_;
     std::function<void()> pendingAutoAction_;
     Node *statusPanel_ = nullptr;
     Texture *drawingTerrainTex2_ = nullptr;
-    std::vector<std::vector<std::string>> fightTexData_;
+    data::GrpCache fightTexCache_;
 };
 
 }
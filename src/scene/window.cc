@@ -25,6 +25,7 @@
 #include "warfield.hh"
 #include "effect.hh"
 #include "talkbox.hh"
+#include "inputrecord.hh"
 #include "title.hh"
 #include "dead.hh"
 #include "endscreen.hh"
@@ -37,14 +38,20 @@
 #include "data/factors.hh"
 #include "data/grpdata.hh"
 #include "data/event.hh"
+#include "data/loader.hh"
 #include "mem/strings.hh"
 #include "mem/savedata.hh"
 #include "core/config.hh"
+#include "core/profiler.hh"
 #include "util/conv.hh"
+#include "util/taskgraph.hh"
+#include "util/bytes.hh"
 
 #include <SDL.h>
 #include <fmt/format.h>
 #include <thread>
+#include <memory>
+#include <algorithm>
 #include <stdexcept>
 
 namespace hojy::scene {
@@ -69,7 +76,30 @@ static void optionMenu(Node *mainMenu, int x, int y);
 
 static const char *GameWindowTitle = "Heroes of Jin Yong " HOJY_VERSION;
 
+enum {
+    GlyphRasterTasks = 4,
+};
+
+/* glyphs of text known at load time, rasterized by worker tasks and uploaded to font atlas at once */
+struct GlyphPrewarm {
+    std::vector<std::uint32_t> chars;
+    std::vector<TTF::GlyphBitmap> glyphs[GlyphRasterTasks];
+    std::uint64_t startTime = 0;
+};
+
+static void collectChars(std::vector<std::uint32_t> &chars, const std::wstring &str) {
+    for (auto ch: str) {
+        if (ch >= 32) { chars.push_back(std::uint32_t(ch)); }
+    }
+}
+
+static void uniqueChars(std::vector<std::uint32_t> &chars) {
+    std::sort(chars.begin(), chars.end());
+    chars.erase(std::unique(chars.begin(), chars.end()), chars.end());
+}
+
 Window::Window(int w, int h): width_(w), height_(h), freq_(SDL_GetPerformanceFrequency() / 1000000ULL) {
+    startTime_ = SDL_GetPerformanceCounter() / freq_;
     if (gWindow) {
         throw std::runtime_error("Duplicate window creation");
     }
@@ -88,6 +118,11 @@ Window::Window(int w, int h): width_(w), height_(h), freq_(SDL_GetPerformanceFre
     gWindow = this;
 
     renderer_ = new Renderer(win_, w, h);
+#if defined(USE_PROFILER)
+    if (!core::config.profilerTrace().empty()) {
+        core::gProfiler.startTrace(core::config.profilerTrace());
+    }
+#endif
     renderer_->enableLinear(false);
 
     gNormalPalette.load("MMAP");
@@ -101,42 +136,20 @@ Window::Window(int w, int h): width_(w), height_(h), freq_(SDL_GetPerformanceFre
 
     headTextureMgr_.setPalette(gNormalPalette);
     headTextureMgr_.setRenderer(renderer_);
-    data::GrpData::DataSet dset;
-    renderer_->enableLinear(true);
-    if (data::GrpData::loadData("HDGRP", dset)) {
-        headTextureMgr_.loadFromRLE(dset);
-    }
-    renderer_->enableLinear(false);
-    gEffect.load("EFT");
 
     globalMap_ = new GlobalMap(renderer_, 0, 0, w, h, core::config.scale());
     subMap_ = new SubMap(renderer_, 0, 0, w, h, core::config.scale());
     warfield_ = new Warfield(renderer_, 0, 0, w, h, core::config.scale());
 
-    {
-        const auto *arr = reinterpret_cast<const int16_t*>(globalMap_->texData(data::ItemTexIdStart).data());
-        itemTexW_ = arr[0];
-        itemTexH_ = arr[1];
-    }
-    itemWCount_ = 1024 / itemTexW_;
-    itemHCount_ = (data::BagItemCount + itemWCount_ - 1) / itemWCount_;
-    int height = itemTexH_ * itemHCount_;
-    itemTexture_ = Texture::create(renderer_, itemTexW_ * itemWCount_, height);
-    itemTexture_->enableBlendMode(true);
-    int pitch;
-    const auto *colors = gNormalPalette.colors();
-    auto *pixels = itemTexture_->lock(pitch);
-    for (int i = 0; i < data::BagItemCount; ++i) {
-        Texture::renderRLE(globalMap_->texData(data::ItemTexIdStart + i), colors, pixels, pitch, height, itemTexW_ * (i % itemWCount_), itemTexH_ * (i / itemWCount_));
-    }
-    itemTexture_->unlock();
     SDL_ShowWindow(win);
     audio::gMixer.init(3);
     audio::gMixer.pause(false);
     title();
+    startLoading();
 }
 
 Window::~Window() {
+    finishLoading();
     closePopup();
     headTextureMgr_.clear();
     gEffect.clear();
@@ -160,13 +173,128 @@ void Window::renderItemTexture(std::int16_t id, int x, int y, int w, int h) {
                              itemTexW_, itemTexH_, true);
 }
 
+void Window::startLoading() {
+    loader_ = new util::TaskGraph;
+    auto dataTasks = data::loadData(*loader_);
+    loader_->add("effects", [] { gEffect.load("EFT"); }, {dataTasks.factors});
+    auto heads = std::make_shared<data::GrpData::DataSet>();
+    auto headsRead = loader_->add("heads", [heads] { data::GrpData::loadData("HDGRP", *heads); });
+    loader_->add("heads_upload", [this, heads] {
+        renderer_->enableLinear(true);
+        headTextureMgr_.loadFromRLE(*heads);
+        renderer_->enableLinear(false);
+    }, {headsRead}, util::TaskGraph::Main);
+    auto *globalMap = dynamic_cast<GlobalMap*>(globalMap_);
+    auto mapData = loader_->add("globalmap", [globalMap] { globalMap->loadData(); });
+    loader_->add("globalmap_upload", [globalMap] { globalMap->initTextures(); }, {mapData}, util::TaskGraph::Main);
+    loader_->add("items_upload", [this] {
+        {
+            const auto *arr = globalMap_->texData(data::ItemTexIdStart).data();
+            itemTexW_ = util::readLE16s(arr);
+            itemTexH_ = util::readLE16s(arr + 2);
+        }
+        itemWCount_ = 1024 / itemTexW_;
+        itemHCount_ = (data::BagItemCount + itemWCount_ - 1) / itemWCount_;
+        int height = itemTexH_ * itemHCount_;
+        itemTexture_ = Texture::create(renderer_, itemTexW_ * itemWCount_, height);
+        itemTexture_->enableBlendMode(true);
+        int pitch;
+        const auto *colors = gNormalPalette.colors();
+        auto *pixels = itemTexture_->lock(pitch);
+        for (int i = 0; i < data::BagItemCount; ++i) {
+            Texture::renderRLE(globalMap_->texData(data::ItemTexIdStart + i), colors, pixels, pitch, height, itemTexW_ * (i % itemWCount_), itemTexH_ * (i / itemWCount_));
+        }
+        itemTexture_->unlock();
+    }, {mapData}, util::TaskGraph::Main);
+    auto *ttf = renderer_->ttf();
+    auto fontSize = ttf->fontSize();
+    auto glyphs = std::make_shared<GlyphPrewarm>();
+    auto glyphChars = loader_->add("glyph_chars", [this, glyphs] {
+        glyphs->startTime = SDL_GetPerformanceCounter() / freq_;
+        auto &chars = glyphs->chars;
+        for (std::uint32_t ch = 32; ch < 127; ++ch) {
+            chars.push_back(ch);
+        }
+        for (const auto &str: mem::gStrings.strings(mem::Strings::Text)) {
+            collectChars(chars, str);
+        }
+        collectChars(chars, data::gEvent.talkCharset());
+        uniqueChars(chars);
+    }, {dataTasks.talks});
+    util::TaskGraph::TaskId glyphRaster[GlyphRasterTasks];
+    for (int i = 0; i < GlyphRasterTasks; ++i) {
+        glyphRaster[i] = loader_->add(fmt::format("glyph_raster{}", i), [ttf, fontSize, glyphs, i] {
+            ttf->rasterize(glyphs->chars, i, GlyphRasterTasks, glyphs->glyphs[i], fontSize);
+        }, {glyphChars});
+    }
+    /* dependency list below names every raster task */
+    static_assert(GlyphRasterTasks == 4);
+    loader_->add("glyph_upload", [this, ttf, fontSize, glyphs] {
+        size_t count = 0;
+        for (auto &g: glyphs->glyphs) {
+            count += ttf->upload(g, fontSize);
+        }
+        fmt::print("Prewarmed {} glyphs of {} chars in {:.2f}ms\n", count, glyphs->chars.size(),
+                   double(SDL_GetPerformanceCounter() / freq_ - glyphs->startTime) / 1000.);
+    }, {glyphRaster[0], glyphRaster[1], glyphRaster[2], glyphRaster[3]}, util::TaskGraph::Main);
+    loader_->start();
+}
+
+void Window::prewarmNameGlyphs() {
+    auto startTime = SDL_GetPerformanceCounter() / freq_;
+    std::vector<std::uint32_t> chars;
+    for (auto t = int(mem::Strings::CharName); t < int(mem::Strings::StringsMax); ++t) {
+        for (const auto &str: mem::gStrings.strings(mem::Strings::Type(t))) {
+            collectChars(chars, str);
+        }
+    }
+    uniqueChars(chars);
+    /* most of them are already cached from talks, so rasterize the rest here */
+    auto count = renderer_->ttf()->prewarm(chars);
+    fmt::print("Prewarmed {} glyphs of names in {:.2f}ms\n", count,
+               double(SDL_GetPerformanceCounter() / freq_ - startTime) / 1000.);
+}
+
+void Window::finishLoading() {
+    if (!loader_) { return; }
+    loader_->wait();
+    fmt::print("Startup finished after {:.2f}ms\n", double(SDL_GetPerformanceCounter() / freq_ - startTime_) / 1000.);
+    loader_->report();
+    delete loader_;
+    loader_ = nullptr;
+}
+
+Node *Window::inputNode() {
+    /* game data is not ready until loading finishes, so input must wait for it */
+    finishLoading();
+    return popup_ ? popup_ : map_;
+}
+
 bool Window::processEvents() {
+    bool replaying = gInputRecord.mode() == InputRecord::Replaying;
+    if (replaying) {
+        if (replayEnded_) {
+            fmt::print("Replay finished\n");
+            return false;
+        }
+        /* recorded input replaces real input, with update time it was received at */
+        InputRecord::Event ev;
+        while (gInputRecord.nextEvent(ev)) {
+            currTime_ = startTime_ + ev.time;
+            if (ev.key == Node::KeyNone) {
+                sendText(ev.text);
+            } else {
+                sendKey(ev.key);
+            }
+            inputReceived_ = true;
+        }
+    }
     for (auto &p: pressedKeys_) {
         if (currTime_ >= p.second.first) {
             p.second.first += 20 * 1000;
             if (p.second.first < currTime_) { p.second.first = currTime_; }
-            auto *node = popup_ ? popup_ : map_;
-            if (node) { node->doHandleKeyInput(p.second.second); }
+            sendKey(p.second.second);
+            inputReceived_ = true;
         }
     }
     static const std::map<SDL_Scancode, Node::Key> inputMap = {
@@ -196,6 +324,8 @@ bool Window::processEvents() {
     };
     SDL_Event e;
     while (SDL_PollEvent(&e)) {
+        /* any event may change what is on screen, so it is never followed by an idle wait */
+        inputReceived_ = true;
         switch (e.type) {
         case SDL_CONTROLLERDEVICEADDED: {
             SDL_GameControllerOpen(e.cdevice.which);
@@ -206,11 +336,11 @@ bool Window::processEvents() {
             break;
         }
         case SDL_CONTROLLERBUTTONDOWN: {
+            if (replaying) { break; }
             auto ite = buttonMap.find(SDL_GameControllerButton(e.cbutton.button));
             if (ite != buttonMap.end()) {
                 pressedKeys_[-int(ite->first)] = std::make_pair(currTime_ + 180 * 1000, ite->second);
-                auto *node = popup_ ? popup_ : map_;
-                if (node) { node->doHandleKeyInput(ite->second); }
+                sendKey(ite->second);
             }
             break;
         }
@@ -222,17 +352,16 @@ bool Window::processEvents() {
             break;
         }
         case SDL_TEXTINPUT: {
-            auto *node = popup_ ? popup_ : map_;
-            node->doTextInput(util::Utf8Conv::toUnicode(e.text.text));
+            if (replaying) { break; }
+            sendText(util::Utf8Conv::toUnicode(e.text.text));
             break;
         }
         case SDL_KEYDOWN: {
-            if (e.key.repeat) { break; }
+            if (e.key.repeat || replaying) { break; }
             auto ite = inputMap.find(e.key.keysym.scancode);
             if (ite != inputMap.end()) {
                 pressedKeys_[int(ite->first)] = std::make_pair(currTime_ + 180 * 1000, ite->second);
-                auto *node = popup_ ? popup_ : map_;
-                if (node) { node->doHandleKeyInput(ite->second); }
+                sendKey(ite->second);
             }
             break;
         }
@@ -250,8 +379,46 @@ bool Window::processEvents() {
     return true;
 }
 
+void Window::injectKey(Node::Key key) {
+    auto *node = inputNode();
+    if (node) { node->doHandleKeyInput(key); }
+}
+
+void Window::sendKey(Node::Key key) {
+    auto *node = inputNode();
+    gInputRecord.recordKey(currTime_ - startTime_, key);
+    if (node) { node->doHandleKeyInput(key); }
+}
+
+void Window::sendText(const std::wstring &text) {
+    auto *node = inputNode();
+    gInputRecord.recordText(currTime_ - startTime_, text);
+    if (node) { node->doTextInput(text); }
+}
+
 void Window::update() {
+    PROFILE_SCOPE("update");
     currTime_ = SDL_GetPerformanceCounter() / freq_;
+    switch (gInputRecord.mode()) {
+    case InputRecord::Recording:
+        gInputRecord.recordFrame(currTime_ - startTime_);
+        break;
+    case InputRecord::Replaying: {
+        /* game logic only sees recorded time, so it runs same steps as recorded session */
+        std::uint64_t time;
+        if (gInputRecord.nextFrame(time)) {
+            currTime_ = startTime_ + time;
+        } else {
+            replayEnded_ = true;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    if (loader_ && loader_->poll()) {
+        finishLoading();
+    }
     if (map_) {
         map_->doUpdate();
     }
@@ -267,7 +434,31 @@ void Window::render() {
     if (popup_) {
         popup_->doRender();
     }
+#if defined(USE_PROFILER)
+    if (core::config.showProfiler()) {
+        renderProfiler();
+    }
+#endif
+}
+
+#if defined(USE_PROFILER)
+void Window::renderProfiler() {
+    const auto &phases = core::gProfiler.phases();
+    auto *ttf = renderer_->ttf();
+    int lineHeight = ttf->fontSize() + 2;
+    renderer_->fillRect(0, 0, ttf->fontSize() * 10, lineHeight * int(phases.size() + 1) + 4, 0, 0, 0, 160);
+    ttf->setColor(236, 236, 236);
+    int y = 2;
+    for (const auto &phase: phases) {
+        std::wstring name(phase.name, phase.name + strlen(phase.name));
+        ttf->render(fmt::format(L"{:<12}{:7.2f}ms", name, core::Profiler::average(phase)), 4, y, true);
+        y += lineHeight;
+    }
+    auto layoutCalls = ttf->layoutHits() + ttf->layoutMisses();
+    ttf->render(fmt::format(L"{:<12}{:7.2f}%", L"layout_hit",
+                            layoutCalls ? double(ttf->layoutHits()) * 100. / double(layoutCalls) : 0.), 4, y, true);
 }
+#endif
 
 bool Window::flush() {
     currTime_ = SDL_GetPerformanceCounter() / freq_;
@@ -276,6 +467,11 @@ bool Window::flush() {
         return false;
     }
     renderer_->present();
+    PROFILE_FRAME_END();
+    if (!firstFrameTime_) {
+        firstFrameTime_ = currTime_ - startTime_;
+        fmt::print("First frame after {:.2f}ms\n", double(firstFrameTime_) / 1000.);
+    }
     if (core::config.showFPS()) {
         static float lastFPS = 0.f;
         float fps = renderer_->fps();
@@ -284,10 +480,47 @@ bool Window::flush() {
                                fmt::format("{}     FPS: {}", GameWindowTitle, fps).c_str());
         }
     }
-    SDL_Delay(1);
     return true;
 }
 
+void Window::waitIdle() {
+    /* upper bound of a single wait, in case some animation does not report its wake-up time */
+    constexpr std::uint64_t MaxIdleWait = 1000 * 1000;
+    currTime_ = SDL_GetPerformanceCounter() / freq_;
+    if (gInputRecord.mode() == InputRecord::Replaying) {
+        /* keep pace of recorded session */
+        auto next = gInputRecord.nextFrameTime();
+        if (next != Node::NoWakeTime && startTime_ + next > currTime_) {
+            SDL_Delay(std::uint32_t(std::min(startTime_ + next - currTime_, MaxIdleWait) / 1000ULL));
+        }
+        return;
+    }
+    auto wake = nextWakeTime();
+    if (inputReceived_ || wake <= currTime_ + 1000) {
+        inputReceived_ = false;
+        SDL_Delay(1);
+        return;
+    }
+    SDL_WaitEventTimeout(nullptr, int(std::min(wake - currTime_, MaxIdleWait) / 1000ULL));
+}
+
+std::uint64_t Window::nextWakeTime() const {
+    /* main thread tasks of loader are run in update() */
+    if (loader_) { return 0; }
+    auto res = Node::NoWakeTime;
+    /* key repeat of held keys, see processEvents() */
+    for (const auto &p: pressedKeys_) {
+        res = std::min(res, p.second.first);
+    }
+    if (map_) {
+        res = std::min(res, map_->doNextWakeTime());
+    }
+    if (popup_) {
+        res = std::min(res, popup_->doNextWakeTime());
+    }
+    return res;
+}
+
 void Window::playMusic(int idx) {
     (void)this;
     ++idx;
@@ -331,6 +564,7 @@ void Window::endscreen() {
 
 void Window::newGame() {
     mem::gStrings.saveDataLoaded();
+    prewarmNameGlyphs();
     map_ = subMap_;
     dynamic_cast<GlobalMap*>(globalMap_)->load();
     globalMap_->setPosition(mem::gSaveData.baseInfo->mainX, mem::gSaveData.baseInfo->mainY);
@@ -347,6 +581,7 @@ void Window::newGame() {
 bool Window::loadGame(int slot) {
     if (!mem::gSaveData.load(slot)) { return false; }
     mem::gStrings.saveDataLoaded();
+    prewarmNameGlyphs();
     dynamic_cast<GlobalMap*>(globalMap_)->load();
     globalMap_->setPosition(mem::gSaveData.baseInfo->mainX, mem::gSaveData.baseInfo->mainY);
     auto &binfo = mem::gSaveData.baseInfo;
@@ -23,6 +23,7 @@
 #include "texture.hh"
 #include "mapwithevent.hh"
 #include "messagebox.hh"
+#include "util/taskgraph.hh"
 
 #include <map>
 #include <string>
@@ -43,6 +44,8 @@ public:
     [[nodiscard]] inline int height() const { return height_; }
 
     [[nodiscard]] std::uint64_t currTime() { return currTime_; }
+    /* time from window creation to first presented frame, in microseconds, 0 before that */
+    [[nodiscard]] std::uint64_t firstFrameTime() const { return firstFrameTime_; }
 
     [[nodiscard]] inline const Texture *headTexture(std::int16_t id) const { return headTextureMgr_[id]; }
     [[nodiscard]] const Texture *smpTexture(std::int16_t id) const;
@@ -51,11 +54,21 @@ public:
     [[nodiscard]] int itemTexHeight() const { return itemTexH_; }
 
     [[nodiscard]] MapWithEvent *globalMap() const { return globalMap_; }
+    [[nodiscard]] MapWithEvent *subMap() const { return subMap_; }
+    [[nodiscard]] Map *warfield() const { return warfield_; }
+    [[nodiscard]] Map *currentMap() const { return map_; }
+    [[nodiscard]] bool hasPopup() const { return popup_ != nullptr; }
 
+    /* block until background loading started in constructor is finished */
+    void finishLoading();
     bool processEvents();
+    /* send key to current popup or map, as a single press from input device */
+    void injectKey(Node::Key key);
     void update();
     void render();
     bool flush();
+    /* block until next input event or scheduled update if nothing is animating */
+    void waitIdle();
 
     void playMusic(int idx);
     void playAtkSound(int idx);
@@ -83,6 +96,19 @@ public:
     bool runShop(std::int16_t id);
     void popupMessageBox(const std::vector<std::wstring> &text, MessageBox::Type type = MessageBox::Normal);
 
+private:
+    void startLoading();
+    /* cache glyphs of names loaded with save data */
+    void prewarmNameGlyphs();
+    Node *inputNode();
+    /* deliver input to current popup or map, and add it to input record */
+    void sendKey(Node::Key key);
+    void sendText(const std::wstring &text);
+    [[nodiscard]] std::uint64_t nextWakeTime() const;
+#if defined(USE_PROFILER)
+    void renderProfiler();
+#endif
+
 private:
     int width_, height_;
     void *win_ = nullptr;
@@ -101,7 +127,11 @@ private:
     int itemTexW_ = 0, itemTexH_ = 0, itemWCount_ = 0, itemHCount_ = 0;
 
     std::uint64_t currTime_ = 0, freq_ = 0;
+    std::uint64_t startTime_ = 0, firstFrameTime_ = 0;
+    util::TaskGraph *loader_ = nullptr;
     std::map<int, std::pair<std::uint64_t, Node::Key>> pressedKeys_;
+    bool inputReceived_ = false;
+    bool replayEnded_ = false;
     int playingMusic_ = -1;
 };
 
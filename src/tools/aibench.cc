@@ -0,0 +1,365 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* AI turn latency benchmark for warfield.
+ * Plays an AI turn (selectable area + target scoring + sorting) for every char of every warfield in WAR.STA/WARFLD,
+ * with a fixed set of skills and generated stats, using TargetScorer and the old loop over (skill, cell, enemy),
+ * checks both give same scores and prints average/max latency of a turn.
+ * Usage: aibench <data folder> [iterations] [work per frame] */
+
+#include "scene/targetscorer.hh"
+#include "data/warfielddata.hh"
+#include "util/file.hh"
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace hojy;
+
+using Area = scene::SelectableArea;
+using Scorer = scene::TargetScorer;
+
+bool loadGrp(const std::string &idx, const std::string &grp, std::vector<std::string> &dset) {
+    util::File ifs, ifs2;
+    ifs = util::File::open(idx);
+    ifs2 = util::File::open(grp);
+    if (!ifs || !ifs2) {
+        return false;
+    }
+    size_t count = ifs.size() / sizeof(std::uint32_t);
+    size_t fileSize = ifs2.size();
+    dset.resize(count);
+    std::uint32_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        std::uint32_t endoffset;
+        ifs.read(&endoffset, sizeof(endoffset));
+        if (endoffset == 0) {
+            endoffset = fileSize;
+        }
+        if (endoffset > offset) {
+            dset[i].resize(endoffset - offset);
+            ifs2.seek(offset);
+            ifs2.read(dset[i].data(), endoffset - offset);
+            offset = endoffset;
+        }
+    }
+    return true;
+}
+
+/* same as mem::calcPredictDamage() */
+int predictDamage(int atk, int def, int stamina, int hurt, int distance) {
+    int dmg = (atk - def * 3) * 2 / 3;
+    if (dmg < 0) {
+        dmg = atk / 10;
+    }
+    if (dmg > 0) {
+        dmg += stamina / 15 + hurt / 20;
+        if (distance > 1) {
+            if (distance <= 10) {
+                dmg = dmg * (100 - (distance - 1) * 3) / 100;
+            } else {
+                dmg = dmg * 2 / 3;
+            }
+        }
+    } else {
+        dmg = 1;
+    }
+    return std::int16_t(dmg);
+}
+
+struct Unit {
+    int side, x, y;
+    int atk, defence, stamina, hurt, hp, maxHp;
+};
+
+struct Layout {
+    std::int16_t warId;
+    std::uint8_t blocked[data::WarFieldWidth * data::WarFieldHeight];
+    std::vector<Unit> units;
+};
+
+struct SkillInfo {
+    std::int16_t rangeType, skillRange, area, atkBonus;
+};
+
+static const SkillInfo gSkills[] = {
+    {0, 4, 0, 0},
+    {1, 5, 0, 50},
+    {2, 4, 0, 100},
+    {3, 3, 2, 150},
+    {3, 6, 3, 200},
+};
+static const int gSkillCount = int(sizeof(gSkills) / sizeof(gSkills[0]));
+
+/* the scoring loop used before TargetScorer, kept as reference */
+void oldScoring(const Area &selCells, const Unit &ch, const Unit *const *enemies, int enemyCount,
+                const std::vector<const Unit*> &cellUnit, std::vector<Scorer::Score> &scores) {
+    const int w = data::WarFieldWidth;
+    scores.clear();
+    scores.reserve(selCells.size());
+    for (int j = 0; j < gSkillCount; ++j) {
+        const auto &skill = gSkills[j];
+        auto atk = ch.atk + skill.atkBonus;
+        auto calc = [&](const Unit *enemy, int distance, bool keepMax) {
+            int dmg = predictDamage(atk, enemy->defence, ch.stamina, enemy->hurt, distance);
+            if (dmg >= enemy->hp) { dmg = keepMax ? std::max<int>(dmg * 3 / 2, enemy->maxHp) : dmg * 3 / 2; }
+            return dmg;
+        };
+        for (auto *c: selCells) {
+            std::int16_t x = c->x, y = c->y;
+            switch (skill.rangeType) {
+            case 1: {
+                if (c->moves < 0) { continue; }
+                int totalDmg[4] = {0, 0, 0, 0};
+                for (int i = 0; i < enemyCount; ++i) {
+                    auto *enemy = enemies[i];
+                    int ex = enemy->x, ey = enemy->y;
+                    auto r = skill.skillRange;
+                    int distance;
+                    if ((ex == x && (distance = std::abs(ey - y)) <= r)
+                        || (ey == y && (distance = std::abs(ex - x)) <= r)) {
+                        int dmg = calc(enemy, distance, true);
+                        if (ey < y)
+                            totalDmg[0] += dmg;
+                        else if (ex > x)
+                            totalDmg[1] += dmg;
+                        else if (ex < x)
+                            totalDmg[2] += dmg;
+                        else
+                            totalDmg[3] += dmg;
+                    }
+                }
+                for (std::int16_t i = 0; i < 4; ++i) {
+                    if (totalDmg[i] > 0) {
+                        scores.emplace_back(Scorer::Score {totalDmg[i], x, y, i, -1, j});
+                    }
+                }
+                break;
+            }
+            case 2: {
+                if (c->moves < 0) { continue; }
+                int totalDmg = 0;
+                auto r = skill.skillRange;
+                for (int i = 0; i < enemyCount; ++i) {
+                    auto *enemy = enemies[i];
+                    int ex = enemy->x, ey = enemy->y;
+                    int distance;
+                    if ((ex == x && (distance = std::abs(ey - y)) <= r)
+                        || (ey == y && (distance = std::abs(ex - x)) <= r)) {
+                        totalDmg += calc(enemy, distance, true);
+                    }
+                }
+                if (totalDmg > 0) {
+                    scores.emplace_back(Scorer::Score {totalDmg, x, y, x, y, j});
+                }
+                break;
+            }
+            case 3: {
+                if (c->ranges > skill.skillRange) { continue; }
+                int totalDmg = 0;
+                auto r = skill.area;
+                auto *n = c;
+                if (n->moves > 0) {
+                    n = n->moveParent;
+                } else {
+                    while (n->moves < 0) {
+                        n = n->rangeParent;
+                    }
+                }
+                std::int16_t mx = n->x, my = n->y;
+                for (int i = 0; i < enemyCount; ++i) {
+                    auto *enemy = enemies[i];
+                    int ex = enemy->x, ey = enemy->y;
+                    if (std::abs(ex - x) > r || std::abs(ey - y) > r) { continue; }
+                    int distance = std::abs(x - mx) + std::abs(y - my) + std::abs(x - ex) + std::abs(y - ey);
+                    totalDmg += calc(enemy, distance, true);
+                }
+                if (totalDmg > 0) {
+                    scores.emplace_back(Scorer::Score {totalDmg, mx, my, x, y, j});
+                }
+                break;
+            }
+            default: {
+                if (c->ranges > skill.skillRange) { continue; }
+                auto *enemy = cellUnit[y * w + x];
+                if (!enemy || enemy->side == ch.side) { continue; }
+                auto *n = c;
+                if (n->moves > 0) {
+                    n = n->moveParent;
+                } else {
+                    while (n->moves < 0) {
+                        n = n->rangeParent;
+                    }
+                }
+                std::int16_t mx = n->x, my = n->y;
+                scores.emplace_back(Scorer::Score {calc(enemy, std::abs(mx - x) + std::abs(my - y), false), mx, my, x, y, j});
+                break;
+            }
+            }
+        }
+    }
+}
+
+bool sameScores(const std::vector<Scorer::Score> &a, const std::vector<Scorer::Score> &b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const Scorer::Score &s0, const Scorer::Score &s1) {
+        return s0.score == s1.score && s0.fx == s1.fx && s0.fy == s1.fy && s0.tx == s1.tx && s0.ty == s1.ty
+            && s0.skillIndex == s1.skillIndex;
+    });
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <data folder> [iterations] [work per frame]\n", argv[0]);
+        return -1;
+    }
+    std::string path = argv[1];
+    if (!path.empty() && path.back() != '/' && path.back() != '\\') { path += '/'; }
+    int iterations = argc > 2 ? std::max(1, atoi(argv[2])) : 10;
+    int workPerFrame = argc > 3 ? atoi(argv[3]) : 8192;
+
+    std::vector<data::WarfieldInfo> infos;
+    util::File::getFileContent(path + "WAR.STA", infos);
+    std::vector<std::string> fields;
+    if (infos.empty() || !loadGrp(path + "WARFLD.IDX", path + "WARFLD.GRP", fields)) {
+        fprintf(stderr, "unable to load %sWAR.STA or %sWARFLD.IDX/GRP\n", path.c_str(), path.c_str());
+        return -1;
+    }
+
+    /* fixed seed, so runs are comparable */
+    std::uint32_t seed = 12345;
+    auto rnd = [&seed](int n) {
+        seed = seed * 1103515245u + 12345u;
+        return int((seed >> 16) % std::uint32_t(n));
+    };
+    std::vector<Layout> layouts;
+    for (auto &info: infos) {
+        if (info.warFieldId < 0 || size_t(info.warFieldId) >= fields.size()) { continue; }
+        data::WarfieldLayers layers = {};
+        const auto &field = fields[info.warFieldId];
+        memcpy(layers.layers, field.data(), std::min(sizeof(layers.layers), field.size()));
+        auto &l = layouts.emplace_back();
+        l.warId = info.id;
+        for (int i = 0; i < data::WarFieldWidth * data::WarFieldHeight; ++i) {
+            l.blocked[i] = data::isWarfieldCellBlocked(layers.layers[0][i] >> 1, layers.layers[1][i] >> 1);
+        }
+        auto addUnit = [&l, &rnd](int side, int x, int y) {
+            if (x < 0 || x >= data::WarFieldWidth || y < 0 || y >= data::WarFieldHeight) { return; }
+            for (auto &u: l.units) {
+                if (u.x == x && u.y == y) { return; }
+            }
+            int maxHp = 100 + rnd(400);
+            l.units.emplace_back(Unit {side, x, y, 100 + rnd(400), 10 + rnd(90), 50 + rnd(50), rnd(60), 1 + rnd(maxHp), maxHp});
+        };
+        for (size_t i = 0; i < data::TeamMemberCount; ++i) {
+            if (info.forceMembers[i] >= 0 || info.defaultMembers[i] >= 0) { addUnit(0, info.memberX[i], info.memberY[i]); }
+        }
+        for (size_t i = 0; i < data::WarFieldEnemyCount; ++i) {
+            if (info.enemy[i] >= 0) { addUnit(1, info.enemyX[i], info.enemyY[i]); }
+        }
+    }
+
+    int maxRange = 0;
+    for (auto &sk: gSkills) {
+        if (sk.rangeType == 0 || sk.rangeType == 3) { maxRange = std::max<int>(maxRange, sk.skillRange); }
+    }
+    const int steps = 6;
+    auto byScore = [](const Scorer::Score &v0, const Scorer::Score &v1) { return v0.score > v1.score; };
+    Area area;
+    Scorer scorer;
+    std::vector<Scorer::Score> oldScores;
+    std::vector<const Unit*> cellUnit(Area::MaxCells);
+    double total[2] = {0., 0.}, worst[2] = {0., 0.};
+    size_t turns = 0, mismatches = 0, maxFrames = 0, totalFrames = 0;
+    for (auto &l: layouts) {
+        std::fill(cellUnit.begin(), cellUnit.end(), nullptr);
+        for (auto &u: l.units) { cellUnit[u.y * data::WarFieldWidth + u.x] = &u; }
+        for (auto &ch: l.units) {
+            const Unit *enemies[Scorer::MaxEnemies];
+            int enemyCount = 0;
+            for (auto &u: l.units) {
+                if (u.side != ch.side && enemyCount < Scorer::MaxEnemies) { enemies[enemyCount++] = &u; }
+            }
+            auto flags = [&l, &cellUnit, &ch](int index) {
+                std::uint8_t f = l.blocked[index] ? Area::CellBlocked : 0;
+                if (cellUnit[index]) { f |= cellUnit[index]->side == ch.side ? Area::CellOccupied | Area::CellAlly : Area::CellOccupied; }
+                return f;
+            };
+            size_t frames = 0;
+            /* first round is a warm-up and is not timed */
+            for (int impl = 0; impl < 4; ++impl) {
+                double worstTurn = 0.;
+                auto start = std::chrono::steady_clock::now();
+                for (int it = 0; it < (impl < 2 ? 1 : iterations); ++it) {
+                    auto turnStart = std::chrono::steady_clock::now();
+                    area.calc(data::WarFieldWidth, data::WarFieldHeight, ch.x, ch.y, steps, maxRange, false, flags);
+                    if (impl & 1) {
+                        oldScoring(area, ch, enemies, enemyCount, cellUnit, oldScores);
+                        std::sort(oldScores.begin(), oldScores.end(), byScore);
+                    } else {
+                        scorer.reset(area, data::WarFieldWidth, data::WarFieldHeight);
+                        for (int i = 0; i < enemyCount; ++i) { scorer.addEnemy(enemies[i]->x, enemies[i]->y); }
+                        for (int j = 0; j < gSkillCount; ++j) {
+                            const auto &sk = gSkills[j];
+                            auto s = scorer.addSkill(Scorer::Skill {std::int16_t(j), sk.rangeType, sk.skillRange, sk.area});
+                            for (int i = 0; i < enemyCount; ++i) {
+                                const auto *enemy = enemies[i];
+                                for (int d = 0; d < Scorer::DistanceSteps; ++d) {
+                                    int dmg = predictDamage(ch.atk + sk.atkBonus, enemy->defence, ch.stamina, enemy->hurt, d);
+                                    if (dmg >= enemy->hp) {
+                                        dmg = sk.rangeType >= 1 && sk.rangeType <= 3 ? std::max<int>(dmg * 3 / 2, enemy->maxHp) : dmg * 3 / 2;
+                                    }
+                                    scorer.setDamage(s, i, d, dmg);
+                                }
+                            }
+                        }
+                        frames = 1;
+                        while (!scorer.run(workPerFrame)) { ++frames; }
+                        std::sort(scorer.scores().begin(), scorer.scores().end(), byScore);
+                    }
+                    auto turn = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - turnStart).count();
+                    worstTurn = std::max(worstTurn, turn);
+                }
+                if (impl < 2) {
+                    if (impl == 1 && !sameScores(scorer.scores(), oldScores)) {
+                        ++mismatches;
+                        fprintf(stderr, "mismatch: war %d, (%d,%d)\n", l.warId, ch.x, ch.y);
+                    }
+                    continue;
+                }
+                total[impl & 1] += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+                worst[impl & 1] = std::max(worst[impl & 1], worstTurn);
+            }
+            ++turns;
+            totalFrames += frames;
+            maxFrames = std::max(maxFrames, frames);
+        }
+    }
+    auto count = double(turns) * iterations;
+    fprintf(stdout, "%zu warfields, %zu turns, %d iterations, %d skills, %d steps\n", layouts.size(), turns, iterations, gSkillCount, steps);
+    fprintf(stdout, "scorer  avg %8.2f us  max %8.2f us  frames per turn: avg %.2f max %zu (work per frame %d)\n",
+            count > 0. ? total[0] / count : 0., worst[0], turns ? double(totalFrames) / turns : 0., maxFrames, workPerFrame);
+    fprintf(stdout, "old     avg %8.2f us  max %8.2f us\n", count > 0. ? total[1] / count : 0., worst[1]);
+    fprintf(stdout, "speedup x%.2f  %s\n", total[0] > 0. ? total[1] / total[0] : 0., mismatches ? "MISMATCH" : "ok");
+    return mismatches ? 1 : 0;
+}
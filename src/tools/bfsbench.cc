@@ -0,0 +1,284 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Micro-benchmark for warfield selectable area search.
+ * Runs the flat grid BFS (SelectableArea) and the old std::map + heap search from every char position
+ * of every warfield in WAR.STA/WARFLD, with several move/range settings, and checks both give same distances.
+ * Usage: bfsbench <data folder> [iterations] */
+
+#include "scene/selectablearea.hh"
+#include "data/warfielddata.hh"
+#include "util/file.hh"
+
+#include <chrono>
+#include <map>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace hojy;
+
+using Cell = scene::SelectableArea::Cell;
+
+bool loadGrp(const std::string &idx, const std::string &grp, std::vector<std::string> &dset) {
+    util::File ifs, ifs2;
+    ifs = util::File::open(idx);
+    ifs2 = util::File::open(grp);
+    if (!ifs || !ifs2) {
+        return false;
+    }
+    size_t count = ifs.size() / sizeof(std::uint32_t);
+    size_t fileSize = ifs2.size();
+    dset.resize(count);
+    std::uint32_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        std::uint32_t endoffset;
+        ifs.read(&endoffset, sizeof(endoffset));
+        if (endoffset == 0) {
+            endoffset = fileSize;
+        }
+        if (endoffset > offset) {
+            dset[i].resize(endoffset - offset);
+            ifs2.seek(offset);
+            ifs2.read(dset[i].data(), endoffset - offset);
+            offset = endoffset;
+        }
+    }
+    return true;
+}
+
+struct Layout {
+    std::int16_t warId;
+    std::uint8_t flags[2][data::WarFieldWidth * data::WarFieldHeight];
+    std::vector<std::pair<int, int>> chars[2];
+};
+
+/* the search used before SelectableArea, kept as reference */
+void oldSelectableArea(const std::uint8_t *flags, int x, int y, int steps, int ranges, bool zoecheck,
+                       std::map<std::pair<int, int>, Cell> &selCells) {
+    struct CompareSelCells {
+        bool operator()(const Cell *a, const Cell *b) {
+            return a->moves > b->moves;
+        }
+    };
+    struct CompareRangeCells {
+        bool operator()(const Cell *a, const Cell *b) {
+            return a->ranges > b->ranges;
+        }
+    };
+    const int w = data::WarFieldWidth, h = data::WarFieldHeight;
+    static const int dirMove[4][2] = {{0, -1}, {1, 0}, {-1, 0}, {0, 1}};
+    static const int dirRange[4][2] = {{-1, 0}, {0, -1}, {1, 0}, {0, 1}};
+    std::vector<Cell*> sorted;
+
+    selCells.clear();
+    auto &start = selCells[std::make_pair(x, y)];
+    start = Cell {x, y, 0, 0, nullptr, nullptr};
+    if (steps > 0) {
+        sorted.push_back(&start);
+    }
+    while (!sorted.empty()) {
+        std::pop_heap(sorted.begin(), sorted.end(), CompareSelCells());
+        auto *mc = sorted.back();
+        sorted.pop_back();
+        int nx[4], ny[4], ncnt = 0;
+        bool zoeblocked = false;
+        for (auto &d: dirMove) {
+            int tx = mc->x + d[0], ty = mc->y + d[1];
+            if (tx < 0 || tx >= w || ty < 0 || ty >= h) { continue; }
+            if (zoecheck && (flags[ty * w + tx] & scene::SelectableArea::CellAlly)) {
+                zoeblocked = true;
+                break;
+            }
+            nx[ncnt] = tx;
+            ny[ncnt++] = ty;
+        }
+        if (zoeblocked) { continue; }
+        for (int i = 0; i < ncnt; ++i) {
+            int tx = nx[i], ty = ny[i];
+            if (flags[ty * w + tx] & (scene::SelectableArea::CellBlocked | scene::SelectableArea::CellOccupied)) { continue; }
+            auto currMove = mc->moves + 1;
+            if (selCells.find(std::make_pair(tx, ty)) == selCells.end()) {
+                auto &mcell = selCells[std::make_pair(tx, ty)];
+                mcell = Cell {tx, ty, currMove, 0, mc, nullptr};
+                if (currMove < steps) {
+                    sorted.push_back(&mcell);
+                    std::push_heap(sorted.begin(), sorted.end(), CompareSelCells());
+                }
+            }
+        }
+    }
+    if (!ranges) { return; }
+    for (auto &p: selCells) {
+        sorted.push_back(&p.second);
+    }
+    std::make_heap(sorted.begin(), sorted.end(), CompareRangeCells());
+    while (!sorted.empty()) {
+        std::pop_heap(sorted.begin(), sorted.end(), CompareRangeCells());
+        auto *mc = sorted.back();
+        sorted.pop_back();
+        for (auto &d: dirRange) {
+            int tx = mc->x + d[0], ty = mc->y + d[1];
+            if (tx < 0 || tx >= w || ty < 0 || ty >= h) { continue; }
+            if (flags[ty * w + tx] & scene::SelectableArea::CellBlocked) { continue; }
+            auto currRange = mc->ranges + 1;
+            if (selCells.find(std::make_pair(tx, ty)) == selCells.end()) {
+                auto &mcell = selCells[std::make_pair(tx, ty)];
+                mcell = Cell {tx, ty, -1, currRange, nullptr, mc};
+                if (currRange < ranges) {
+                    sorted.push_back(&mcell);
+                    std::push_heap(sorted.begin(), sorted.end(), CompareRangeCells());
+                }
+            }
+        }
+    }
+}
+
+/* same distances, same iteration order, and parents are valid neighbours one step closer */
+bool compare(const scene::SelectableArea &area, const std::map<std::pair<int, int>, Cell> &selCells) {
+    if (area.size() != selCells.size()) { return false; }
+    auto ite = selCells.begin();
+    for (auto *c: area) {
+        const auto &o = ite->second;
+        if (c->x != o.x || c->y != o.y || c->moves != o.moves || c->ranges != o.ranges) { return false; }
+        const auto *p = c->moves > 0 ? c->moveParent : c->moves < 0 ? c->rangeParent : nullptr;
+        if (p) {
+            if (std::abs(p->x - c->x) + std::abs(p->y - c->y) != 1) { return false; }
+            if (c->moves > 0 ? p->moves != c->moves - 1 : p->ranges != c->ranges - 1) { return false; }
+        }
+        ++ite;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <data folder> [iterations]\n", argv[0]);
+        return -1;
+    }
+    std::string path = argv[1];
+    if (!path.empty() && path.back() != '/' && path.back() != '\\') { path += '/'; }
+    int iterations = argc > 2 ? std::max(1, atoi(argv[2])) : 20;
+
+    std::vector<data::WarfieldInfo> infos;
+    util::File::getFileContent(path + "WAR.STA", infos);
+    std::vector<std::string> fields;
+    if (infos.empty() || !loadGrp(path + "WARFLD.IDX", path + "WARFLD.GRP", fields)) {
+        fprintf(stderr, "unable to load %sWAR.STA or %sWARFLD.IDX/GRP\n", path.c_str(), path.c_str());
+        return -1;
+    }
+
+    std::vector<Layout> layouts;
+    for (auto &info: infos) {
+        if (info.warFieldId < 0 || size_t(info.warFieldId) >= fields.size()) { continue; }
+        data::WarfieldLayers layers = {};
+        const auto &field = fields[info.warFieldId];
+        memcpy(layers.layers, field.data(), std::min(sizeof(layers.layers), field.size()));
+        auto &l = layouts.emplace_back();
+        l.warId = info.id;
+        std::uint8_t base[data::WarFieldWidth * data::WarFieldHeight];
+        for (int i = 0; i < data::WarFieldWidth * data::WarFieldHeight; ++i) {
+            bool blocked = data::isWarfieldCellBlocked(layers.layers[0][i] >> 1, layers.layers[1][i] >> 1);
+            base[i] = blocked ? scene::SelectableArea::CellBlocked : 0;
+        }
+        auto addChar = [&l](int side, int x, int y) {
+            if (x < 0 || x >= data::WarFieldWidth || y < 0 || y >= data::WarFieldHeight) { return; }
+            l.chars[side].emplace_back(x, y);
+        };
+        for (size_t i = 0; i < data::TeamMemberCount; ++i) {
+            if (info.forceMembers[i] >= 0 || info.defaultMembers[i] >= 0) { addChar(0, info.memberX[i], info.memberY[i]); }
+        }
+        for (size_t i = 0; i < data::WarFieldEnemyCount; ++i) {
+            if (info.enemy[i] >= 0) { addChar(1, info.enemyX[i], info.enemyY[i]); }
+        }
+        for (int side = 0; side < 2; ++side) {
+            memcpy(l.flags[side], base, sizeof(base));
+            for (int s = 0; s < 2; ++s) {
+                for (auto &p: l.chars[s]) {
+                    l.flags[side][p.second * data::WarFieldWidth + p.first] |= scene::SelectableArea::CellOccupied
+                        | (s == side ? scene::SelectableArea::CellAlly : 0);
+                }
+            }
+        }
+    }
+
+    struct Setting {
+        const char *name;
+        int steps, ranges;
+        bool zoecheck;
+    };
+    static const Setting settings[] = {
+        {"move", 6, 0, false},
+        {"move+zoe", 6, 0, true},
+        {"move+range", 6, 8, false},
+        {"long move+range", 15, 13, false},
+    };
+    fprintf(stdout, "%zu warfields, %d iterations\n", layouts.size(), iterations);
+    scene::SelectableArea area;
+    std::map<std::pair<int, int>, Cell> selCells;
+    for (auto &setting: settings) {
+        size_t searches = 0, cells = 0, mismatches = 0;
+        for (auto &l: layouts) {
+            for (int side = 0; side < 2; ++side) {
+                for (auto &p: l.chars[side]) {
+                    const auto *flags = l.flags[side];
+                    area.calc(data::WarFieldWidth, data::WarFieldHeight, p.first, p.second, setting.steps, setting.ranges,
+                              setting.zoecheck, [flags](int index) { return flags[index]; });
+                    oldSelectableArea(flags, p.first, p.second, setting.steps, setting.ranges, setting.zoecheck, selCells);
+                    if (!compare(area, selCells)) {
+                        ++mismatches;
+                        fprintf(stderr, "mismatch: war %d, (%d,%d) %s\n", l.warId, p.first, p.second, setting.name);
+                    }
+                    ++searches;
+                    cells += area.size();
+                }
+            }
+        }
+        double ms[2];
+        for (int impl = 0; impl < 2; ++impl) {
+            auto start = std::chrono::steady_clock::now();
+            for (int it = 0; it < iterations; ++it) {
+                for (auto &l: layouts) {
+                    for (int side = 0; side < 2; ++side) {
+                        for (auto &p: l.chars[side]) {
+                            const auto *flags = l.flags[side];
+                            if (impl) {
+                                oldSelectableArea(flags, p.first, p.second, setting.steps, setting.ranges, setting.zoecheck,
+                                                  selCells);
+                            } else {
+                                area.calc(data::WarFieldWidth, data::WarFieldHeight, p.first, p.second, setting.steps,
+                                          setting.ranges, setting.zoecheck, [flags](int index) { return flags[index]; });
+                            }
+                        }
+                    }
+                }
+            }
+            ms[impl] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        auto total = double(searches) * iterations;
+        fprintf(stdout, "%-16s %6zu searches %8.1f cells avg  grid %7.3f us  map %7.3f us  x%.2f  %s\n",
+                setting.name, searches, searches ? double(cells) / searches : 0.,
+                ms[0] * 1000. / total, ms[1] * 1000. / total, ms[0] > 0. ? ms[1] / ms[0] : 0.,
+                mismatches ? "MISMATCH" : "ok");
+    }
+    return 0;
+}
@@ -17,9 +17,27 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+/*
+ * usage:
+ *   mergepic <idx prefix> <grp prefix>
+ *       merge numbered GRP sets ({prefix}000 ... {prefix}999) into one
+ *   mergepic --pack <output> [--lz4] <data dir>...
+ *       pack GRP/IDX/COL files (and SDX/SMP/WDX/WMP sets) into one archive,
+ *       files in former dirs take precedence
+ */
+
 #include "util/file.hh"
+#include "util/archive.hh"
 
+#if defined(USE_LZ4)
+#include <lz4.h>
+#endif
+#include <algorithm>
+#include <filesystem>
+#include <map>
 #include <string>
+#include <cctype>
+#include <cstring>
 
 using namespace hojy;
 
@@ -66,8 +84,114 @@ bool saveGrp(const std::string &idx, const std::string &grp, const std::vector<s
     return true;
 }
 
+static bool isPackable(const std::string &name) {
+    auto pos = name.find('.');
+    auto base = name.substr(0, pos);
+    if (pos == std::string::npos) {
+        /* merged or numbered sub map/warfield sets */
+        if (base.size() != 3 && base.size() != 6) { return false; }
+        auto prefix = base.substr(0, 3);
+        if (prefix != "SDX" && prefix != "SMP" && prefix != "WDX" && prefix != "WMP") { return false; }
+        return std::all_of(base.begin() + 3, base.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; });
+    }
+    auto ext = name.substr(pos + 1);
+    if (ext == "COL") { return true; }
+    if (ext != "GRP" && ext != "IDX") { return false; }
+    /* save slots are written by game */
+    return !(base.size() == 2 && (base[0] == 'R' || base[0] == 'S' || base[0] == 'D') && std::isdigit(static_cast<unsigned char>(base[1])));
+}
+
+static int pack(const std::string &output, const std::vector<std::string> &dirs, bool compress) {
+    /* archive name -> file path */
+    std::map<std::string, std::string> files;
+    for (auto &dir: dirs) {
+        std::error_code ec;
+        for (auto &p: std::filesystem::directory_iterator(dir, ec)) {
+            if (!p.is_regular_file()) { continue; }
+            auto name = util::Archive::normalizeName(p.path().filename().string());
+            if (!isPackable(name) || files.find(name) != files.end()) { continue; }
+            if (name.size() >= sizeof(util::ArchiveEntry::name)) {
+                fprintf(stderr, "name too long, skipped: %s\n", name.c_str());
+                continue;
+            }
+            files[name] = p.path().string();
+        }
+    }
+    if (files.empty()) {
+        fprintf(stderr, "no files to pack\n");
+        return -1;
+    }
+    auto ofs = util::File::create(output);
+    if (!ofs) {
+        fprintf(stderr, "unable to write %s\n", output.c_str());
+        return -1;
+    }
+    util::ArchiveHeader header {};
+    memcpy(header.magic, util::ArchiveMagic, sizeof(header.magic));
+    header.version = util::ArchiveVersion;
+    header.count = std::uint32_t(files.size());
+    std::vector<util::ArchiveEntry> entries(files.size());
+    ofs.write(&header, sizeof(header));
+    ofs.write(entries.data(), entries.size() * sizeof(util::ArchiveEntry));
+    std::uint64_t offset = sizeof(header) + entries.size() * sizeof(util::ArchiveEntry);
+    std::uint64_t rawTotal = 0;
+    size_t index = 0;
+    for (auto &p: files) {
+        auto content = util::File::getFileContent(p.second);
+        auto &entry = entries[index++];
+        strncpy(entry.name, p.first.c_str(), sizeof(entry.name) - 1);
+        entry.rawSize = std::uint32_t(content.size());
+        rawTotal += content.size();
+#if defined(USE_LZ4)
+        if (compress && !content.empty()) {
+            std::string compressed(LZ4_compressBound(int(content.size())), '\0');
+            auto sz = LZ4_compress_default(content.data(), compressed.data(), int(content.size()), int(compressed.size()));
+            /* keep entries stored as is if compression does not help much, they can be used from mapping directly */
+            if (sz > 0 && size_t(sz) < content.size() * 7 / 8) {
+                compressed.resize(sz);
+                content = std::move(compressed);
+                entry.flags |= util::ArchiveEntry::FlagLZ4;
+            }
+        }
+#else
+        (void)compress;
+#endif
+        auto aligned = (offset + util::ArchiveAlign - 1) / util::ArchiveAlign * util::ArchiveAlign;
+        if (aligned > offset) {
+            static const char padding[util::ArchiveAlign] = {};
+            ofs.write(padding, aligned - offset);
+        }
+        entry.offset = aligned;
+        entry.size = std::uint32_t(content.size());
+        ofs.write(content.data(), content.size());
+        offset = aligned + content.size();
+    }
+    ofs.seek(sizeof(header));
+    ofs.write(entries.data(), entries.size() * sizeof(util::ArchiveEntry));
+    fprintf(stdout, "packed %zu files, %.1fKB -> %.1fKB\n", files.size(), double(rawTotal) / 1024., double(offset) / 1024.);
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     if (argc < 3) { return -1; }
+    if (strcmp(argv[1], "--pack") == 0) {
+        std::string output = argv[2];
+        bool compress = false;
+        std::vector<std::string> dirs;
+        for (int i = 3; i < argc; ++i) {
+            if (strcmp(argv[i], "--lz4") == 0) {
+#if defined(USE_LZ4)
+                compress = true;
+#else
+                fprintf(stderr, "built without USE_LZ4, entries are stored uncompressed\n");
+#endif
+                continue;
+            }
+            dirs.emplace_back(argv[i]);
+        }
+        if (dirs.empty()) { return -1; }
+        return pack(output, dirs, compress);
+    }
     std::vector<std::string> merged;
     for (int i = 0; i < 1000; ++i) {
         char idx[256], grp[256];
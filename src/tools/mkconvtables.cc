@@ -0,0 +1,189 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/* Generates util/convtables.inl from util/big5table.inl, util/tschars.inl and util/tswords.inl:
+ * Unicode->BIG5 table sorted for binary search, and phrases of tswords.inl as a double-array trie.
+ * It also checks that big5table.inl and tschars.inl are sorted, as they are searched in place.
+ * Usage: mkconvtables [output file] */
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+
+struct Pair {
+    std::uint32_t from;
+    std::uint32_t to;
+};
+
+static const Pair big5Table[] =
+#include "util/big5table.inl"
+
+static const Pair tsCharTable[] = {
+#include "util/tschars.inl"
+};
+
+static const std::vector<std::pair<std::vector<std::uint32_t>, std::vector<std::uint32_t>>> tsWordTable = {
+#include "util/tswords.inl"
+};
+
+struct Node {
+    std::map<std::uint32_t, size_t> children;
+    int output = -1;
+};
+
+template<size_t N>
+static bool checkSorted(const Pair (&table)[N], const char *name) {
+    for (size_t i = 1; i < N; ++i) {
+        if (table[i - 1].from >= table[i].from) {
+            fprintf(stderr, "%s is not sorted or has duplicated key at 0x%X\n", name, table[i].from);
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+static void writeArray(FILE *f, const char *type, const char *name, const std::vector<T> &arr, bool hex) {
+    fprintf(f, "static constexpr %s %s[] = {", type, name);
+    for (size_t i = 0; i < arr.size(); ++i) {
+        fprintf(f, i % 12 ? " " : "\n    ");
+        fprintf(f, hex ? "0x%X," : "%d,", int(arr[i]));
+    }
+    fprintf(f, "\n};\n");
+}
+
+int main(int argc, char *argv[]) {
+    if (!checkSorted(big5Table, "big5table.inl") || !checkSorted(tsCharTable, "tschars.inl")) {
+        return -1;
+    }
+
+    std::vector<Pair> big5Rev;
+    for (const auto &p: big5Table) {
+        big5Rev.push_back({p.to, p.from});
+    }
+    std::sort(big5Rev.begin(), big5Rev.end(), [](const Pair &a, const Pair &b) {
+        return a.from == b.from ? a.to < b.to : a.from < b.from;
+    });
+
+    /* chars in phrases are mapped to codes 1..N so trie arrays stay small */
+    std::vector<std::uint32_t> alphabet;
+    for (const auto &p: tsWordTable) {
+        alphabet.insert(alphabet.end(), p.first.begin(), p.first.end());
+        if (p.first.size() != p.second.size()) {
+            fprintf(stderr, "phrase length mismatch at 0x%X\n", p.first[0]);
+            return -1;
+        }
+    }
+    std::sort(alphabet.begin(), alphabet.end());
+    alphabet.erase(std::unique(alphabet.begin(), alphabet.end()), alphabet.end());
+    auto charCode = [&alphabet](std::uint32_t ch) {
+        return std::uint32_t(std::lower_bound(alphabet.begin(), alphabet.end(), ch) - alphabet.begin()) + 1;
+    };
+
+    std::vector<Node> nodes(1);
+    std::vector<std::uint32_t> output;
+    for (const auto &p: tsWordTable) {
+        size_t n = 0;
+        for (auto ch: p.first) {
+            auto code = charCode(ch);
+            auto ite = nodes[n].children.find(code);
+            if (ite == nodes[n].children.end()) {
+                nodes[n].children[code] = nodes.size();
+                n = nodes.size();
+                nodes.emplace_back();
+            } else {
+                n = ite->second;
+            }
+        }
+        nodes[n].output = int(output.size());
+        output.insert(output.end(), p.second.begin(), p.second.end());
+    }
+
+    /* place states breadth-first, each at the lowest base leaving room for all its children */
+    enum : std::uint16_t { Unused = 0xFFFF };
+    std::vector<std::uint16_t> base(1, 0), check(1, Unused), value(1, 0);
+    std::vector<size_t> stateOf(nodes.size());
+    std::deque<size_t> queue {0};
+    stateOf[0] = 0;
+    while (!queue.empty()) {
+        auto n = queue.front();
+        queue.pop_front();
+        auto &node = nodes[n];
+        auto s = stateOf[n];
+        if (node.children.empty()) { continue; }
+        size_t b = 0;
+        for (;; ++b) {
+            bool ok = true;
+            for (auto &c: node.children) {
+                auto t = b + c.first;
+                if (t < check.size() && (check[t] != Unused || t == 0)) { ok = false; break; }
+            }
+            if (ok) { break; }
+        }
+        base[s] = std::uint16_t(b);
+        for (auto &c: node.children) {
+            auto t = b + c.first;
+            if (t >= check.size()) {
+                base.resize(t + 1, 0);
+                check.resize(t + 1, Unused);
+                value.resize(t + 1, 0);
+            }
+            check[t] = std::uint16_t(s);
+            auto &child = nodes[c.second];
+            value[t] = std::uint16_t(child.output + 1);
+            stateOf[c.second] = t;
+            queue.push_back(c.second);
+        }
+    }
+    if (check.size() >= Unused || output.size() >= Unused) {
+        fprintf(stderr, "trie is too large for 16-bit states\n");
+        return -1;
+    }
+
+    const char *filename = argc > 1 ? argv[1] : "convtables.inl";
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        fprintf(stderr, "Unable to write to %s\n", filename);
+        return -1;
+    }
+    fprintf(f, "/* Generated by tools/mkconvtables.cc from big5table.inl and tswords.inl, do not edit */\n\n");
+    fprintf(f, "static constexpr Conv::Pair big5RevTable[] = {");
+    for (size_t i = 0; i < big5Rev.size(); ++i) {
+        fprintf(f, i % 6 ? " " : "\n    ");
+        fprintf(f, "{0x%04X, 0x%04X},", big5Rev[i].from, big5Rev[i].to);
+    }
+    fprintf(f, "\n};\n\n");
+    fprintf(f, "/* double-array trie of phrases, a char is mapped to its index in tsWordAlphabet + 1, state `s` goes\n"
+               " * to state `t = tsWordBase[s] + code` if tsWordCheck[t] == s, tsWordValue[t] is offset in tsWordOutput + 1\n"
+               " * if a phrase ends at state t, simplified phrase has the same length as traditional one */\n");
+    writeArray(f, "std::uint32_t", "tsWordAlphabet", alphabet, true);
+    writeArray(f, "std::uint16_t", "tsWordBase", base, false);
+    writeArray(f, "std::uint16_t", "tsWordCheck", check, false);
+    writeArray(f, "std::uint16_t", "tsWordValue", value, false);
+    writeArray(f, "std::uint32_t", "tsWordOutput", output, true);
+    fclose(f);
+    fprintf(stdout, "%zu BIG5 chars, %zu phrases in %zu trie states\n", big5Rev.size(), tsWordTable.size(), check.size());
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/* Stress test for util::RingBuffer.
+ * A producer thread writes numbered units with reserve()/commit() and push() in random-sized chunks,
+ * while the consumer pops random-sized chunks with a stride larger than unit size (as the mixer does),
+ * checks every unit arrives once and in order, and that the buffer never holds more than its capacity.
+ * Exits with non-zero code on any error.
+ * Usage: ringstress [units] [capacity] */
+
+#include "util/ringbuffer.hh"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+using namespace hojy;
+
+struct Unit {
+    std::uint32_t seq;
+    std::uint32_t check;
+};
+
+static inline std::uint32_t checkOf(std::uint32_t seq) {
+    return seq * 2654435761u ^ 0x5A5A5A5Au;
+}
+
+int main(int argc, char *argv[]) {
+    std::uint32_t total = argc > 1 ? std::uint32_t(std::max(1, atoi(argv[1]))) : 10000000u;
+    size_t capacity = argc > 2 ? size_t(std::max(1, atoi(argv[2]))) : 1000;
+
+    util::RingBuffer ring;
+    ring.init(sizeof(Unit), capacity);
+    capacity = ring.capacity();
+    std::atomic<bool> failed {false};
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        std::mt19937 rng(1);
+        std::vector<Unit> chunk(capacity);
+        std::uint32_t seq = 0;
+        while (seq < total && !failed) {
+            size_t want = std::min<size_t>(total - seq, rng() % capacity + 1);
+            if (rng() & 1) {
+                auto count = want;
+                auto *dst = static_cast<Unit*>(ring.reserve(count));
+                if (count > want) {
+                    fprintf(stderr, "reserve() returned %zu units for %zu requested\n", count, want);
+                    failed = true;
+                    break;
+                }
+                for (size_t i = 0; i < count; ++i, ++seq) {
+                    dst[i] = {seq, checkOf(seq)};
+                }
+                ring.commit(count);
+                if (!count) { std::this_thread::yield(); }
+            } else {
+                for (size_t i = 0; i < want; ++i) {
+                    chunk[i] = {seq + std::uint32_t(i), checkOf(seq + std::uint32_t(i))};
+                }
+                auto count = ring.push(chunk.data(), want);
+                seq += std::uint32_t(count);
+                if (!count) { std::this_thread::yield(); }
+            }
+            auto sz = ring.size();
+            if (sz > capacity) {
+                fprintf(stderr, "buffer holds %zu units, capacity is %zu\n", sz, capacity);
+                failed = true;
+            }
+        }
+    });
+
+    std::mt19937 rng(2);
+    /* strided output: each unit followed by a guard word which must stay untouched */
+    constexpr size_t Space = sizeof(Unit) + sizeof(std::uint32_t);
+    constexpr std::uint32_t Guard = 0xDEADBEEFu;
+    std::vector<std::uint8_t> out(capacity * Space);
+    std::uint32_t expected = 0;
+    while (expected < total && !failed) {
+        size_t want = rng() % capacity + 1;
+        for (size_t i = 0; i < want; ++i) {
+            *reinterpret_cast<std::uint32_t*>(&out[i * Space + sizeof(Unit)]) = Guard;
+        }
+        auto got = ring.pop(out.data(), want, Space);
+        if (got > want) {
+            fprintf(stderr, "pop() returned %zu units for %zu requested\n", got, want);
+            failed = true;
+            break;
+        }
+        for (size_t i = 0; i < got; ++i, ++expected) {
+            const auto *u = reinterpret_cast<const Unit*>(&out[i * Space]);
+            if (u->seq != expected || u->check != checkOf(u->seq)) {
+                fprintf(stderr, "unit %u is corrupted, got seq %u\n", expected, u->seq);
+                failed = true;
+                break;
+            }
+            if (*reinterpret_cast<const std::uint32_t*>(&out[i * Space + sizeof(Unit)]) != Guard) {
+                fprintf(stderr, "stride gap after unit %u is overwritten\n", expected);
+                failed = true;
+                break;
+            }
+        }
+        if (!got) { std::this_thread::yield(); }
+    }
+    producer.join();
+    if (!failed && ring.size() != 0) {
+        fprintf(stderr, "%zu units left in buffer after all units are read\n", ring.size());
+        failed = true;
+    }
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (failed) {
+        fprintf(stderr, "FAILED\n");
+        return 1;
+    }
+    printf("%u units through capacity %zu in %.2fms, OK\n", total, capacity, elapsed);
+    return 0;
+}
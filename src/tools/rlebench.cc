@@ -0,0 +1,187 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Micro-benchmark for RLE sprite blitters.
+ * Replays MMAP and SMP sprites in isometric frame-sized grids (same layout as map rendering)
+ * with every blitter supported by the cpu, both from RLE streams and from SpriteCache,
+ * and checks the output against the scalar one.
+ * Usage: rlebench <data folder> [frames] [width] [height] */
+
+#include "scene/blitter.hh"
+#include "scene/texture.hh"
+#include "scene/spritecache.hh"
+#include "util/file.hh"
+#include "util/bytes.hh"
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace hojy;
+
+bool loadGrp(const std::string &idx, const std::string &grp, std::vector<std::string> &dset) {
+    util::File ifs, ifs2;
+    ifs = util::File::open(idx);
+    ifs2 = util::File::open(grp);
+    if (!ifs || !ifs2) {
+        return false;
+    }
+    size_t count = ifs.size() / sizeof(std::uint32_t);
+    size_t fileSize = ifs2.size();
+    dset.resize(count);
+    std::uint32_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        std::uint32_t endoffset;
+        ifs.read(&endoffset, sizeof(endoffset));
+        if (endoffset == 0) {
+            endoffset = fileSize;
+        }
+        if (endoffset > offset) {
+            dset[i].resize(endoffset - offset);
+            ifs2.seek(offset);
+            ifs2.read(dset[i].data(), endoffset - offset);
+            offset = endoffset;
+        }
+    }
+    return true;
+}
+
+bool loadPalette(const std::string &filename, std::uint32_t *colors) {
+    auto ifs = util::File::open(filename);
+    if (!ifs) { return false; }
+    std::uint8_t c[4] = {0, 0, 0, 0xFF};
+    for (size_t i = 0; i < 256; ++i) {
+        ifs.read(c, 3);
+        for (int j = 0; j < 3; ++j) {
+            c[j] = std::uint8_t(std::uint32_t(c[j]) * 4);
+        }
+        std::swap(c[0], c[2]);
+        colors[i] = *reinterpret_cast<std::uint32_t*>(c);
+    }
+    colors[0] = 0;
+    return true;
+}
+
+struct Result {
+    double ms;
+    std::uint64_t checksum;
+};
+
+Result replay(const std::vector<std::string> &sprites, const scene::SpriteCache *cache, const std::uint32_t *colors,
+              bool blending, int frames, int width, int height) {
+    const auto *arr = sprites[0].data();
+    int cellDiffX = util::readLE16s(arr) / 2, cellDiffY = util::readLE16s(arr + 2) / 2;
+    if (cellDiffX <= 0 || cellDiffY <= 0) {
+        cellDiffX = 18;
+        cellDiffY = 9;
+    }
+    std::vector<std::uint32_t> pixels(width * height);
+    auto count = sprites.size();
+    std::uint64_t checksum = 0;
+    size_t index = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; ++f) {
+        memset(pixels.data(), 0, pixels.size() * sizeof(std::uint32_t));
+        for (int ty = -cellDiffY * 2, j = 0; ty < height + cellDiffY * 8; ty += cellDiffY, ++j) {
+            for (int tx = (j % 2) ? cellDiffX : 0; tx < width + cellDiffX * 2; tx += cellDiffX * 2) {
+                const auto *data = &sprites[index];
+                for (size_t n = count; data->size() <= 8 && n; --n) {
+                    if (++index >= count) { index = 0; }
+                    data = &sprites[index];
+                }
+                if (++index >= count) { index = 0; }
+                if (cache) {
+                    auto id = std::int32_t(data - sprites.data());
+                    if (blending) {
+                        cache->renderBlending(id, colors, pixels.data(), width, height, tx, ty);
+                    } else {
+                        cache->render(id, colors, pixels.data(), width, height, tx, ty);
+                    }
+                } else if (blending) {
+                    scene::Texture::renderRLEBlending(*data, colors, pixels.data(), width, height, tx, ty);
+                } else {
+                    scene::Texture::renderRLE(*data, colors, pixels.data(), width, height, tx, ty);
+                }
+            }
+        }
+        for (auto c: pixels) {
+            checksum = checksum * 31 + c;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return {std::chrono::duration<double, std::milli>(end - start).count() / frames, checksum};
+}
+
+void bench(const char *name, const std::vector<std::string> &sprites, const std::uint32_t *colors,
+           int frames, int width, int height) {
+    if (sprites.empty()) { return; }
+    std::uint32_t blendColors[256];
+    for (int i = 0; i < 256; ++i) {
+        blendColors[i] = (colors[i] & 0xFFFFFFu) | 0x80000000u;
+    }
+    scene::SpriteCache cache;
+    cache.load(name, std::vector<std::string_view>(sprites.begin(), sprites.end()));
+    Result base[2] = {};
+    for (int t = scene::Blitter::Scalar; t < scene::Blitter::TypeMax; ++t) {
+        const auto *blitter = scene::Blitter::get(scene::Blitter::Type(t));
+        if (!blitter) { continue; }
+        scene::Blitter::setCurrent(blitter);
+        for (int c = 0; c < 2; ++c) {
+            for (int b = 0; b < 2; ++b) {
+                auto res = replay(sprites, c ? &cache : nullptr, b ? blendColors : colors, b != 0, frames, width, height);
+                if (t == scene::Blitter::Scalar && c == 0) {
+                    base[b] = res;
+                }
+                fprintf(stdout, "%-5s %-6s %-5s %-5s %8.3f ms/frame  x%.2f  %s\n", name, blitter->name, c ? "spans" : "rle",
+                        b ? "blend" : "copy", res.ms, base[b].ms / res.ms, res.checksum == base[b].checksum ? "ok" : "MISMATCH");
+            }
+        }
+    }
+    scene::Blitter::setCurrent(nullptr);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <data folder> [frames] [width] [height]\n", argv[0]);
+        return -1;
+    }
+    std::string path = argv[1];
+    if (!path.empty() && path.back() != '/' && path.back() != '\\') { path += '/'; }
+    int frames = argc > 2 ? std::max(1, atoi(argv[2])) : 200;
+    int width = argc > 3 ? std::max(1, atoi(argv[3])) : 512;
+    int height = argc > 4 ? std::max(1, atoi(argv[4])) : 320;
+    std::uint32_t colors[256];
+    if (!loadPalette(path + "MMAP.COL", colors)) {
+        fprintf(stderr, "unable to load %sMMAP.COL\n", path.c_str());
+        return -1;
+    }
+    fprintf(stdout, "%d frames of %dx%d, best blitter: %s\n", frames, width, height, scene::Blitter::best()->name);
+    std::vector<std::string> sprites;
+    if (loadGrp(path + "MMAP.IDX", path + "MMAP.GRP", sprites)) {
+        bench("MMAP", sprites, colors, frames, width, height);
+    }
+    if (loadGrp(path + "SDX", path + "SMP", sprites) || loadGrp(path + "SDX000", path + "SMP000", sprites)) {
+        bench("SMP", sprites, colors, frames, width, height);
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "archive.hh"
+
+#if defined(USE_LZ4)
+#include <lz4.h>
+#endif
+#include <fmt/format.h>
+#include <cstring>
+
+namespace hojy::util {
+
+bool Archive::open(const std::string &filename) {
+    close();
+    auto file = MMapFile::open(filename);
+    if (!file || file.size() < sizeof(ArchiveHeader)) { return false; }
+    const auto *header = reinterpret_cast<const ArchiveHeader*>(file.data());
+    if (memcmp(header->magic, ArchiveMagic, sizeof(ArchiveMagic)) != 0 || header->version != ArchiveVersion
+        || sizeof(ArchiveHeader) + std::uint64_t(header->count) * sizeof(ArchiveEntry) > file.size()) {
+        fmt::print(stderr, "{}: not a valid archive\n", filename);
+        return false;
+    }
+    const auto *entries = reinterpret_cast<const ArchiveEntry*>(header + 1);
+    index_.reserve(header->count);
+    for (std::uint32_t i = 0; i < header->count; ++i) {
+        const auto &entry = entries[i];
+        if (entry.offset + entry.size > file.size()) {
+            fmt::print(stderr, "{}: entry out of range, skipped\n", filename);
+            continue;
+        }
+        index_[std::string(entry.name, strnlen(entry.name, sizeof(entry.name)))] = &entry;
+    }
+    file_ = std::move(file);
+    return true;
+}
+
+void Archive::close() {
+    index_.clear();
+    file_ = MMapFile();
+}
+
+bool Archive::contains(const std::string &name) const {
+    return index_.find(normalizeName(name)) != index_.end();
+}
+
+Archive::Data Archive::get(const std::string &name) const {
+    auto ite = index_.find(normalizeName(name));
+    if (ite == index_.end()) { return {}; }
+    const auto *entry = ite->second;
+    std::string_view stored(file_.data() + entry->offset, entry->size);
+    if (!(entry->flags & ArchiveEntry::FlagLZ4)) {
+        return {stored, nullptr};
+    }
+#if defined(USE_LZ4)
+    auto copy = std::make_shared<std::string>(entry->rawSize, '\0');
+    if (LZ4_decompress_safe(stored.data(), copy->data(), int(stored.size()), int(copy->size())) != int(entry->rawSize)) {
+        fmt::print(stderr, "{}: corrupted compressed entry\n", name);
+        return {};
+    }
+    return {std::string_view(*copy), std::move(copy)};
+#else
+    fmt::print(stderr, "{}: compressed entry needs USE_LZ4 to be enabled\n", name);
+    return {};
+#endif
+}
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "mmapfile.hh"
+
+#include <unordered_map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <cctype>
+#include <cstdint>
+
+namespace hojy::util {
+
+/* Packed data archive, written by `mergepic --pack`:
+ *   ArchiveHeader, ArchiveEntry[count] sorted by name, then entry data aligned to ArchiveAlign bytes.
+ * Names are stored in upper case, all integers are little-endian */
+struct ArchiveHeader {
+    char magic[4];
+    std::uint32_t version;
+    std::uint32_t count;
+    std::uint32_t reserved;
+};
+
+struct ArchiveEntry {
+    enum : std::uint32_t {
+        FlagLZ4 = 1U,
+    };
+    char name[32];
+    std::uint64_t offset;
+    /* stored size, and original size if compressed */
+    std::uint32_t size, rawSize;
+    std::uint32_t flags, reserved;
+};
+
+constexpr char ArchiveMagic[4] = {'H', 'J', 'P', 'K'};
+constexpr std::uint32_t ArchiveVersion = 1;
+constexpr std::uint32_t ArchiveAlign = 16;
+
+class Archive final {
+public:
+    struct Data {
+        std::string_view view;
+        /* holds decompressed copy of compressed entries, view points into mapped archive otherwise */
+        std::shared_ptr<const std::string> copy;
+
+        explicit operator bool() const { return view.data() != nullptr; }
+    };
+
+public:
+    bool open(const std::string &filename);
+    void close();
+
+    [[nodiscard]] bool contains(const std::string &name) const;
+    /* returns empty Data if the entry does not exist or fails to decompress */
+    [[nodiscard]] Data get(const std::string &name) const;
+
+    [[nodiscard]] inline size_t size() const { return index_.size(); }
+    explicit operator bool() const { return bool(file_); }
+
+    static std::string normalizeName(std::string_view name) {
+        std::string res(name);
+        for (auto &c: res) {
+            c = char(std::toupper(static_cast<unsigned char>(c)));
+        }
+        return res;
+    }
+
+private:
+    MMapFile file_;
+    std::unordered_map<std::string, const ArchiveEntry*> index_;
+};
+
+}
@@ -0,0 +1,37 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace hojy::util {
+
+/* GRP entries are packed back to back, so fields can sit at odd offsets;
+ * read them bytewise instead of casting the pointer */
+inline std::uint16_t readLE16(const void *p) {
+    const auto *b = static_cast<const std::uint8_t*>(p);
+    return std::uint16_t(b[0] | (b[1] << 8));
+}
+
+inline std::int16_t readLE16s(const void *p) {
+    return std::int16_t(readLE16(p));
+}
+
+}
@@ -23,22 +23,29 @@
 
 namespace hojy::util {
 
+/* tables are sorted(or generated as sorted) data, so they need no work on startup */
+static constexpr Conv::Pair big5Table[] =
+#include "big5table.inl"
+
+static constexpr Conv::Pair tsCharTable[] = {
+#include "tschars.inl"
+};
+
+#include "convtables.inl"
+
 Big5Conv big5Conv;
 Trad2SimpConv trad2SimpConv;
 
 struct PairCompare {
-    bool operator()(const Conv::Pair &a1, const Conv::Pair &a2) {
-        return a1.from == a2.from ? a1.to < a2.to : a1.from < a2.from;
-    }
-    bool operator()(std::uint32_t a1, const Conv::Pair &a2) {
+    bool operator()(std::uint32_t a1, const Conv::Pair &a2) const {
         return a1 == a2.from ? 0 < a2.to : a1 < a2.from;
     }
-    bool operator()(const Conv::Pair &a1, std::uint32_t a2) {
+    bool operator()(const Conv::Pair &a1, std::uint32_t a2) const {
         return a1.from == a2 ? a1.to < 0 : a1.from < a2;
     }
 };
 
-std::wstring Conv::toUnicode(std::string_view str) {
+std::wstring Conv::toUnicode(std::string_view str) const {
     size_t len = str.length();
     const char *cstr = str.data();
     const char *cstrEnd = cstr + len;
@@ -67,7 +74,7 @@ std::wstring Conv::toUnicode(std::string_view str) {
     return result;
 }
 
-std::string Conv::fromUnicode(std::wstring_view wstr) {
+std::string Conv::fromUnicode(std::wstring_view wstr) const {
     size_t len = wstr.length();
     const wchar_t *cstr = wstr.data();
     const wchar_t *cstrEnd = cstr + len;
@@ -92,22 +99,11 @@ std::string Conv::fromUnicode(std::wstring_view wstr) {
     return result;
 }
 
-void Conv::postInit() {
-    tableRev_ = new Pair[size_];
-    for (size_t i = 0; i < size_; ++i) {
-        auto &p = table_[i];
-        tableRev_[i] = { p.to, p.from };
-    }
-    std::sort(table_, table_ + size_, PairCompare());
-    std::sort(tableRev_, tableRev_ + size_, PairCompare());
-}
-
 Big5Conv::Big5Conv() noexcept {
-    static Pair table[] =
-#include "big5table.inl"
-    table_ = table;
-    size_ = sizeof(table) / sizeof(Pair);
-    postInit();
+    table_ = big5Table;
+    tableRev_ = big5RevTable;
+    size_ = sizeof(big5Table) / sizeof(Pair);
+    static_assert(sizeof(big5Table) == sizeof(big5RevTable));
 }
 
 std::wstring Utf8Conv::toUnicode(std::string_view str) {
@@ -204,53 +200,46 @@ std::string Utf8Conv::fromUnicode(std::wstring_view wstr) {
     return res;
 }
 
-Trad2SimpConv::Trad2SimpConv() noexcept {
-    charTable_ = {
-#include "tschars.inl"
-    };
-    std::vector<std::pair<std::vector<std::uint32_t>, std::vector<std::uint32_t>>> wordTable = {
-#include "tswords.inl"
-    };
-    for (auto &p: wordTable) {
-        auto *node = &root_;
-        for (auto c: p.first) {
-            node = &node->nodes[c];
-        }
-        node->word = std::move(p.second);
-    }
-}
-
-std::wstring Trad2SimpConv::convert(const std::wstring &str) {
+std::wstring Trad2SimpConv::convert(const std::wstring &str) const {
+    constexpr auto trieSize = sizeof(tsWordCheck) / sizeof(tsWordCheck[0]);
+    constexpr auto *alphabetEnd = tsWordAlphabet + sizeof(tsWordAlphabet) / sizeof(tsWordAlphabet[0]);
+    constexpr auto *charTableEnd = tsCharTable + sizeof(tsCharTable) / sizeof(tsCharTable[0]);
     std::wstring res;
     size_t sz = str.size();
     res.reserve(sz);
     for (size_t i = 0; i < sz;) {
-        {
-            auto *node = &root_;
-            size_t j = i;
-            bool notfound = false;
-            while (j < sz) {
-                auto c = str[j++];
-                auto ite = node->nodes.find(c);
-                if (ite == node->nodes.end()) {
-                    notfound = true;
-                    break;
-                }
-                node = &ite->second;
+        size_t matchLen = 0, matchOutput = 0;
+        std::uint32_t s = 0;
+        for (size_t j = i; j < sz; ++j) {
+            auto c = std::uint32_t(str[j]);
+            const auto *ite = std::lower_bound(tsWordAlphabet, alphabetEnd, c);
+            if (ite == alphabetEnd || *ite != c) { break; }
+            auto t = std::uint32_t(tsWordBase[s]) + std::uint32_t(ite - tsWordAlphabet) + 1;
+            if (t >= trieSize || tsWordCheck[t] != s) { break; }
+            s = t;
+            if (tsWordValue[s]) {
+                matchLen = j + 1 - i;
+                matchOutput = tsWordValue[s] - 1;
             }
-            if (!notfound && !node->word.empty()) {
-                res.insert(res.end(), node->word.begin(), node->word.end());
-                i = j;
-                continue;
+        }
+        if (matchLen) {
+            for (size_t k = 0; k < matchLen; ++k) {
+                res += wchar_t(tsWordOutput[matchOutput + k]);
             }
+            i += matchLen;
+            continue;
         }
-        auto c = str[i];
-        auto ite = charTable_.find(c);
-        if (ite == charTable_.end()) res += c;
-        else res += wchar_t(ite->second);
+        auto c = std::uint32_t(str[i]);
+        const auto *ite = std::lower_bound(tsCharTable, charTableEnd, c, PairCompare());
+        if (ite == charTableEnd || ite->from != c) res += str[i];
+        else res += wchar_t(ite->to);
         ++i;
     }
     return res;
 }
 
+std::wstring Trad2SimpConv::phraseChars() {
+    return std::wstring(std::begin(tsWordOutput), std::end(tsWordOutput));
+}
+
 }
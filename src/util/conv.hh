@@ -19,9 +19,6 @@
 
 #pragma once
 
-#include <vector>
-#include <map>
-#include <unordered_map>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -35,15 +32,12 @@ public:
         std::uint32_t from;
         std::uint32_t to;
     };
-    std::wstring toUnicode(std::string_view str);
-    std::string fromUnicode(std::wstring_view wstr);
-    virtual ~Conv() { delete[] tableRev_; }
+    std::wstring toUnicode(std::string_view str) const;
+    std::string fromUnicode(std::wstring_view wstr) const;
 
 protected:
-    void postInit();
-
-protected:
-    Pair *table_ = nullptr, *tableRev_ = nullptr;
+    /* both sorted by `from`, see tools/mkconvtables.cc */
+    const Pair *table_ = nullptr, *tableRev_ = nullptr;
     size_t size_ = 0;
 };
 
@@ -58,18 +52,12 @@ public:
     static std::string fromUnicode(std::wstring_view wstr);
 };
 
+/* converts longest phrases found in tswords.inl first, then single chars in tschars.inl */
 class Trad2SimpConv final {
-    struct CNode {
-        std::vector<std::uint32_t> word;
-        std::map<std::uint32_t, CNode> nodes;
-    };
 public:
-    Trad2SimpConv() noexcept;
-    std::wstring convert(const std::wstring &str);
-
-private:
-    std::unordered_map<std::uint32_t, std::uint32_t> charTable_;
-    CNode root_;
+    std::wstring convert(const std::wstring &str) const;
+    /* chars in simplified phrases, some of them are never output by single char conversion */
+    [[nodiscard]] static std::wstring phraseChars();
 };
 
 extern Big5Conv big5Conv;
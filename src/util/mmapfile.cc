@@ -0,0 +1,121 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "mmapfile.hh"
+
+#include <utility>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace hojy::util {
+
+MMapFile MMapFile::open(const std::string &filename) {
+    MMapFile file;
+#if defined(_WIN32)
+    HANDLE fh = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fh == INVALID_HANDLE_VALUE) { return file; }
+    LARGE_INTEGER sz;
+    if (!GetFileSizeEx(fh, &sz)) {
+        CloseHandle(fh);
+        return file;
+    }
+    if (sz.QuadPart > 0) {
+        HANDLE mh = CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        CloseHandle(fh);
+        if (!mh) { return file; }
+        auto *ptr = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+        if (!ptr) {
+            CloseHandle(mh);
+            return file;
+        }
+        file.mapping_ = mh;
+        file.data_ = static_cast<const char*>(ptr);
+        file.size_ = size_t(sz.QuadPart);
+    } else {
+        CloseHandle(fh);
+    }
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) { return file; }
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return file;
+    }
+    if (st.st_size > 0) {
+        auto *ptr = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (ptr == MAP_FAILED) { return file; }
+        file.data_ = static_cast<const char*>(ptr);
+        file.size_ = size_t(st.st_size);
+    } else {
+        ::close(fd);
+    }
+#endif
+    file.opened_ = true;
+    return file;
+}
+
+MMapFile::MMapFile(MMapFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MMapFile::~MMapFile() {
+    close();
+}
+
+MMapFile &MMapFile::operator=(MMapFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        opened_ = other.opened_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.opened_ = false;
+#if defined(_WIN32)
+        mapping_ = other.mapping_;
+        other.mapping_ = nullptr;
+#endif
+    }
+    return *this;
+}
+
+void MMapFile::close() {
+#if defined(_WIN32)
+    if (data_) { UnmapViewOfFile(data_); }
+    if (mapping_) { CloseHandle(mapping_); }
+    mapping_ = nullptr;
+#else
+    if (data_) { munmap(const_cast<char*>(data_), size_); }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    opened_ = false;
+}
+
+}
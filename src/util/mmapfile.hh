@@ -0,0 +1,57 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace hojy::util {
+
+/* Read-only memory mapping of a whole file */
+class MMapFile final {
+public:
+    [[nodiscard]] static MMapFile open(const std::string &filename);
+
+public:
+    MMapFile() = default;
+    MMapFile(const MMapFile &) = delete;
+    MMapFile(MMapFile &&other) noexcept;
+    ~MMapFile();
+    MMapFile &operator=(const MMapFile &) = delete;
+    MMapFile &operator=(MMapFile &&other) noexcept;
+
+    [[nodiscard]] const char *data() const { return data_; }
+    [[nodiscard]] size_t size() const { return size_; }
+    explicit operator bool() const { return opened_; }
+    bool operator !() const { return !opened_; }
+
+private:
+    void close();
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool opened_ = false;
+#if defined(_WIN32)
+    void *mapping_ = nullptr;
+#endif
+};
+
+}
@@ -21,27 +21,95 @@
 
 namespace hojy::util {
 
-Random gRandom;
+thread_local Random gRandom;
+thread_local Random gCombatRandom;
+thread_local Random gWorldRandom;
+thread_local Random gShopRandom;
 
-Random::Random() noexcept: rand_(std::random_device()()), dist_(0., 1.) {
+static inline std::uint64_t splitMix64(std::uint64_t &state) {
+    auto z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void Xoshiro256ss::seed(std::uint64_t value) {
+    /* state must not be all zero, splitmix64 never outputs 4 zeros in a row */
+    for (auto &s: s_) {
+        s = splitMix64(value);
+    }
+}
 
+Random::Random() noexcept {
+    std::random_device rd;
+    mt_.seed((std::uint64_t(rd()) << 32) | rd());
+}
+
+void Random::seed(std::uint64_t value, Engine engine) {
+    engine_ = engine;
+    if (engine == Engine::Xoshiro256ss) {
+        xoshiro_.seed(value);
+    } else {
+        mt_.seed(value);
+    }
 }
 
 Random::IntType Random::operator()() {
-    return rand_();
+    return next();
 }
 
 Random::IntType Random::operator()(Random::IntType modulo) {
-    return rand_() % modulo;
+    if (modulo == 0) { return 0; }
+    if (modulo <= 0xFFFFFFFFULL) {
+        /* Lemire's multiply-shift on high 32 bits, rejects the biased low part instead of using `%` */
+        auto range = std::uint32_t(modulo);
+        auto m = (next() >> 32) * range;
+        auto low = std::uint32_t(m);
+        if (low < range) {
+            auto threshold = std::uint32_t(-range) % range;
+            while (low < threshold) {
+                m = (next() >> 32) * range;
+                low = std::uint32_t(m);
+            }
+        }
+        return m >> 32;
+    }
+    auto limit = ~IntType(0) - (~IntType(0) % modulo + 1) % modulo;
+    IntType n;
+    do { n = next(); } while (n > limit);
+    return n % modulo;
 }
 
 Random::IntType Random::operator()(Random::IntType min, Random::IntType max) {
     if (min > max) { return min; }
-    return rand_() % (max - min + 1) + min;
+    return (*this)(max - min + 1) + min;
 }
 
 Random::RealType Random::getReal() {
-    return dist_(rand_);
+    return RealType(next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+Random::Engine Random::engineFromName(const std::string &name) {
+    return name == "xoshiro256**" ? Engine::Xoshiro256ss : Engine::MT19937_64;
+}
+
+const char *Random::engineName(Random::Engine engine) {
+    return engine == Engine::Xoshiro256ss ? "xoshiro256**" : "mt19937_64";
+}
+
+std::uint64_t seedRandom(std::uint64_t seed, Random::Engine engine) {
+    if (seed == 0) {
+        std::random_device rd;
+        while (seed == 0) {
+            seed = (std::uint64_t(rd()) << 32) | rd();
+        }
+    }
+    auto state = seed;
+    gRandom.seed(splitMix64(state), engine);
+    gCombatRandom.seed(splitMix64(state), engine);
+    gWorldRandom.seed(splitMix64(state), engine);
+    gShopRandom.seed(splitMix64(state), engine);
+    return seed;
 }
 
 }
@@ -20,27 +20,86 @@
 #pragma once
 
 #include <random>
+#include <string>
 
 #include <cstdint>
 
 namespace hojy::util {
 
+/* xoshiro256** by David Blackman and Sebastiano Vigna, much smaller state and faster than mt19937_64 */
+class Xoshiro256ss {
+public:
+    using result_type = std::uint64_t;
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~result_type(0); }
+
+    void seed(std::uint64_t value);
+    inline result_type operator()() {
+        const auto result = rotl(s_[1] * 5, 7) * 9;
+        const auto t = s_[1] << 17;
+        s_[2] ^= s_[0];
+        s_[3] ^= s_[1];
+        s_[1] ^= s_[2];
+        s_[0] ^= s_[3];
+        s_[2] ^= t;
+        s_[3] = rotl(s_[3], 45);
+        return result;
+    }
+
+private:
+    static inline std::uint64_t rotl(std::uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+private:
+    std::uint64_t s_[4] = {};
+};
+
 class Random {
 public:
-    using IntType = std::mt19937_64::result_type;
-    using RealType = std::uniform_real_distribution<>::result_type;
+    using IntType = std::uint64_t;
+    using RealType = double;
+    enum class Engine {
+        MT19937_64,
+        Xoshiro256ss,
+    };
 
+    /* seeded from std::random_device with mt19937_64 until seed() is called */
     Random() noexcept;
+    void seed(std::uint64_t value, Engine engine = Engine::MT19937_64);
+    [[nodiscard]] inline Engine engine() const { return engine_; }
     IntType operator()();
+    /* uniform in [0, modulo), 0 if modulo is 0 */
     IntType operator()(IntType modulo);
+    /* uniform in [min, max], min if min > max */
     IntType operator()(IntType min, IntType max);
     RealType getReal();
 
+    /* names used in config.toml and input records, unknown names give MT19937_64 */
+    static Engine engineFromName(const std::string &name);
+    static const char *engineName(Engine engine);
+
 private:
-    std::mt19937_64 rand_;
-    std::uniform_real_distribution<> dist_;
+    inline IntType next() { return engine_ == Engine::Xoshiro256ss ? xoshiro_() : mt_(); }
+
+private:
+    Engine engine_ = Engine::MT19937_64;
+    std::mt19937_64 mt_;
+    Xoshiro256ss xoshiro_;
 };
 
-extern Random gRandom;
+/* Random streams are split by subsystem, so rolls in one of them never shift sequences of others.
+ * All of them are thread local, so battles simulated on worker threads each roll their own sequences */
+/* cosmetic and UI rolls: clouds, character creation */
+extern thread_local Random gRandom;
+/* battle damage, AI choices, level ups */
+extern thread_local Random gCombatRandom;
+/* event scripts and talks */
+extern thread_local Random gWorldRandom;
+/* shop selection */
+extern thread_local Random gShopRandom;
+
+/* seed all streams of calling thread from one seed, each stream gets a different sequence derived from it,
+ * seed 0 picks a random seed, returns the seed used */
+std::uint64_t seedRandom(std::uint64_t seed, Random::Engine engine);
 
 }
@@ -0,0 +1,125 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace hojy::util {
+
+/* Fixed-capacity ring of fixed-size units for one producer and one consumer thread,
+ * storage is allocated once in init() so push/pop never allocate or lock */
+class RingBuffer final {
+public:
+    RingBuffer() = default;
+    RingBuffer(const RingBuffer&) = delete;
+    inline ~RingBuffer() {
+        delete[] buf_;
+    }
+    /* capacity is rounded up to power of 2 */
+    inline void init(size_t unitSize, size_t capacity) {
+        delete[] buf_;
+        unitSize_ = unitSize;
+        capacity_ = 1;
+        while (capacity_ < capacity) { capacity_ <<= 1; }
+        mask_ = capacity_ - 1;
+        buf_ = new std::uint8_t[unitSize_ * capacity_];
+        reset();
+    }
+    /* not thread-safe, call it only while both producer and consumer are idle */
+    inline void reset() {
+        write_.store(0, std::memory_order_relaxed);
+        read_.store(0, std::memory_order_relaxed);
+    }
+
+    /* producer: get contiguous writable region, count is updated to the units available */
+    [[nodiscard]] inline void *reserve(size_t &count) {
+        auto w = write_.load(std::memory_order_relaxed);
+        auto avail = capacity_ - (w - read_.load(std::memory_order_acquire));
+        auto pos = w & mask_;
+        count = std::min(count, std::min(avail, capacity_ - pos));
+        return buf_ + pos * unitSize_;
+    }
+    /* producer: publish units written to region got from reserve() */
+    inline void commit(size_t count) {
+        write_.store(write_.load(std::memory_order_relaxed) + count, std::memory_order_release);
+    }
+    /* producer: copy units in, returns units written */
+    inline size_t push(const void *data, size_t count) {
+        const auto *src = static_cast<const std::uint8_t*>(data);
+        size_t total = 0;
+        while (total < count) {
+            size_t sz = count - total;
+            auto *dst = reserve(sz);
+            if (!sz) { break; }
+            memcpy(dst, src, sz * unitSize_);
+            commit(sz);
+            src += sz * unitSize_;
+            total += sz;
+        }
+        return total;
+    }
+
+    /* consumer: copy units out, returns units read,
+     * if space is larger than unit size, units are written with stride of `space` bytes */
+    inline size_t pop(void *data, size_t count, size_t space = 0) {
+        auto r = read_.load(std::memory_order_relaxed);
+        count = std::min(count, size_t(write_.load(std::memory_order_acquire) - r));
+        auto *dst = static_cast<std::uint8_t*>(data);
+        auto step = unitSize_;
+        bool needSkip = space > step;
+        size_t left = count;
+        while (left) {
+            auto pos = r & mask_;
+            auto sz = std::min(left, capacity_ - pos);
+            const auto *src = buf_ + pos * step;
+            if (needSkip) {
+                for (size_t i = sz; i; --i) {
+                    memcpy(dst, src, step);
+                    dst += space;
+                    src += step;
+                }
+            } else {
+                memcpy(dst, src, sz * step);
+                dst += sz * step;
+            }
+            r += sz;
+            left -= sz;
+        }
+        read_.store(r, std::memory_order_release);
+        return count;
+    }
+
+    [[nodiscard]] inline size_t size() const {
+        return write_.load(std::memory_order_acquire) - read_.load(std::memory_order_acquire);
+    }
+    [[nodiscard]] inline size_t freeCount() const { return capacity_ - size(); }
+    [[nodiscard]] inline size_t capacity() const { return capacity_; }
+
+private:
+    std::uint8_t *buf_ = nullptr;
+    size_t unitSize_ = 1, capacity_ = 0, mask_ = 0;
+    alignas(64) std::atomic<size_t> write_ {0};
+    alignas(64) std::atomic<size_t> read_ {0};
+};
+
+}
@@ -0,0 +1,60 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <array>
+#include <utility>
+#include <cstddef>
+
+namespace hojy::util {
+
+/* Lock-free fixed-capacity queue for exactly one producer thread and one consumer thread,
+ * push()/pop() never block or allocate and fail when the queue is full/empty */
+template<typename T, size_t N>
+class SPSCQueue final {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be power of 2");
+
+public:
+    bool push(const T &item) {
+        auto w = write_.load(std::memory_order_relaxed);
+        if (w - read_.load(std::memory_order_acquire) >= N) { return false; }
+        items_[w & (N - 1)] = item;
+        write_.store(w + 1, std::memory_order_release);
+        return true;
+    }
+    bool pop(T &item) {
+        auto r = read_.load(std::memory_order_relaxed);
+        if (r == write_.load(std::memory_order_acquire)) { return false; }
+        item = std::move(items_[r & (N - 1)]);
+        read_.store(r + 1, std::memory_order_release);
+        return true;
+    }
+    [[nodiscard]] bool empty() const {
+        return read_.load(std::memory_order_acquire) == write_.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, N> items_ {};
+    alignas(64) std::atomic<size_t> write_ {0};
+    alignas(64) std::atomic<size_t> read_ {0};
+};
+
+}
@@ -0,0 +1,146 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "taskgraph.hh"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <chrono>
+
+namespace hojy::util {
+
+static std::uint64_t nowUs() {
+    return std::uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+TaskGraph::~TaskGraph() {
+    {
+        std::unique_lock lk(mutex_);
+        quit_ = true;
+    }
+    workerCond_.notify_all();
+    for (auto &th: workers_) {
+        th.join();
+    }
+}
+
+TaskGraph::TaskId TaskGraph::add(std::string name, std::function<void()> func, std::initializer_list<TaskId> deps, Affinity affinity) {
+    auto id = tasks_.size();
+    auto &task = tasks_.emplace_back();
+    task.name = std::move(name);
+    task.func = std::move(func);
+    task.affinity = affinity;
+    for (auto dep: deps) {
+        tasks_[dep].dependents.push_back(id);
+        ++task.pending;
+    }
+    return id;
+}
+
+void TaskGraph::start(int threads) {
+    if (threads <= 0) {
+        threads = std::clamp(int(std::thread::hardware_concurrency()) - 1, 1, 4);
+    }
+    startTime_ = nowUs();
+    remaining_ = tasks_.size();
+    for (TaskId i = 0; i < tasks_.size(); ++i) {
+        if (tasks_[i].pending) { continue; }
+        (tasks_[i].affinity == Main ? readyMain_ : readyWorker_).push_back(i);
+    }
+    workers_.reserve(threads);
+    for (int i = 0; i < threads; ++i) {
+        workers_.emplace_back(&TaskGraph::workerProc, this);
+    }
+}
+
+bool TaskGraph::poll() {
+    std::unique_lock lk(mutex_);
+    while (!readyMain_.empty()) {
+        auto id = readyMain_.front();
+        readyMain_.pop_front();
+        lk.unlock();
+        runTask(id);
+        lk.lock();
+    }
+    return remaining_ == 0;
+}
+
+void TaskGraph::wait() {
+    std::unique_lock lk(mutex_);
+    for (;;) {
+        mainCond_.wait(lk, [this] { return remaining_ == 0 || !readyMain_.empty(); });
+        if (readyMain_.empty()) { break; }
+        auto id = readyMain_.front();
+        readyMain_.pop_front();
+        lk.unlock();
+        runTask(id);
+        lk.lock();
+    }
+}
+
+void TaskGraph::report() const {
+    std::uint64_t endTime = startTime_;
+    for (const auto &task: tasks_) {
+        fmt::print("  {:<16}{:8.2f}ms .. {:8.2f}ms{}\n", task.name, double(task.startTime - startTime_) / 1000.,
+                   double(task.endTime - startTime_) / 1000., task.affinity == Main ? " (main)" : "");
+        endTime = std::max(endTime, task.endTime);
+    }
+    fmt::print("{} tasks finished in {:.2f}ms on {} workers\n", tasks_.size(), double(endTime - startTime_) / 1000., workers_.size());
+}
+
+void TaskGraph::runTask(TaskId id) {
+    auto &task = tasks_[id];
+    task.startTime = nowUs();
+    task.func();
+    task.endTime = nowUs();
+    bool wakeMain = false;
+    size_t wakeWorkers = 0;
+    {
+        std::unique_lock lk(mutex_);
+        for (auto dep: task.dependents) {
+            auto &t = tasks_[dep];
+            if (--t.pending) { continue; }
+            if (t.affinity == Main) {
+                readyMain_.push_back(dep);
+                wakeMain = true;
+            } else {
+                readyWorker_.push_back(dep);
+                ++wakeWorkers;
+            }
+        }
+        if (--remaining_ == 0) { wakeMain = true; }
+    }
+    if (wakeMain) { mainCond_.notify_all(); }
+    for (; wakeWorkers; --wakeWorkers) { workerCond_.notify_one(); }
+}
+
+void TaskGraph::workerProc() {
+    std::unique_lock lk(mutex_);
+    for (;;) {
+        workerCond_.wait(lk, [this] { return quit_ || !readyWorker_.empty(); });
+        if (readyWorker_.empty()) { break; }
+        auto id = readyWorker_.front();
+        readyWorker_.pop_front();
+        lk.unlock();
+        runTask(id);
+        lk.lock();
+    }
+}
+
+}
@@ -0,0 +1,83 @@
+/*
+ * Heroes of Jin Yong.
+ * A reimplementation of the DOS game `The legend of Jin Yong Heroes`.
+ * Copyright (C) 2021, Soar Qin<soarchin@gmail.com>
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+namespace hojy::util {
+
+/* Tasks with dependencies, run on a worker pool as soon as their dependencies are finished.
+ * Tasks with Main affinity (GPU uploads etc.) are only run by poll()/wait() on the calling thread */
+class TaskGraph final {
+public:
+    using TaskId = size_t;
+    enum Affinity {
+        Worker,
+        Main,
+    };
+
+public:
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    ~TaskGraph();
+
+    /* must be called before start() */
+    TaskId add(std::string name, std::function<void()> func, std::initializer_list<TaskId> deps = {}, Affinity affinity = Worker);
+    /* threads = 0 picks worker count by hardware concurrency */
+    void start(int threads = 0);
+    /* run ready main thread tasks, returns true if all tasks are finished */
+    bool poll();
+    /* run main thread tasks until all tasks are finished */
+    void wait();
+    /* print time spent in each task */
+    void report() const;
+
+private:
+    struct Task {
+        std::string name;
+        std::function<void()> func;
+        std::vector<TaskId> dependents;
+        size_t pending = 0;
+        Affinity affinity = Worker;
+        std::uint64_t startTime = 0, endTime = 0;
+    };
+    void runTask(TaskId id);
+    void workerProc();
+
+private:
+    std::vector<Task> tasks_;
+    std::deque<TaskId> readyWorker_, readyMain_;
+    size_t remaining_ = 0;
+    bool quit_ = false;
+    std::uint64_t startTime_ = 0;
+    std::mutex mutex_;
+    std::condition_variable workerCond_, mainCond_;
+    std::vector<std::thread> workers_;
+};
+
+}